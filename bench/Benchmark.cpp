@@ -0,0 +1,148 @@
+#include "Benchmark.h"
+
+#include <map>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+namespace argosClient {
+
+  const double Benchmark::MIN_RUN_SECONDS = 0.05;
+
+  typedef std::chrono::steady_clock Clock;
+
+  std::vector<Benchmark::Entry>& Benchmark::entries() {
+    static std::vector<Entry> entries;
+    return entries;
+  }
+
+  bool Benchmark::add(const std::string& name, const Body& body, bool needsGL) {
+    Entry entry;
+    entry.name = name;
+    entry.body = body;
+    entry.needsGL = needsGL;
+    entries().push_back(entry);
+
+    return true;
+  }
+
+  bool Benchmark::needsGL(const std::string& filter) {
+    for(const Entry& entry : entries()) {
+      if(entry.needsGL && entry.name.find(filter) != std::string::npos)
+        return true;
+    }
+
+    return false;
+  }
+
+  std::vector<Benchmark::Result> Benchmark::run(const std::string& filter) {
+    std::vector<Result> results;
+
+    for(const Entry& entry : entries()) {
+      if(entry.name.find(filter) == std::string::npos)
+        continue;
+
+      Result result = time(entry);
+      printf("%-48s %12.1f ns/op  (%.1f - %.1f, %ld iterations)\n", result.name.c_str(), result.nsPerOp,
+             result.minNsPerOp, result.maxNsPerOp, result.iterations);
+      fflush(stdout);
+      results.push_back(result);
+    }
+
+    return results;
+  }
+
+  Benchmark::Result Benchmark::time(const Entry& entry) {
+    // Warms up the caches and finds how many iterations fill a run
+    long iterations = 1;
+    while(true) {
+      Clock::time_point start = Clock::now();
+      entry.body(iterations);
+      double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+      if(seconds >= MIN_RUN_SECONDS)
+        break;
+
+      iterations = (seconds < MIN_RUN_SECONDS / 100) ? iterations * 10 : iterations * 2;
+    }
+
+    std::vector<double> runs;
+    for(int i = 0; i < REPETITIONS; ++i) {
+      Clock::time_point start = Clock::now();
+      entry.body(iterations);
+      runs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations);
+    }
+    std::sort(runs.begin(), runs.end());
+
+    Result result;
+    result.name = entry.name;
+    result.iterations = iterations;
+    result.nsPerOp = runs[REPETITIONS / 2];
+    result.minNsPerOp = runs.front();
+    result.maxNsPerOp = runs.back();
+
+    return result;
+  }
+
+  bool Benchmark::writeJson(const std::vector<Result>& results, const std::string& fileName) {
+    std::ofstream file(fileName.c_str());
+    if(!file) {
+      fprintf(stderr, "Could not write '%s'.\n", fileName.c_str());
+      return false;
+    }
+
+    file << "{\n  \"benchmarks\": [";
+    for(size_t i = 0; i < results.size(); ++i) {
+      const Result& result = results[i];
+      file << (i ? "," : "") << "\n    { \"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+           << ", \"ns_per_op\": " << result.nsPerOp << ", \"min_ns_per_op\": " << result.minNsPerOp
+           << ", \"max_ns_per_op\": " << result.maxNsPerOp << " }";
+    }
+    file << "\n  ]\n}\n";
+
+    return true;
+  }
+
+  int Benchmark::compare(const std::vector<Result>& results, const std::string& fileName, double tolerance) {
+    std::ifstream file(fileName.c_str());
+    if(!file)
+      return -1;
+
+    // Only reads what writeJson() writes: one benchmark per line
+    std::map<std::string, double> baseline;
+    std::string line;
+    while(std::getline(file, line)) {
+      size_t name = line.find("\"name\": \"");
+      size_t time = line.find("\"ns_per_op\": ");
+      if(name == std::string::npos || time == std::string::npos)
+        continue;
+
+      name += 9;
+      baseline[line.substr(name, line.find('"', name) - name)] = atof(line.c_str() + time + 13);
+    }
+
+    int regressions = 0;
+    printf("\n%-48s %12s %12s %8s\n", "Benchmark", "Baseline", "Now", "Change");
+    for(const Result& result : results) {
+      auto it = baseline.find(result.name);
+      if(it == baseline.end() || it->second <= 0.0) {
+        printf("%-48s %12s %12.1f %8s\n", result.name.c_str(), "-", result.nsPerOp, "new");
+        continue;
+      }
+
+      double change = result.nsPerOp / it->second - 1.0;
+      bool regressed = change > tolerance;
+      printf("%-48s %12.1f %12.1f %+7.1f%%%s\n", result.name.c_str(), it->second, result.nsPerOp, 100.0 * change,
+             regressed ? "  REGRESSION" : "");
+
+      if(regressed)
+        regressions++;
+    }
+
+    return regressions;
+  }
+
+}
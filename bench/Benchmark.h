@@ -0,0 +1,111 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace argosClient {
+
+  /**
+   * A minimal microbenchmark harness for the client hot paths
+   * Every benchmark is a function running its body a given number of times. The
+   * harness grows that number until a run lasts MIN_RUN_SECONDS, then times
+   * REPETITIONS runs and keeps the median, which is far less noisy than the mean
+   * on a Raspberry Pi sharing its cores with the desktop
+   */
+  class Benchmark {
+  public:
+    typedef std::function<void(long iterations)> Body;
+
+    static const int REPETITIONS = 7; ///< The timed runs of every benchmark
+    static const double MIN_RUN_SECONDS; ///< The shortest timed run
+
+    /**
+     * The timing of a benchmark
+     */
+    struct Result {
+      std::string name; ///< The name of the benchmark
+      long iterations; ///< The iterations of every timed run
+      double nsPerOp; ///< The median time of one iteration
+      double minNsPerOp; ///< The fastest run
+      double maxNsPerOp; ///< The slowest run
+    };
+
+  public:
+    /**
+     * Registers a benchmark, usually from a static initializer
+     * @param name The name of the benchmark, "group/case"
+     * @param body The function to time
+     * @param needsGL Whether the body needs the OpenGL context
+     * @return true, so it can initialize a static
+     */
+    static bool add(const std::string& name, const Body& body, bool needsGL = false);
+
+    /**
+     * Checks whether any benchmark matching a filter needs the OpenGL context
+     * @param filter A substring of the names to run (empty for all)
+     * @return true if the context must be created before running them
+     */
+    static bool needsGL(const std::string& filter);
+
+    /**
+     * Runs the benchmarks
+     * @param filter A substring of the names to run (empty for all)
+     * @return the results in registration order
+     */
+    static std::vector<Result> run(const std::string& filter);
+
+    /**
+     * Writes results as JSON
+     * @param results The results to write
+     * @param fileName The file to write
+     * @return true if the file could be written
+     */
+    static bool writeJson(const std::vector<Result>& results, const std::string& fileName);
+
+    /**
+     * Compares results with a baseline written by writeJson()
+     * @param results The new results
+     * @param fileName The baseline file
+     * @param tolerance The allowed slowdown, e.g. 0.1 for 10 %
+     * @return the number of benchmarks slower than the baseline beyond the tolerance (-1 if there is no baseline)
+     */
+    static int compare(const std::vector<Result>& results, const std::string& fileName, double tolerance);
+
+    /**
+     * Keeps the compiler from optimizing a computed value away
+     * @param value The value to keep
+     */
+    template<typename T>
+    static void keep(T const& value) {
+      asm volatile("" : : "g"(&value) : "memory");
+    }
+
+  private:
+    /**
+     * A registered benchmark
+     */
+    struct Entry {
+      std::string name; ///< The name of the benchmark
+      Body body; ///< The function to time
+      bool needsGL; ///< Whether the body needs the OpenGL context
+    };
+
+    /**
+     * Gets the registered benchmarks
+     * @return the benchmarks in registration order
+     */
+    static std::vector<Entry>& entries();
+
+    /**
+     * Times a benchmark
+     * @param entry The benchmark
+     * @return its timing
+     */
+    static Result time(const Entry& entry);
+  };
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include <glm/glm.hpp>
+
+#include "Benchmark.h"
+#include "GLContext.h"
+#include "GraphicComponentsManager.h"
+#include "TextComponent.h"
+
+namespace argosClient {
+
+  /**
+   * A paper holding some highlights, as drawn over a document every frame
+   */
+  static paper_t makePaper(int id, int highlights) {
+    paper_t paper;
+    paper.id = id;
+    for(int i = 0; i < 16; ++i) {
+      paper.modelview_matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
+    paper.modelview_matrix[14] = -30.0f;
+    paper.x = paper.y = 0.0f;
+    paper.num_calling_functions = highlights;
+
+    for(int i = 0; i < highlights; ++i) {
+      CallingFunctionData cfd;
+      cfd.id = DRAW_HIGHLIGHT;
+      cfd.args = { "1.0", "0.8", "0.0", std::to_string(i % 8), std::to_string(i / 8), "0.0", "0.5", "0.5" };
+      paper.cfds.push_back(cfd);
+    }
+
+    return paper;
+  }
+
+  static bool registerGraphicsBenchmarks() {
+    static const int highlightCounts[] = { 0, 8, 32 };
+    for(int highlights : highlightCounts) {
+      // Two papers take turns so the components of the previous one are cleaned every time, built once outside the timed body
+      std::vector<paper_t> papers = { makePaper(101, highlights), makePaper(102, highlights) };
+
+      Benchmark::add("GLContext::update/" + std::to_string(highlights) + "_highlights", [papers](long iterations) {
+        GLContext& glContext = GLContext::getInstance();
+
+        for(long i = 0; i < iterations; ++i) {
+          glContext.update(papers[i % 2]);
+        }
+      }, true);
+    }
+
+    Benchmark::add("GraphicComponentsManager/create_cleanForId_16", [](long iterations) {
+      GraphicComponentsManager& manager = GraphicComponentsManager::getInstance();
+
+      for(long i = 0; i < iterations; ++i) {
+        for(int j = 0; j < 16; ++j) {
+          manager.createHighlight("Benchmark_id:777_num:" + std::to_string(j), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+                                  glm::vec3(j, 0.0f, 0.0f), glm::vec3(0.5f, 0.5f, 1.0f));
+        }
+        manager.cleanForId(777);
+      }
+    }, true);
+
+    static const int lengths[] = { 16, 64, 256 };
+    for(int length : lengths) {
+      Benchmark::add("TextComponent::setText/" + std::to_string(length) + "_chars", [length](long iterations) {
+        static TextComponent text("data/fonts/ProximaNova-Bold.ttf", 54);
+        std::wstring line;
+        for(int i = 0; i < length; ++i) {
+          line += (wchar_t) (L'a' + i % 26);
+        }
+
+        for(long i = 0; i < iterations; ++i) {
+          text.setText(line);
+        }
+      }, true);
+    }
+
+    return true;
+  }
+
+  static bool registered = registerGraphicsBenchmarks();
+
+}
@@ -0,0 +1,111 @@
+#include <cstring>
+#include <opencv2/opencv.hpp>
+
+#include "Benchmark.h"
+#include "TaskDelegation.h"
+
+namespace argosClient {
+
+  /**
+   * Appends the raw bytes of a value to a payload
+   */
+  template<typename T>
+  static void append(std::vector<unsigned char>& data, const T& value) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+  }
+
+  /**
+   * Builds a paper as the server sends it, alternating images and highlights
+   */
+  static TaskDelegation::StreamType makePaper(int commands) {
+    TaskDelegation::StreamType st;
+    st.type = TaskDelegation::Type::PAPER;
+
+    append(st.data, 1);
+    for(int i = 0; i < 16; ++i) {
+      append(st.data, (i % 5 == 0) ? 1.0f : 0.0f);
+    }
+    append(st.data, 0.5f);
+    append(st.data, 0.5f);
+    append(st.data, commands);
+
+    for(int i = 0; i < commands; ++i) {
+      if(i % 2 == 0) {
+        char filename[32] = "benchmark.jpg";
+        append(st.data, (int) DRAW_IMAGE);
+        st.data.insert(st.data.end(), filename, filename + sizeof(filename));
+        for(int j = 0; j < 5; ++j) {
+          append(st.data, 1.5f * j);
+        }
+      }
+      else {
+        append(st.data, (int) DRAW_HIGHLIGHT);
+        for(int j = 0; j < 8; ++j) {
+          append(st.data, 0.25f * j);
+        }
+      }
+    }
+
+    st.size = st.data.size();
+
+    return st;
+  }
+
+  /**
+   * A camera-like frame: smooth shapes and some sensor noise
+   */
+  static cv::Mat makeFrame(int width, int height) {
+    cv::Mat frame(height, width, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::GaussianBlur(frame, frame, cv::Size(0, 0), width / 64.0);
+
+    cv::Mat noise(height, width, CV_8UC3);
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(6));
+
+    return frame + noise;
+  }
+
+  static bool registerTaskDelegationBenchmarks() {
+    // The inputs are built once here, every run of a body would otherwise time their construction too
+    static const int commandCounts[] = { 1, 8, 32, 128 };
+    for(int commands : commandCounts) {
+      TaskDelegation::StreamType st = makePaper(commands);
+
+      Benchmark::add("processPaper/" + std::to_string(commands) + "_commands", [st](long iterations) mutable {
+        static TaskDelegation td;
+
+        for(long i = 0; i < iterations; ++i) {
+          paper_t paper;
+          td.processPaper(st, paper);
+          Benchmark::keep(paper);
+        }
+      });
+    }
+
+    static const int sizes[][2] = { { 320, 240 }, { 640, 480 }, { 1280, 720 } };
+    static const int qualities[] = { 50, 80, 95 };
+    for(auto& size : sizes) {
+      for(int quality : qualities) {
+        int width = size[0];
+        int height = size[1];
+        cv::Mat frame = makeFrame(width, height);
+
+        Benchmark::add("addCvMat/" + std::to_string(width) + "x" + std::to_string(height) + "_q" + std::to_string(quality),
+                       [frame, quality](long iterations) mutable {
+          static TaskDelegation td;
+
+          for(long i = 0; i < iterations; ++i) {
+            td.addCvMat(frame, quality);
+            td.clearBuffer();
+          }
+        });
+      }
+    }
+
+    return true;
+  }
+
+  static bool registered = registerTaskDelegationBenchmarks();
+
+}
@@ -0,0 +1,82 @@
+#include <unistd.h>
+#include <getopt.h>
+#include <cstdlib>
+#include <iostream>
+
+#ifndef ARGOS_HEADLESS
+#include "bcm_host.h"
+#endif
+
+#include "Benchmark.h"
+#include "GLContext.h"
+#include "Log.h"
+
+using namespace argosClient;
+
+void usage(const char* program) {
+  std::cout << "Usage: " + std::string(program) + " [-f filter] [-o results.json] [-b baseline.json] [-t tolerance]" << std::endl;
+  std::cout << "  -f  Only run the benchmarks whose name contains the filter" << std::endl;
+  std::cout << "  -o  Write the results as JSON" << std::endl;
+  std::cout << "  -b  Compare the results with a baseline written with -o, fail on regressions" << std::endl;
+  std::cout << "  -t  Allowed slowdown against the baseline in percent (default 10)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  std::string filter;
+  std::string output;
+  std::string baseline;
+  double tolerance = 10.0;
+
+  int option;
+  while((option = getopt(argc, argv, "f:o:b:t:h")) != -1) {
+    switch(option) {
+    case 'f':
+      filter = optarg;
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'b':
+      baseline = optarg;
+      break;
+    case 't':
+      tolerance = atof(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 0;
+    }
+  }
+
+  // The benchmarks would mostly time the log otherwise
+  Log::setLevel(Log::LEVEL_ERROR);
+
+  if(Benchmark::needsGL(filter)) {
+    // The same window as the client, without the camera and projector calibration
+#ifndef ARGOS_HEADLESS
+    bcm_host_init();
+#endif
+    GLContext& glContext = GLContext::getInstance();
+    glContext.setUpscale(false);
+    glContext.setScreen(0, 0, 800, 600);
+    glContext.start();
+  }
+
+  std::vector<Benchmark::Result> results = Benchmark::run(filter);
+
+  if(!output.empty() && !Benchmark::writeJson(results, output))
+    return EXIT_FAILURE;
+
+  if(!baseline.empty()) {
+    int regressions = Benchmark::compare(results, baseline, tolerance / 100.0);
+    if(regressions < 0) {
+      std::cout << "No baseline in '" << baseline << "', run make bench-baseline to record one." << std::endl;
+    }
+    else if(regressions > 0) {
+      std::cout << regressions << " benchmarks slower than the baseline by more than " << tolerance << "%." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -4,6 +4,20 @@ execLine() {
     echo "Ejecutar como: ./tts.sh [-h] <lang> <text> <filename>"
 }
 
+# Percent-encodes every byte but the unreserved ones, the text comes from the documents
+urlencode() {
+    local LC_ALL=C
+    local text="$1" encoded="" c i
+    for (( i = 0; i < ${#text}; i++ )); do
+        c=${text:i:1}
+        case $c in
+            [a-zA-Z0-9.~_-]) encoded+=$c ;;
+            *) printf -v c '%%%02X' "'$c"; encoded+=$c ;;
+        esac
+    done
+    printf '%s' "$encoded"
+}
+
 if [ $# -eq 0 ]; then
     execLine
     exit 1
@@ -21,6 +35,7 @@ if [ $# -lt 3 ]; then
         echo ""
         echo "<filename>"
         echo "  El nombre del archivo resultante, con la extensión."
+        echo "  Si termina en .wav es la ruta completa del archivo (así lo llama el cliente)."
         exit 1
     fi
     execLine
@@ -30,11 +45,17 @@ fi
 lang=$1
 text="$2"
 filename=$3
-request="http://translate.google.com/translate_tts?ie=UTF-8&tl=$lang&q=${text// /%20}"
+if [[ $filename == *.wav ]]; then
+    output=$filename
+else
+    output=sounds/$filename.wav
+fi
+download=$(mktemp)
+request="http://translate.google.com/translate_tts?ie=UTF-8&tl=$(urlencode "$lang")&q=$(urlencode "$text")"
 
 # Download text to speeched file
 echo "[1/2] Downloading requested audio..."
-wget -q -U Mozilla -O $filename $request
+wget -q -U Mozilla -O "$download" "$request" || { rm -f "$download"; exit 1; }
 
 # Convert it to wav
 echo "[2/2] Converting it to wav format..."
@@ -44,7 +65,9 @@ mplayer \
     -vc null \
     -af volume=0,resample=16000:0:1 \
     -format s16le \
-    -ao pcm:waveheader:file=sounds/$filename.wav $filename
+    -ao pcm:waveheader:file="$output" "$download"
+status=$?
 
 # Delete temp
-rm $filename
+rm -f "$download"
+exit $status
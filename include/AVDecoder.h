@@ -0,0 +1,170 @@
+#ifndef AVDECODER_H
+#define AVDECODER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+namespace argosClient {
+
+  /**
+   * A video decoder built directly on libavcodec
+   * Frames are decoded ahead on the shared TaskPool into a small ring and kept
+   * as planar YUV 4:2:0, so the colour conversion is left to the GPU
+   */
+  class AVDecoder {
+  public:
+    /**
+     * A decoded frame in planar YUV 4:2:0
+     */
+    struct YUVFrame {
+      int index; ///< The number of the frame from its presentation time, counting every loop (-1 if the slot is free)
+      int width; ///< The width of the luma plane
+      int height; ///< The height of the luma plane
+      int strides[3]; ///< The size in bytes of a row of every plane
+      std::vector<unsigned char> planes[3]; ///< The Y, U and V planes
+    };
+
+    static const int RING_SIZE = 4; ///< The number of frames decoded ahead
+
+  public:
+    /**
+     * Constructs a new decoder
+     */
+    AVDecoder();
+
+    /**
+     * Waits for the pending decode job and releases the decoder
+     */
+    ~AVDecoder();
+
+    /**
+     * Opens a video file and starts decoding it ahead
+     * @param fileName The path of the video file
+     * @return true if the video could be opened
+     */
+    bool open(const std::string& fileName);
+
+    /**
+     * Waits for the pending decode job and closes the video file
+     */
+    void close();
+
+    /**
+     * Sets whether the video should start again on finish or not
+     * Frame numbers keep growing when the video loops
+     * @param loop True whether the video should start again on finish. False otherwise
+     */
+    void setLoop(bool loop);
+
+    /**
+     * Retrieves the newest decoded frame not later than the given one
+     * Never blocks. Older frames are released and more frames are decoded ahead
+     * @param index The number of the frame that should be presented
+     * @return the frame, valid until the next call, or nullptr if it is not decoded yet
+     */
+    const YUVFrame* frameAt(int index);
+
+    /**
+     * Checks whether every frame of the video has been presented
+     * @return true if the video has finished
+     */
+    bool isFinished();
+
+    /**
+     * Checks whether the video uses the full (JPEG) range of values or not
+     * @return true for full range, false for video range
+     */
+    bool isFullRange() const;
+
+    /**
+     * Gets the width of the video
+     * @return the width of the video
+     */
+    int getWidth() const;
+
+    /**
+     * Gets the height of the video
+     * @return the height of the video
+     */
+    int getHeight() const;
+
+    /**
+     * Gets the frame rate of the video
+     * @return the frame rate, or 0 if the container does not report it
+     */
+    float getFps() const;
+
+    /**
+     * Sets the number of threads libavcodec may use for every decoder
+     * Must be set before opening the video
+     * @param threads The number of frame/slice threads
+     */
+    static void setThreadCount(int threads);
+
+  private:
+    AVDecoder(const AVDecoder&);
+    AVDecoder& operator=(const AVDecoder&);
+
+    /**
+     * Queues a decode job if there is room in the ring
+     * The mutex must be held
+     */
+    void scheduleDecode();
+
+    /**
+     * The decode job run by the TaskPool: fills every free slot of the ring
+     */
+    void decodeAhead();
+
+    /**
+     * Decodes the next frame of the video into a slot
+     * @param frame The slot to fill
+     * @param index Receives the number of the frame from its timestamp, -1 if it has none
+     * @return false at the end of the video or on a decoding error
+     */
+    bool decodeInto(YUVFrame& frame, int& index);
+
+    /**
+     * Seeks back to the beginning of the video
+     * @return true if the seek succeeded
+     */
+    bool rewind();
+
+  private:
+    AVFormatContext* _format; ///< The demuxer context
+    AVCodecContext* _codec; ///< The decoder context
+    AVFrame* _frame; ///< The frame used to receive the decoded pictures
+    AVPacket* _packet; ///< The packet used to read from the demuxer
+    SwsContext* _sws; ///< The converter used for non 4:2:0 pixel formats
+    int _stream; ///< The index of the video stream
+    int _width; ///< The width of the video
+    int _height; ///< The height of the video
+    float _fps; ///< The frame rate of the video
+    bool _fullRange; ///< Whether the video uses the full range of values or not
+
+    YUVFrame _frames[RING_SIZE]; ///< The ring of decoded frames
+    int _nextIndex; ///< The lowest number the next decoded frame may get
+    int _loopBase; ///< The number of the first frame of the current loop
+    bool _packetPending; ///< Whether _packet was refused by the decoder and has to be sent again
+    int _wantedIndex; ///< The last frame number requested by the renderer
+    bool _loop; ///< Whether loop the video or not
+    bool _draining; ///< Whether the demuxer has reached its end and the decoder is being drained
+    bool _finished; ///< Whether the decoder has decoded the last frame
+    bool _decoding; ///< Whether there is a decode job queued or running
+    std::mutex _mutex; ///< Protects the ring state
+    std::condition_variable _idle; ///< Signaled when the decode job finishes
+
+    static int threadCount; ///< The number of libavcodec threads for every decoder
+  };
+
+}
+
+#endif
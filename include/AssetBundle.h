@@ -0,0 +1,137 @@
+#ifndef ASSETBUNDLE_H
+#define ASSETBUNDLE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "Singleton.h"
+
+namespace argosClient {
+
+  /**
+   * The images and sounds of data/ packed in a single memory-mapped file, already decoded
+   * Textures are stored as the pixels given to glTexImage2D and sounds as PCM samples in
+   * the format of the mixer, so loading them is an upload or a pointer, without decoding
+   * anything. The bundle is built offline by tools/argos_bundle
+   *
+   *       Header        Data 0    Data 1          Data N-1      Index
+   * +---------------+---------+---------+-----+-----------+-------------+
+   * |   64 bytes    |   ...   |   ...   | ... |    ...    | N * Entry   |
+   * +---------------+---------+---------+-----+-----------+-------------+
+   *
+   * Every data block starts on a 64 bytes boundary and the index is sorted by name
+   */
+  class AssetBundle : public Singleton<AssetBundle> {
+  public:
+    static const char* const DEFAULT_FILE; ///< Where the client looks for the bundle
+
+    /**
+     * The kinds of assets
+     */
+    enum Type {
+      TEXTURE = 1,
+      SOUND = 2
+    };
+
+    /**
+     * The header written at the beginning of the bundle
+     */
+    struct Header {
+      char magic[8]; ///< Always "ARGOSBND"
+      uint32_t version; ///< The version of the bundle format
+      uint32_t entryCount; ///< The number of assets
+      uint64_t indexOffset; ///< Where the index starts
+      char reserved[40]; ///< Padding up to 64 bytes
+    };
+
+    /**
+     * An asset of the index
+     */
+    struct Entry {
+      char name[72]; ///< The path of the source file as the client opens it, e.g. "data/images/panel.jpg"
+      uint32_t type; ///< TEXTURE or SOUND
+      uint32_t format; ///< The GL pixel format of a texture, the SDL sample format of a sound
+      uint32_t width; ///< The width of a texture, the sample rate of a sound
+      uint32_t height; ///< The height of a texture, the number of channels of a sound
+      int64_t mtime; ///< The modification time of the source file
+      uint64_t offset; ///< Where the data starts
+      uint64_t size; ///< The size in bytes of the data
+    };
+
+  public:
+    /**
+     * Constructs a new closed bundle
+     */
+    AssetBundle();
+
+    /**
+     * Unmaps the bundle
+     */
+    ~AssetBundle();
+
+    /**
+     * Decodes the images of <dir>/images and the sounds of <dir>/sounds into a bundle
+     * @param dataDir The data directory, as the client opens it (e.g. "data")
+     * @param bundleFile The path of the resulting bundle
+     * @param rate The sample rate of the mixer
+     * @param channels The number of channels of the mixer
+     * @return true if the bundle was written, false otherwise
+     */
+    static bool build(const std::string& dataDir, const std::string& bundleFile, int rate, int channels);
+
+    /**
+     * Maps a bundle in memory
+     * @param bundleFile The path of the bundle
+     * @return true if the file is a valid bundle, false otherwise
+     */
+    bool open(const std::string& bundleFile);
+
+    /**
+     * Unmaps the bundle if it is mapped
+     */
+    void close();
+
+    /**
+     * Checks whether the bundle is mapped or not
+     * @return true if the bundle is mapped
+     */
+    bool isOpened() const;
+
+    /**
+     * Looks up an asset
+     * An asset whose source file changed since the bundle was built is ignored
+     * @param name The path of the source file, as given to the loaders
+     * @param type The kind of asset
+     * @return the entry of the asset, nullptr if the bundle does not hold it
+     */
+    const Entry* find(const std::string& name, Type type) const;
+
+    /**
+     * Retrieves the data of an asset
+     * @param entry An entry returned by find()
+     * @return a pointer to the data inside the mapping
+     */
+    const unsigned char* data(const Entry& entry) const;
+
+    /**
+     * Gets the number of channels of a texture
+     * @param entry An entry of a texture
+     * @return the number of channels (1 to 4), 0 if the pixel format is unknown
+     */
+    static int getChannels(const Entry& entry);
+
+  private:
+    AssetBundle(const AssetBundle&);
+    AssetBundle& operator=(const AssetBundle&);
+
+  private:
+    void* _mapping; ///< The address of the mapped file
+    size_t _mappingSize; ///< The size of the mapped file
+    const Header* _header; ///< The header of the bundle, inside the mapping
+    const Entry* _entries; ///< The index of the bundle, inside the mapping
+  };
+
+}
+
+#endif
@@ -2,18 +2,43 @@
 #define AUDIOMANAGER_H
 
 #include <map>
+#include <set>
+#include <memory>
+#include <functional>
+#include <vector>
 #include <string>
+#include <climits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
 #include "Singleton.h"
 
 class Mix_Chunk;
 
 namespace argosClient {
 
+  class AudioStream;
+
   /**
    * The audio manager of the system
    */
   class AudioManager : public Singleton<AudioManager> {
   public:
+    static const int DEFAULT_RATE = 16000; ///< The sample rate of the mixer
+    static const int DEFAULT_BUFFER = 4096; ///< The samples mixed at once, 256 ms at the default rate
+    static const int LOW_LATENCY_RATE = 48000; ///< The sample rate in low-latency mode, the usual rate of the device
+    static const int LOW_LATENCY_BUFFER = 512; ///< The samples mixed at once in low-latency mode, about 11 ms
+    static const long STREAM_THRESHOLD = 64 * 1024; ///< Sound files larger than this, in bytes, are streamed instead of preloaded
+    static const int STREAM_CHANNEL = INT_MAX; ///< The channel play() returns for a streamed sound, never a channel of the mixer
+
+    /**
+     * Selects the low-latency mode: a small buffer at the rate of the device, so
+     * neither SDL nor the driver resample. Must be called before the first getInstance()
+     * @param enabled Whether the mixer is opened in low-latency mode
+     */
+    static void setLowLatency(bool enabled);
+
     /**
      * Constructs a new audio manager
      */
@@ -31,7 +56,7 @@ namespace argosClient {
     void setSoundsPath(const std::string& path);
 
     /**
-     * Loads an audio file in memory
+     * Loads an audio file in memory, or only checks it if it is long enough to be streamed
      * @param file_name The file to preload
      */
     void preload(const std::string& file_name);
@@ -41,12 +66,58 @@ namespace argosClient {
      */
     void preloadAll();
 
+    /**
+     * Loads all files from the path in memory, decoding them on the TaskPool
+     * They become playable as drainMainQueue() runs, a sound played before is loaded on the spot
+     */
+    void preloadAllAsync();
+
+    /**
+     * Loads a sound file in memory, decoding it on the TaskPool
+     * @param file_name The file to preload, relative to the path
+     * @param loaded Called on the render thread once the sound is playable (true) or failed to load (false)
+     */
+    void preloadAsync(const std::string& file_name, const std::function<void(bool)>& loaded = nullptr);
+
+    /**
+     * Checks whether a sound can be played without loading it first
+     * @param file_name The sound file
+     * @return true if the sound is preloaded or streamed
+     */
+    bool isLoaded(const std::string& file_name) const;
+
+    /**
+     * Gets the path where the sound files are loaded from
+     * @return the directory path of the sound files
+     */
+    const std::string& getSoundsPath() const;
+
+    /**
+     * Gets the number of sounds still being loaded by preloadAllAsync()
+     * @return the number of pending sounds
+     */
+    int getPendingLoads() const;
+
     /**
      * Plays the specified audio file
      * @param file_name The file to play
      * @param loops The number of times to play it again (-1 infinite)
+     * @return the channel playing the sound, -1 if it could not be played
      */
-    void play(const std::string& file_name, int loops = 0);
+    int play(const std::string& file_name, int loops = 0);
+
+    /**
+     * Releases the streamed sound once it finished, its samples are converted by the fill thread
+     * Never waits, it is meant to be called once per iteration of the main loop
+     */
+    void update();
+
+    /**
+     * Checks whether a streamed sound is playing
+     * Only one sound is streamed at a time, playing another one stops it
+     * @return true until the last sample of the stream is mixed
+     */
+    bool isStreaming() const;
 
     /**
      * Pauses the current playing sound
@@ -83,8 +154,78 @@ namespace argosClient {
     int isPlaying();
 
   private:
+    /**
+     * Called by SDL on its audio thread after mixing every buffer
+     * @param udata Unused
+     * @param stream The mixed samples
+     * @param len The size in bytes of the samples
+     */
+    static void postMix(void* udata, uint8_t* stream, int len);
+
+    /**
+     * Called by SDL on its audio thread when it mixes a channel started by play()
+     * Only the first call after play() measures the latency
+     * @param channel The channel
+     * @param stream The samples of the channel
+     * @param len The size in bytes of the samples
+     * @param udata Unused
+     */
+    static void latencyEffect(int channel, void* stream, int len, void* udata);
+
+    /**
+     * Lists the sound files of the path
+     * @return the file names
+     */
+    std::vector<std::string> listSounds() const;
+
+    /**
+     * Wraps a sound already converted in the AssetBundle, without copying its samples
+     * @param path The path of the sound file
+     * @return the chunk, nullptr if the bundle does not hold the sound in the format of the mixer
+     */
+    Mix_Chunk* loadFromBundle(const std::string& path) const;
+
+    /**
+     * Checks whether a sound file is long enough to be streamed and can be
+     * @param path The path of the sound file
+     * @return true if the file is streamed instead of preloaded
+     */
+    bool shouldStream(const std::string& path) const;
+
+    /**
+     * Streams a sound file, replacing the streamed sound playing
+     * @param path The path of the sound file
+     * @param loops The number of times to play it again (-1 infinite)
+     * @return STREAM_CHANNEL, -1 if the file could not be streamed
+     */
+    int playStream(const std::string& path, int loops);
+
+    /**
+     * Stops the streamed sound and releases it
+     */
+    void stopStream();
+
+    /**
+     * The fill thread, converting the samples of the streamed sound ahead of the audio thread
+     * It has its own thread so the loads and compressions queued on the TaskPool never delay it
+     */
+    void runFillThread();
+
+  private:
+    static bool lowLatency; ///< Whether the mixer is opened in low-latency mode
+
     std::map<std::string, Mix_Chunk*> _soundsMap; ///< An associative list of sounds indexed by its names
     std::string _soundsPath; ///< The directory path where the sounds are located for later loading
+    int _pendingLoads; ///< The sounds still being loaded by preloadAllAsync() and preloadAsync()
+    std::set<std::string> _streamedSounds; ///< The sounds played from their files instead of memory
+    std::shared_ptr<AudioStream> _stream; ///< The streamed sound playing, shared with the fill thread
+    int _streamVolume; ///< The volume of the streamed sounds
+
+    std::thread _fillThread; ///< Fills the ring of the streamed sound, started with the first stream
+    std::mutex _fillMutex; ///< Guards the stream handed to the fill thread
+    std::condition_variable _fillWake; ///< Wakes the fill thread before its next poll
+    std::shared_ptr<AudioStream> _fillStream; ///< The stream the fill thread feeds
+    bool _fillStopping; ///< Whether the fill thread has to finish
   };
 
 }
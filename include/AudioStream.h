@@ -0,0 +1,143 @@
+#ifndef AUDIOSTREAM_H
+#define AUDIOSTREAM_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace argosClient {
+
+  class Counter;
+
+  /**
+   * A WAV file played while it is read, for sounds too long to keep decoded in memory
+   * The file is memory-mapped and its PCM samples are converted to the format of the mixer
+   * a little ahead of the playback, into a ring of RING_MS. The pages already played are
+   * given back to the kernel, so a stream only keeps the ring resident
+   * fill() runs on the fill thread of the AudioManager and mix() on the audio thread, they
+   * share the ring through its two atomic positions without locking
+   */
+  class AudioStream {
+  public:
+    static const int RING_MS = 500; ///< The time covered by the ring
+
+    /**
+     * Constructs a new closed stream
+     */
+    AudioStream();
+
+    /**
+     * Destroys the stream, unmapping its file
+     */
+    ~AudioStream();
+
+    /**
+     * Maps a WAV file and prepares its conversion
+     * @param path The path of the WAV file, 8 or 16 bits PCM, mono or stereo
+     * @param rate The sample rate of the mixer
+     * @param channels The number of channels of the mixer (1 or 2), its samples being AUDIO_S16SYS
+     * @param loops The number of times to play it again (-1 infinite)
+     * @return true if the file can be streamed
+     */
+    bool open(const std::string& path, int rate, int channels, int loops = 0);
+
+    /**
+     * Checks whether a WAV file can be streamed, reading only its header
+     * @param path The path of the WAV file
+     * @return true if its samples are 8 or 16 bits PCM, mono or stereo
+     */
+    static bool canStream(const std::string& path);
+
+    /**
+     * Starts a fill if the ring is half empty and no other fill is running
+     * @return true if the caller has to run fill()
+     */
+    bool beginFill();
+
+    /**
+     * Converts samples until the ring is full or the file ends
+     * Only called after beginFill() returned true
+     */
+    void fill();
+
+    /**
+     * Sets the volume applied to the samples
+     * @param volume The volume, from 0 to MIX_MAX_VOLUME
+     */
+    void setVolume(int volume);
+
+    /**
+     * Pauses or resumes the stream, a paused stream mixes silence and keeps its position
+     * Mix_PauseMusic() does not reach a music hook, the pause is done here
+     * @param paused Whether the stream is paused
+     */
+    void setPaused(bool paused);
+
+    /**
+     * Checks whether the whole file has been played
+     * @return true once the last sample is mixed
+     */
+    bool isFinished() const;
+
+    /**
+     * The music hook given to SDL_mixer, run on the audio thread
+     * Missing samples are played as silence and counted as an underrun
+     * @param udata The AudioStream
+     * @param stream The buffer to fill
+     * @param len The size in bytes of the buffer
+     */
+    static void mix(void* udata, uint8_t* stream, int len);
+
+  private:
+    /**
+     * Maps a file, without logging anything
+     * @param path The path of the file
+     * @return true if the file is mapped
+     */
+    bool map(const std::string& path);
+
+    /**
+     * Finds the format and the samples of a mapped WAV file
+     * @return true if they are 8 or 16 bits PCM, mono or stereo
+     */
+    bool parse();
+
+    /**
+     * Reads a sample of the file as 16 bits
+     * @param frame The frame
+     * @param channel The channel of the file
+     * @return the sample
+     */
+    int sample(size_t frame, int channel) const;
+
+  private:
+    std::string _path; ///< The path of the WAV file
+    const uint8_t* _mapping; ///< The mapped file
+    size_t _mappingSize; ///< The size of the mapping
+    const uint8_t* _samples; ///< The first sample of the file
+    size_t _frames; ///< The number of frames of the file
+    int _sourceRate; ///< The sample rate of the file
+    int _sourceChannels; ///< The channels of the file
+    int _sourceBytes; ///< The bytes per sample of the file, 1 or 2
+    int _channels; ///< The channels of the mixer
+    uint64_t _position; ///< The next frame of the file to convert, 32.32 fixed point
+    uint64_t _step; ///< The frames of the file per frame of the mixer, 32.32 fixed point
+    size_t _released; ///< The bytes of the mapping already given back to the kernel
+    int _loops; ///< The times left to play the file again
+
+    std::vector<int16_t> _ring; ///< The converted samples, interleaved
+    std::atomic<size_t> _readIndex; ///< The samples mixed so far, only moved by mix()
+    std::atomic<size_t> _writeIndex; ///< The samples converted so far, only moved by fill()
+    std::atomic<bool> _filling; ///< Whether a fill is running
+    std::atomic<bool> _decoded; ///< Whether the last sample has been converted
+    std::atomic<bool> _finished; ///< Whether the last sample has been mixed
+    std::atomic<int> _volume; ///< The volume applied to the samples
+    std::atomic<bool> _paused; ///< Whether mix() outputs silence without reading the ring
+    Counter& _underruns; ///< The buffers the ring could not fill in time
+  };
+
+}
+
+#endif
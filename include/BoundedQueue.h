@@ -0,0 +1,166 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace argosClient {
+
+  /**
+   * A bounded lock-free FIFO queue for several producers and consumers
+   * Every slot carries a sequence number telling whether it is ready to be
+   * written or read in the current lap, so producers and consumers only contend
+   * on their own position (D. Vyukov's bounded MPMC queue)
+   * The capacity is rounded up to a power of two
+   */
+  template<typename T>
+  class BoundedQueue {
+  public:
+    /**
+     * Constructs a new empty queue
+     * @param capacity The minimum number of elements the queue can hold
+     */
+    BoundedQueue(size_t capacity) {
+      _capacity = 2;
+      while(_capacity < capacity)
+        _capacity <<= 1;
+
+      _mask = _capacity - 1;
+      _slots = new Slot[_capacity];
+      for(size_t i = 0; i < _capacity; ++i) {
+        _slots[i].sequence.store(i, std::memory_order_relaxed);
+      }
+
+      _enqueuePos.store(0, std::memory_order_relaxed);
+      _dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Destroys the queue and any element left in it
+     */
+    ~BoundedQueue() {
+      delete [] _slots;
+    }
+
+    /**
+     * Appends an element, never blocks
+     * @param value The element to append
+     * @return false if the queue is full
+     */
+    bool tryPush(T value) {
+      Slot* slot;
+      size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+
+      while(true) {
+        slot = &_slots[pos & _mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+
+        if(diff == 0) {
+          if(_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        }
+        else if(diff < 0) {
+          return false;
+        }
+        else {
+          pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+      }
+
+      slot->value = std::move(value);
+      slot->sequence.store(pos + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    /**
+     * Takes the oldest element, never blocks
+     * @param value Where to move the element to
+     * @return false if the queue is empty
+     */
+    bool tryPop(T& value) {
+      Slot* slot;
+      size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+
+      while(true) {
+        slot = &_slots[pos & _mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+
+        if(diff == 0) {
+          if(_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+        }
+        else if(diff < 0) {
+          return false;
+        }
+        else {
+          pos = _dequeuePos.load(std::memory_order_relaxed);
+        }
+      }
+
+      value = std::move(slot->value);
+      slot->value = T();
+      slot->sequence.store(pos + _mask + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    /**
+     * Checks whether the queue is empty
+     * Only a hint when other threads are pushing or popping
+     * @return true if there was no element at the time of the call
+     */
+    bool empty() const {
+      return size() == 0;
+    }
+
+    /**
+     * Gets the number of elements in the queue
+     * Only a hint when other threads are pushing or popping
+     * @return the number of elements at the time of the call
+     */
+    size_t size() const {
+      size_t enqueued = _enqueuePos.load(std::memory_order_acquire);
+      size_t dequeued = _dequeuePos.load(std::memory_order_acquire);
+      return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    /**
+     * Gets the maximum number of elements of the queue
+     * @return the capacity of the queue
+     */
+    size_t capacity() const {
+      return _capacity;
+    }
+
+  private:
+    BoundedQueue(const BoundedQueue&);
+    BoundedQueue& operator=(const BoundedQueue&);
+
+    /**
+     * An element of the queue and its sequence number
+     */
+    struct Slot {
+      std::atomic<size_t> sequence; ///< The position this slot is waiting for
+      T value; ///< The element
+    };
+
+    static const size_t CACHE_LINE = 64; ///< Keeps producers and consumers on different cache lines
+
+    Slot* _slots; ///< The ring of slots
+    size_t _capacity; ///< The number of slots
+    size_t _mask; ///< The mask turning a position into a slot index
+    char _pad0[CACHE_LINE];
+    std::atomic<size_t> _enqueuePos; ///< The next position to write
+    char _pad1[CACHE_LINE];
+    std::atomic<size_t> _dequeuePos; ///< The next position to read
+    char _pad2[CACHE_LINE];
+  };
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef CAMERACAPTURE_H
+#define CAMERACAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+
+#include "FrameSource.h"
+
+namespace argosClient {
+
+  /**
+   * Grabs frames from a FrameSource continuously on its own thread
+   * Frames are captured into a pool of three preallocated slots used as a triple
+   * buffer: the capture thread always owns one, the reader owns another and the
+   * third holds the newest published frame, swapped atomically. Nobody ever waits
+   * for the other side and the reader always gets the newest frame
+   */
+  class CameraCapture {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * A captured frame
+     */
+    struct Frame {
+      cv::Mat image; ///< The image, reused from capture to capture
+      unsigned long sequence; ///< The number of the frame since the capture started (from 1)
+      Clock::time_point timestamp; ///< When the frame was grabbed
+    };
+
+    static const int POOL_SIZE = 3; ///< The number of preallocated frames
+
+  public:
+    /**
+     * Constructs a new capture for an opened source
+     * @param source The source to grab from. It must outlive the capture
+     */
+    CameraCapture(FrameSource& source);
+
+    /**
+     * Stops the capture thread
+     */
+    ~CameraCapture();
+
+    /**
+     * Starts the capture thread
+     */
+    void start();
+
+    /**
+     * Stops the capture thread and waits for it
+     */
+    void stop();
+
+    /**
+     * Takes the newest frame captured since the last call
+     * Only one thread may take frames
+     * @param timeoutMilliseconds The maximum time to wait if there is no new frame yet (0 does not wait)
+     * @return the frame, valid until the next call, or nullptr if no new frame arrived
+     */
+    const Frame* acquireLatest(int timeoutMilliseconds = 0);
+
+    /**
+     * Gets the number of frames grabbed since the start
+     * @return the number of frames
+     */
+    unsigned long getCapturedCount() const;
+
+    /**
+     * Gets the number of frames which were replaced by a newer one before being taken
+     * @return the number of frames
+     */
+    unsigned long getDroppedCount() const;
+
+  private:
+    CameraCapture(const CameraCapture&);
+    CameraCapture& operator=(const CameraCapture&);
+
+    /**
+     * The loop run by the capture thread
+     */
+    void runThread();
+
+  private:
+    static const int NEW_FRAME = 0x4; ///< Set in the published slot until the reader takes it
+
+    FrameSource& _source; ///< The source to grab from
+    Frame _frames[POOL_SIZE]; ///< The pool of frames
+    int _backSlot; ///< The slot being captured into (capture thread only)
+    int _frontSlot; ///< The slot owned by the reader (reader thread only)
+    std::atomic<int> _publishedSlot; ///< The newest frame, ORed with NEW_FRAME if it was not taken yet
+    std::atomic<unsigned long> _captured; ///< The number of grabbed frames
+    std::atomic<unsigned long> _dropped; ///< The number of frames never taken
+    std::atomic<bool> _running; ///< Whether the capture thread should keep grabbing or not
+    std::thread _thread; ///< The capture thread
+    std::mutex _mutex; ///< Only used to sleep while waiting for a frame
+    std::condition_variable _frameReady; ///< Signaled when a frame is published
+  };
+
+}
+
+#endif
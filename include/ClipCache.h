@@ -0,0 +1,76 @@
+#ifndef CLIPCACHE_H
+#define CLIPCACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "Singleton.h"
+#include "VideoClip.h"
+
+namespace argosClient {
+
+  /**
+   * The cache of pre-decoded video clips
+   * Short overlay videos are converted to clips the first time they are requested
+   * and every component playing the same video shares the same mapping
+   */
+  class ClipCache : public Singleton<ClipCache> {
+    using VideoClipPtr = std::shared_ptr<VideoClip>;
+
+  public:
+    /**
+     * Constructs a new clip cache
+     */
+    ClipCache();
+
+    /**
+     * Sets the directory where the clip files are stored
+     * @param path The directory path of the clip files
+     */
+    void setCachePath(const std::string& path);
+
+    /**
+     * Sets the maximum size of a clip file
+     * Longer videos are not cached and must be decoded as usual
+     * @param bytes The maximum size in bytes of a clip file
+     */
+    void setMaxClipBytes(size_t bytes);
+
+    /**
+     * Retrieves the clip for a video file, building it if it does not exist or
+     * if it is older than the video file
+     * @param videoFile The path of the video file
+     * @return the mapped clip, or nullptr if the video can not be cached
+     */
+    VideoClipPtr get(const std::string& videoFile);
+
+    /**
+     * Builds the clip for a video file without mapping it
+     * @param videoFile The path of the video file
+     * @return true if the clip is up to date
+     */
+    bool build(const std::string& videoFile);
+
+    /**
+     * Releases every mapped clip not used by anyone else
+     */
+    void purge();
+
+  private:
+    /**
+     * Gets the path of the clip file for a video file
+     * @param videoFile The path of the video file
+     * @return the path of the clip file
+     */
+    std::string clipFileFor(const std::string& videoFile) const;
+
+  private:
+    std::map<std::string, VideoClipPtr> _clips; ///< An associative list of mapped clips indexed by their video file
+    std::string _cachePath; ///< The directory where the clip files are stored
+    size_t _maxClipBytes; ///< The maximum size of a clip file
+  };
+
+}
+
+#endif
@@ -4,7 +4,11 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
+#include <string>
+#include <opencv2/core/core.hpp>
+#ifndef ARGOS_HEADLESS
 #include <bcm_host.h>
+#endif
 
 #include "EGLconfig.h"
 
@@ -12,9 +16,15 @@ namespace argosClient {
 
   /**
    * A virtual EGL Window class used to initialize the OpenGL ES 2.0 context
+   * On the Pi the surface is a dispmanx element. Built with ARGOS_HEADLESS, it is
+   * an offscreen pbuffer on Mesa (llvmpipe, GBM or any EGL driver) instead, so the
+   * client and the benchmarks also run on ordinary Linux machines
    */
   class EGLWindow {
   public:
+    static const uint32_t HEADLESS_WIDTH = 1280; ///< The default pbuffer width without a display
+    static const uint32_t HEADLESS_HEIGHT = 720; ///< The default pbuffer height without a display
+
     /**
      * Constructs a new OpenGL ES 2.0 context
      * @param config The config we want for the context. If NULL, a default
@@ -38,6 +48,12 @@ namespace argosClient {
      */
     virtual void swapBuffers() const;
 
+    /**
+     * Sets the minimum number of vertical blanks between buffer swaps
+     * @param interval 0 to swap as soon as possible, 1 to sync with every refresh of the display
+     */
+    virtual void setSwapInterval(int interval);
+
     /**
      * Resizes the screen with origin at 0,0
      * @param w The width of the screen
@@ -90,6 +106,23 @@ namespace argosClient {
      */
     virtual EGLContext& getEGLContext();
 
+    /**
+     * Reads the pixels rendered so far in the current frame
+     * @param frame The BGR image to fill, top row first
+     * @return true if the pixels could be read
+     */
+    bool readPixels(cv::Mat& frame) const;
+
+    /**
+     * Writes some of the rendered frames to image files, before swapping buffers
+     * The files are encoded by the TaskPool, only the read back is on the render thread. Frames
+     * are skipped while MAX_PENDING_CAPTURES of them are still being encoded
+     * @param pattern The file names, with one %d or %0<width>d replaced by the frame number, e.g. "frames/%05d.png".
+     * Empty to stop capturing, an invalid pattern is refused
+     * @param every Capture one frame out of every
+     */
+    void setFrameCapture(const std::string& pattern, unsigned int every = 1);
+
   protected:
     /**
      * Make a new surface
@@ -103,9 +136,11 @@ namespace argosClient {
     EGLContext _context; ///< The current EGL context
     EGLconfig* _config; ///< The EGL config for this window
 
+#ifndef ARGOS_HEADLESS
     DISPMANX_ELEMENT_HANDLE_T _dispmanElement; ///< The dispmanx representation of a visual object
     DISPMANX_DISPLAY_HANDLE_T _dispmanDisplay; ///< The dispmanx 'handle' on the display
     DISPMANX_UPDATE_HANDLE_T _dispmanUpdate; ///< The dispmanx transaction object
+#endif
 
   private:
     /**
@@ -118,8 +153,31 @@ namespace argosClient {
      */
     void makeSurface(uint32_t x, uint32_t y, uint32_t w, uint32_t h);
 
+    /**
+     * Gets the EGL display of the backend
+     * @return the display, EGL_NO_DISPLAY on failure
+     */
+    EGLDisplay getDisplay() const;
+
+    /**
+     * Creates the surface of the backend for the chosen config
+     * @return the surface, EGL_NO_SURFACE on failure
+     */
+    EGLSurface createSurface(EGLConfig config, uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+
+    /**
+     * Writes the current frame if it has to be captured
+     */
+    void captureFrame() const;
+
     bool _activeSurface; ///< Whether we have an active surface or not
     bool _upscale; ///< Whether to upscale the screen or not
+    std::string _capturePattern; ///< The file names of the captured frames, empty if not capturing
+    std::string _capturePrefix; ///< The file name before the frame number
+    std::string _captureSuffix; ///< The file name after the frame number
+    int _captureDigits; ///< The width the frame number is padded with zeros to
+    unsigned int _captureEvery; ///< Capture one frame out of every
+    mutable unsigned int _frameNumber; ///< The frames swapped since the capture started
   };
 
 }
@@ -0,0 +1,136 @@
+#ifndef ETC1TEXTURE_H
+#define ETC1TEXTURE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace argosClient {
+
+  /**
+   * An image compressed to ETC1 (OES_compressed_ETC1_RGB8_texture), ready for glCompressedTexImage2D
+   * Every 4x4 block of pixels takes 8 bytes, half a byte per pixel instead of 3 for RGB.
+   * ETC1 has no alpha, so the alpha channel of an image is compressed as a second, grey
+   * texture. Textures are stored on disk as PKM files, one after the other for mipmaps
+   *
+   *      PKM header         Block 0    Block 1          Block N-1
+   * +------------------+----------+----------+-----+-----------+
+   * |     16 bytes     | 8 bytes  | 8 bytes  | ... |  8 bytes  |  Level 0
+   * +------------------+----------+----------+-----+-----------+
+   * |                           ...                            |  Level 1...
+   *
+   * Blocks are stored row by row, the header and the blocks are big-endian
+   */
+  class Etc1Texture {
+  public:
+    /**
+     * The channels of an image compressed into a texture
+     */
+    enum Plane {
+      COLOR, ///< The RGB channels (the grey channel of a luminance image)
+      ALPHA  ///< The alpha channel, replicated into RGB
+    };
+
+  public:
+    /**
+     * Constructs a new empty texture
+     */
+    Etc1Texture();
+
+    /**
+     * Compresses a plane of an image as the next mipmap level
+     * @param pixels The pixels, tightly packed
+     * @param width The width of the image
+     * @param height The height of the image
+     * @param channels The number of channels (1 to 4)
+     * @param plane The channels to compress
+     */
+    void encode(const unsigned char* pixels, int width, int height, int channels, Plane plane);
+
+    /**
+     * Loads a PKM file
+     * @param pkmFile The path of the file
+     * @return true if the file is a valid ETC1 PKM file, false otherwise
+     */
+    bool load(const std::string& pkmFile);
+
+    /**
+     * Saves the texture as a PKM file
+     * @param pkmFile The path of the file
+     * @return true if the file was written, false otherwise
+     */
+    bool save(const std::string& pkmFile) const;
+
+    /**
+     * Checks whether the texture holds an image
+     * @return true after encode() or a successful load()
+     */
+    bool isEmpty() const;
+
+    /**
+     * Gets the number of mipmap levels
+     * @return the number of levels, 0 for an empty texture
+     */
+    int getLevelCount() const;
+
+    /**
+     * Gets the width of a level
+     * @param level The mipmap level
+     * @return the width in pixels
+     */
+    int getWidth(int level = 0) const;
+
+    /**
+     * Gets the height of a level
+     * @param level The mipmap level
+     * @return the height in pixels
+     */
+    int getHeight(int level = 0) const;
+
+    /**
+     * Gets the compressed blocks of a level
+     * @param level The mipmap level
+     * @return a pointer to the first block
+     */
+    const unsigned char* getData(int level = 0) const;
+
+    /**
+     * Gets the size of the compressed blocks of a level, as given to glCompressedTexImage2D
+     * @param level The mipmap level
+     * @return the size in bytes
+     */
+    size_t getSize(int level = 0) const;
+
+    /**
+     * Gets the size of all the levels
+     * @return the size in bytes
+     */
+    size_t getTotalSize() const;
+
+    /**
+     * Checks whether an image uses its alpha channel
+     * @param pixels The pixels, tightly packed
+     * @param width The width of the image
+     * @param height The height of the image
+     * @param channels The number of channels (1 to 4)
+     * @return true if some pixel is not opaque
+     */
+    static bool hasAlpha(const unsigned char* pixels, int width, int height, int channels);
+
+  private:
+    /**
+     * A mipmap level
+     */
+    struct Level {
+      int width; ///< The width of the level
+      int height; ///< The height of the level
+      std::vector<unsigned char> data; ///< The compressed blocks
+    };
+
+    std::vector<Level> _levels; ///< The mipmap levels, the full size first
+  };
+
+}
+
+#endif
@@ -1,11 +1,22 @@
 #ifndef EVENTMANAGER_H
 #define EVENTMANAGER_H
 
-#include <deque>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include "BoundedQueue.h"
 #include "Singleton.h"
 
 namespace argosClient {
 
+  struct paper_t;
+
+  /**
+   * The queue of events posted by other threads to the main thread
+   * Any thread may post events without locking. The main thread takes them in
+   * FIFO order and only sleeps on a condition variable when the queue is empty
+   */
   class EventManager : public Singleton<EventManager> {
   public:
     enum EventType {
@@ -14,15 +25,68 @@ namespace argosClient {
       TD_THREAD_FINISHED = 1
     };
 
+    /**
+     * An event and its payload
+     */
+    struct Event {
+      EventType type; ///< The type of the event
+      unsigned long frameId; ///< The camera frame the event refers to (0 if none)
+      std::shared_ptr<const paper_t> paper; ///< The paper computed for that frame, if any
+
+      Event(EventType type = NONE, unsigned long frameId = 0, std::shared_ptr<const paper_t> paper = nullptr)
+        : type(type), frameId(frameId), paper(paper) {}
+    };
+
+    static const unsigned int MAX_EVENTS = 16; ///< The capacity of the queue
+
   public:
-    void addEvent(EventType ev);
-    EventType popEvent();
+    /**
+     * Constructs a new empty event queue
+     */
+    EventManager();
+
+    /**
+     * Posts an event, never blocks
+     * @param ev The event to post
+     * @return false if the queue was full and the event was dropped
+     */
+    bool addEvent(const Event& ev);
+
+    /**
+     * Takes the oldest event, never blocks
+     * @return the event, or an event of type NONE if the queue is empty
+     */
+    Event popEvent();
+
+    /**
+     * Takes the oldest event, sleeping until one arrives or the timeout expires
+     * @param timeoutMicroseconds The maximum time to wait (0 does not wait at all)
+     * @return the event, or an event of type NONE if the timeout expired
+     */
+    Event waitEvent(long timeoutMicroseconds);
+
+    /**
+     * Drops every pending event
+     */
     void clearQueue();
+
+    /**
+     * Prints the state of the queue
+     */
     void visualizeQueue();
 
+    /**
+     * Gets the number of events dropped because the queue was full
+     * @return the number of dropped events since the start
+     */
+    unsigned long getOverflowCount() const;
+
   private:
-    std::deque<EventType> _eventsQueue;
-    const unsigned int MAX_EVENTS = 10;
+    BoundedQueue<Event> _eventsQueue; ///< The pending events
+    std::atomic<unsigned long> _overflows; ///< The number of events dropped because the queue was full
+    std::atomic<bool> _waiting; ///< Whether the consumer is sleeping or about to
+    std::mutex _mutex; ///< Only used to sleep and wake up the consumer
+    std::condition_variable _eventAdded; ///< Signaled when an event is posted to a sleeping consumer
   };
 
 }
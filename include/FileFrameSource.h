@@ -0,0 +1,47 @@
+#ifndef FILEFRAMESOURCE_H
+#define FILEFRAMESOURCE_H
+
+#include <chrono>
+
+#include "FrameSource.h"
+
+namespace argosClient {
+
+  /**
+   * Frames read from a video file or an image sequence, paced like a camera
+   * The file starts again when it ends, so it can feed the client forever
+   */
+  class FileFrameSource : public FrameSource {
+  public:
+    static const float DEFAULT_FPS; ///< The rate used if neither the user nor the file set one
+
+  public:
+    /**
+     * Constructs a new file source
+     * @param path The video file, or an image sequence pattern such as img_%04d.jpg
+     * @param fps The rate frames are delivered at (0 uses the rate of the file)
+     * @param width The width of the frames, they are resized if needed
+     * @param height The height of the frames, they are resized if needed
+     */
+    FileFrameSource(const std::string& path, float fps, int width, int height);
+
+    bool open() override;
+    bool isOpened() const override;
+    bool grab() override;
+    void retrieve(cv::Mat& image) override;
+    void release() override;
+    std::string getName() const override;
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    std::string _path; ///< The path of the file
+    float _fps; ///< The rate frames are delivered at
+    cv::VideoCapture _reader; ///< The file reader
+    cv::Mat _frame; ///< The last frame read
+    Clock::time_point _nextFrame; ///< When the next frame is due
+  };
+
+}
+
+#endif
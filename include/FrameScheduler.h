@@ -0,0 +1,102 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <chrono>
+
+namespace argosClient {
+
+  /**
+   * Paces the main loop to a target frame rate
+   * The loop asks for the time left until the next frame and sleeps on events
+   * meanwhile, instead of rendering as fast as it can
+   * It also keeps frame time and CPU usage statistics, logged periodically
+   */
+  class FrameScheduler {
+  public:
+    static const float DEFAULT_FPS; ///< The frame rate used if no other is set
+    static const float REPORT_SECONDS; ///< The time between two statistics reports
+
+  public:
+    /**
+     * Constructs a new scheduler
+     * @param fps The target frame rate (0 renders as fast as possible)
+     */
+    FrameScheduler(float fps = DEFAULT_FPS);
+
+    /**
+     * Sets the target frame rate
+     * @param fps The target frame rate (0 renders as fast as possible)
+     */
+    void setTargetFps(float fps);
+
+    /**
+     * Gets the target frame rate
+     * @return the target frame rate
+     */
+    float getTargetFps() const;
+
+    /**
+     * Gets the time left until the next frame should be rendered
+     * @return the time in microseconds, 0 if the frame is already due
+     */
+    long getTimeToDeadline() const;
+
+    /**
+     * Checks whether the next frame should be rendered now
+     * @return true if the frame is due
+     */
+    bool isFrameDue() const;
+
+    /**
+     * Marks the start of a frame
+     */
+    void beginFrame();
+
+    /**
+     * Marks the end of a frame, schedules the next one and updates the statistics
+     */
+    void endFrame();
+
+    /**
+     * Gets the average time spent rendering a frame in the last report period
+     * @return the time in milliseconds
+     */
+    float getAverageFrameTime() const;
+
+    /**
+     * Gets the CPU usage of the whole process in the last report period
+     * @return the usage as a percentage of one core
+     */
+    float getCpuUsage() const;
+
+  private:
+    /**
+     * Logs the statistics of the last period and starts a new one
+     */
+    void report();
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::duration _period; ///< The time between two frames (0 if not paced)
+    Clock::time_point _deadline; ///< When the next frame should be rendered
+    Clock::time_point _frameStart; ///< When the current frame started
+
+    Clock::time_point _fpsStart; ///< When the current frame rate second started
+    int _fpsFrames; ///< The number of frames rendered in the current frame rate second
+
+    Clock::time_point _periodStart; ///< When the current report period started
+    double _processCpuStart; ///< The process CPU time when the period started (seconds)
+    double _threadCpuStart; ///< The main thread CPU time when the period started (seconds)
+    int _frames; ///< The number of frames rendered in the current period
+    Clock::duration _frameTime; ///< The time spent rendering in the current period
+    Clock::duration _maxFrameTime; ///< The longest frame in the current period
+    int _lateFrames; ///< The number of frames which missed their deadline in the current period
+
+    float _averageFrameTime; ///< The average frame time of the last period (ms)
+    float _cpuUsage; ///< The process CPU usage of the last period (% of a core)
+  };
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <string>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+namespace argosClient {
+
+  /**
+   * A source of camera frames
+   * Every backend delivers BGR frames of the requested size (or the closest one
+   * the device supports) through the grab/retrieve pair used by OpenCV
+   */
+  class FrameSource {
+  public:
+    /**
+     * Constructs a new frame source
+     * @param width The requested width of the frames
+     * @param height The requested height of the frames
+     */
+    FrameSource(int width, int height) : _width(width), _height(height) {}
+
+    /**
+     * Destroys the frame source
+     */
+    virtual ~FrameSource() {}
+
+    /**
+     * Opens the source
+     * @return true if the source could be opened
+     */
+    virtual bool open() = 0;
+
+    /**
+     * Checks whether the source is opened or not
+     * @return true if the source is opened
+     */
+    virtual bool isOpened() const = 0;
+
+    /**
+     * Waits for the next frame of the source
+     * @return false if no frame could be obtained
+     */
+    virtual bool grab() = 0;
+
+    /**
+     * Decodes the last grabbed frame
+     * The image is reused if it already has the right size and type
+     * @param image The BGR image to fill
+     */
+    virtual void retrieve(cv::Mat& image) = 0;
+
+    /**
+     * Closes the source
+     */
+    virtual void release() = 0;
+
+    /**
+     * Gets a description of the source for the logs
+     * @return the description
+     */
+    virtual std::string getName() const = 0;
+
+    /**
+     * Gets the width of the frames
+     * @return the width of the frames
+     */
+    int getWidth() const { return _width; }
+
+    /**
+     * Gets the height of the frames
+     * @return the height of the frames
+     */
+    int getHeight() const { return _height; }
+
+    /**
+     * Builds a frame source from its description
+     *   raspicam                  The Raspberry Pi camera module
+     *   v4l2[:/dev/videoN]        A Video4Linux2 device (/dev/video0 by default)
+     *   file:<path>[@fps]         A video file or an image sequence such as img_%04d.jpg
+     *   synthetic[:fps]           A generated test pattern (30 fps by default)
+     * @param spec The description of the source
+     * @param width The requested width of the frames
+     * @param height The requested height of the frames
+     * @return the frame source, or nullptr if the description is not valid
+     */
+    static std::unique_ptr<FrameSource> create(const std::string& spec, int width, int height);
+
+    /**
+     * Gets the description of the default source for this build
+     * @return the description
+     */
+    static std::string getDefaultSpec();
+
+  protected:
+    int _width; ///< The width of the frames
+    int _height; ///< The height of the frames
+  };
+
+}
+
+#endif
@@ -13,9 +13,11 @@ namespace argosClient {
 
   class GraphicComponentsManager;
   class AudioManager;
+  class SoundScheduler;
   class ScriptFunction;
   class ImageComponent;
   class RectangleComponent;
+  class MetricsOverlay;
 
   /**
    * The OpenGL ES 2.0 context
@@ -63,9 +65,22 @@ namespace argosClient {
 
     /**
      * Sets up specific properties for the context
+     * The images and sounds are decoded on the TaskPool and uploaded as drainMainQueue() runs
      */
     void start() override;
 
+    /**
+     * Checks whether the images and sounds queued by start() are all loaded
+     * @return true once every asset is ready
+     */
+    bool isLoaded() const;
+
+    /**
+     * Shows or hides the metrics overlay
+     * @param show Whether the overlay is drawn
+     */
+    void showMetrics(bool show);
+
     void setIsVideoStreaming(int isVideostream);
     int isVideoStreaming() const;
 
@@ -80,8 +95,10 @@ namespace argosClient {
     std::map<int, ScriptFunction*> _handlers; ///< An associative list of function pointer to script functions
     GraphicComponentsManager& _gcManager; ///< A reference to the GraphicComponentsManager
     AudioManager& _audioManager;
+    SoundScheduler& _soundScheduler; ///< A reference to the SoundScheduler, for the sounds played in sequence
     ImageComponent* _projArea;
     RectangleComponent* _fingerPoint;
+    MetricsOverlay* _metricsOverlay; ///< The heads-up display of the metrics (nullptr if hidden)
     bool _pointsFlags[7];
 
     ImageComponent* _videoButtonInv[2];
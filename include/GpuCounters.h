@@ -0,0 +1,190 @@
+#ifndef GPUCOUNTERS_H
+#define GPUCOUNTERS_H
+
+#include <map>
+#include <string>
+#include <GLES2/gl2.h>
+
+#include "Timer.h"
+
+namespace argosClient {
+
+  /**
+   * The GPU work submitted during a frame
+   */
+  struct GpuCounts {
+    unsigned long drawCalls; ///< glDrawArrays and glDrawElements calls
+    unsigned long vertices; ///< Vertices submitted by the draw calls
+    unsigned long programSwitches; ///< glUseProgram calls changing the program
+    unsigned long textureBinds; ///< glBindTexture calls
+    unsigned long blendToggles; ///< glEnable and glDisable calls of GL_BLEND
+    unsigned long uploadedBytes; ///< Bytes uploaded with glTexImage2D and glTexSubImage2D
+    unsigned long fboPasses; ///< Passes rendered into a framebuffer object
+
+    GpuCounts();
+
+    /**
+     * Adds other counts to these
+     * @param counts The counts to add
+     */
+    void add(const GpuCounts& counts);
+  };
+
+  /**
+   * Counts the GPU work of every frame, in total and per GCCollection
+   * Components call the GL functions through the wrappers below instead of
+   * directly, which costs a couple of increments per call. Everything happens on
+   * the render thread, so nothing is synchronized
+   */
+  class GpuCounters {
+  public:
+    static const char* const NO_COLLECTION; ///< The name given to the work outside any collection
+
+  public:
+    static void drawArrays(GLenum mode, GLint first, GLsizei count) {
+      glDrawArrays(mode, first, count);
+      countDraw(count);
+    }
+
+    static void drawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices) {
+      glDrawElements(mode, count, type, indices);
+      countDraw(count);
+    }
+
+    static void useProgram(GLuint program) {
+      glUseProgram(program);
+      if(program != currentProgram) {
+        currentProgram = program;
+        frame.programSwitches++;
+        current->programSwitches++;
+      }
+    }
+
+    static void bindTexture(GLenum target, GLuint texture) {
+      glBindTexture(target, texture);
+      frame.textureBinds++;
+      current->textureBinds++;
+    }
+
+    static void setBlend(bool enable) {
+      if(enable)
+        glEnable(GL_BLEND);
+      else
+        glDisable(GL_BLEND);
+      frame.blendToggles++;
+      current->blendToggles++;
+    }
+
+    static void texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                           GLint border, GLenum format, GLenum type, const GLvoid* pixels) {
+      glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+      if(pixels)
+        countUpload((unsigned long) width * height * bytesPerPixel(format, type));
+    }
+
+    static void compressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                                     GLint border, GLsizei imageSize, const GLvoid* data) {
+      glCompressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, data);
+      countUpload(imageSize);
+    }
+
+    static void texSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                              GLenum format, GLenum type, const GLvoid* pixels) {
+      glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+      countUpload((unsigned long) width * height * bytesPerPixel(format, type));
+    }
+
+    /**
+     * Counts a pass rendered into a framebuffer object
+     */
+    static void countFboPass() {
+      frame.fboPasses++;
+      current->fboPasses++;
+    }
+
+    /**
+     * Gets the size of a pixel
+     * @param format The pixel format, e.g. GL_RGB
+     * @param type The component type, e.g. GL_UNSIGNED_BYTE
+     * @return the bytes taken by a pixel
+     */
+    static unsigned int bytesPerPixel(GLenum format, GLenum type);
+
+    /**
+     * Starts rendering a frame, whose counts already hold the work done since the previous one
+     */
+    static void beginFrame();
+
+    /**
+     * Ends the frame, its counts become the ones returned by the getters and the next frame starts at zero
+     */
+    static void endFrame();
+
+    /**
+     * Attributes the following work to a collection
+     * @param name The name of the collection
+     */
+    static void beginCollection(const std::string& name);
+
+    /**
+     * Attributes the following work to no collection
+     */
+    static void endCollection();
+
+    /**
+     * Gets the counts of the last complete frame
+     * @return the total counts
+     */
+    static const GpuCounts& getFrameCounts();
+
+    /**
+     * Gets the counts of every collection rendered in the last complete frame
+     * @return the counts by collection name
+     */
+    static std::map<std::string, GpuCounts> getCollectionCounts();
+
+    /**
+     * Sets how often the counts are written to the log
+     * @param seconds The time between two reports (0 to disable them)
+     */
+    static void setReportSeconds(float seconds);
+
+    /**
+     * Logs the counts of the last frame and of its busiest collections, then the GPU memory
+     */
+    static void report();
+
+  private:
+    static void countDraw(GLsizei vertices) {
+      frame.drawCalls++;
+      frame.vertices += vertices;
+      current->drawCalls++;
+      current->vertices += vertices;
+    }
+
+    static void countUpload(unsigned long bytes) {
+      frame.uploadedBytes += bytes;
+      current->uploadedBytes += bytes;
+    }
+
+    /**
+     * The counts of a collection
+     */
+    struct CollectionCounts {
+      GpuCounts building; ///< The counts of the frame being rendered
+      GpuCounts last; ///< The counts of the last complete frame
+      bool rendered; ///< Whether the collection was rendered in the current frame
+    };
+
+    static GpuCounts frame; ///< The counts of the frame being rendered
+    static GpuCounts lastFrame; ///< The counts of the last complete frame
+    static GpuCounts* current; ///< Where the work is attributed
+    static std::map<std::string, CollectionCounts> collections; ///< The counts of every collection
+    static GLuint currentProgram; ///< The program in use
+    static float reportSeconds; ///< The time between two reports (0 if disabled)
+    static Timer reportTimer; ///< Measures the time since the last report
+  };
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef GPUMEMORYTRACKER_H
+#define GPUMEMORYTRACKER_H
+
+#include <map>
+#include <string>
+#include <GLES2/gl2.h>
+
+namespace argosClient {
+
+  /**
+   * Accounts the texture and renderbuffer memory held by every GCCollection
+   * Components create and delete their GL objects through the wrappers below.
+   * Every object is owned by the collection being created, updated or rendered
+   * when it is generated, and by its document through the "id:<n>" part of the
+   * collection name. Everything happens on the render thread, so nothing is synchronized
+   */
+  class GpuMemoryTracker {
+  public:
+    static const char* const NO_OWNER; ///< The owner of the objects created outside any collection
+    static const unsigned long DEFAULT_BUDGET = 64 * 1024 * 1024; ///< The default budget in bytes
+    static const unsigned long HIGH_WATER_STEP = 1024 * 1024; ///< The growth logged as a new high-water mark
+
+    /**
+     * The memory held by a collection or a document
+     */
+    struct Usage {
+      unsigned long bytes; ///< The bytes held now
+      unsigned long peakBytes; ///< The most bytes ever held
+      unsigned int objects; ///< The textures, renderbuffers and framebuffers held now
+
+      Usage() : bytes(0), peakBytes(0), objects(0) {}
+    };
+
+    /**
+     * Attributes the GL objects generated during its lifetime to a collection
+     */
+    class Scope {
+    public:
+      /**
+       * @param owner The name of the collection, which must outlive the scope
+       */
+      Scope(const std::string& owner);
+      ~Scope();
+
+    private:
+      const std::string* _previous; ///< The owner to restore
+    };
+
+  public:
+    /**
+     * Gets the owner of the objects generated now, to be restored by a Scope in a later continuation
+     * @return the name of the collection, NO_OWNER outside any collection
+     */
+    static const std::string& getOwner();
+
+    static void genTextures(GLsizei n, GLuint* textures);
+    static void deleteTextures(GLsizei n, const GLuint* textures);
+    static void genFramebuffers(GLsizei n, GLuint* framebuffers);
+    static void deleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+    static void genRenderbuffers(GLsizei n, GLuint* renderbuffers);
+    static void deleteRenderbuffers(GLsizei n, const GLuint* renderbuffers);
+
+    /**
+     * Allocates the storage of the bound renderbuffer
+     * @param renderbuffer The bound renderbuffer
+     * @param internalFormat The renderbuffer format, e.g. GL_DEPTH_COMPONENT16
+     * @param width The width in pixels
+     * @param height The height in pixels
+     */
+    static void renderbufferStorage(GLuint renderbuffer, GLenum internalFormat, GLsizei width, GLsizei height);
+
+    /**
+     * Records the size of a texture after its level 0 was (re)specified with glTexImage2D
+     * Textures generated by libraries are adopted by the current owner
+     * @param texture The texture
+     * @param width The width in pixels
+     * @param height The height in pixels
+     * @param format The pixel format, e.g. GL_RGB
+     * @param type The component type, e.g. GL_UNSIGNED_BYTE
+     * @param mipmaps Whether the mipmaps of the texture were generated, a third more memory
+     */
+    static void textureStorage(GLuint texture, GLsizei width, GLsizei height, GLenum format, GLenum type, bool mipmaps = false);
+
+    /**
+     * Records the size of a texture after its level 0 was specified with glCompressedTexImage2D
+     * @param texture The texture
+     * @param imageSize The size in bytes of the compressed image
+     */
+    static void compressedTextureStorage(GLuint texture, GLsizei imageSize);
+
+    /**
+     * Forgets a texture which was deleted by a library
+     * @param texture The texture
+     */
+    static void textureDeleted(GLuint texture);
+
+    /**
+     * Sets the memory over which a warning is logged
+     * @param bytes The budget in bytes (0 to disable the warning)
+     */
+    static void setBudget(unsigned long bytes);
+
+    /**
+     * Gets the bytes held by all the tracked objects
+     * @return the bytes held now
+     */
+    static unsigned long getTotalBytes();
+
+    /**
+     * Gets the most bytes ever held by the tracked objects
+     * @return the high-water mark
+     */
+    static unsigned long getPeakBytes();
+
+    /**
+     * Gets the memory held by every collection
+     * @return the usage by collection name
+     */
+    static const std::map<std::string, Usage>& getCollectionUsage();
+
+    /**
+     * Gets the memory held by every document
+     * @return the usage by document id
+     */
+    static const std::map<int, Usage>& getDocumentUsage();
+
+    /**
+     * Logs the memory held in total and by the biggest collections and documents
+     */
+    static void report();
+
+  private:
+    enum Kind { TEXTURE, FRAMEBUFFER, RENDERBUFFER };
+
+    /**
+     * A tracked GL object
+     */
+    struct Allocation {
+      std::string owner; ///< The collection owning the object
+      unsigned long bytes; ///< The bytes held by the object
+    };
+
+    typedef std::pair<Kind, GLuint> Key;
+
+    /**
+     * Starts tracking objects for the current owner
+     */
+    static void generated(Kind kind, GLsizei n, const GLuint* names);
+
+    /**
+     * Stops tracking objects and releases their memory
+     */
+    static void deleted(Kind kind, GLsizei n, const GLuint* names);
+
+    /**
+     * Changes the bytes held by an object, adopting it if unknown
+     */
+    static void resize(Kind kind, GLuint name, unsigned long bytes);
+
+    /**
+     * Adds bytes and objects to an owner, its document and the total
+     */
+    static void account(const std::string& owner, long bytes, int objects);
+
+    /**
+     * Gets the document of a collection
+     * @return the document id, or -1 if the collection belongs to no document
+     */
+    static int documentOf(const std::string& owner);
+
+    static const std::string* owner; ///< The owner of the objects generated now, not copied as scopes are opened every frame
+    static std::map<Key, Allocation> allocations; ///< Every tracked object
+    static std::map<std::string, Usage> collections; ///< The memory held by every collection
+    static std::map<int, Usage> documents; ///< The memory held by every document
+    static unsigned long totalBytes; ///< The bytes held now
+    static unsigned long peakBytes; ///< The most bytes ever held
+    static unsigned long loggedPeakBytes; ///< The last high-water mark logged
+    static unsigned long budget; ///< The bytes over which a warning is logged
+    static bool overBudget; ///< Whether the budget is crossed now
+  };
+
+}
+
+#endif
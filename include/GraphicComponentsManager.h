@@ -7,6 +7,7 @@
 #include <memory>
 #include "Singleton.h"
 #include "GCCollection.h"
+#include "TextureFit.h"
 
 #include <glm/glm.hpp>
 
@@ -21,6 +22,8 @@ namespace argosClient {
     using GCCollectionMap = std::map<std::string, GCCollectionPtr>;
 
   public:
+    static const float NEAREST_PAGE_DISTANCE; ///< The closest a page gets to the projector, in the units of the page (cm)
+
     /**
      * Constructs a new GraphicComponentManager
      */
@@ -79,6 +82,24 @@ namespace argosClient {
      */
     void setProjectionMatrix(const glm::mat4& projectionMatrix);
 
+    /**
+     * Sets the resolution of the projector, which bounds the size of the image textures
+     * @param width The width in pixels
+     * @param height The height in pixels
+     */
+    void setScreenSize(int width, int height);
+
+    /**
+     * Computes how an image is resized to the most pixels it can cover
+     * A projected image is closest to the projector at NEAREST_PAGE_DISTANCE and gets
+     * mipmaps, as it shrinks as the page moves away. A flat image covers a fixed
+     * part of the screen
+     * @param size The size of the image, as given to its ImageComponent
+     * @param flat Whether the image is drawn without the projection matrix
+     * @return the fit of the image
+     */
+    TextureFit getTextureFit(const glm::vec2& size, bool flat) const;
+
     /**
      * Sets the images directory path
      * @param path The path where the image files are located
@@ -199,6 +220,8 @@ namespace argosClient {
     std::string _imagesPath; ///< The image files directory
     std::string _videosPath; ///< The video files directory
     std::string _fontsPath; ///< The font files directory
+    int _screenWidth; ///< The width of the projector in pixels, 0 if unknown
+    int _screenHeight; ///< The height of the projector in pixels, 0 if unknown
   };
 
 }
@@ -2,11 +2,14 @@
 #define IMAGE_H
 
 #include <string>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <GLES2/gl2.h>
 
 #include "GraphicComponent.h"
 #include "GfxProgram.h"
+#include "Etc1Texture.h"
+#include "TextureFit.h"
 
 namespace argosClient {
 
@@ -37,12 +40,25 @@ namespace argosClient {
      */
     ~ImageComponent();
 
+    /**
+     * Sets how the images loaded from now on are resized and whether they get mipmaps
+     * @param fit The fit, the images are kept as they are by default
+     */
+    void setTextureFit(const TextureFit& fit);
+
     /**
      * Loads an image from disk
      * @param file_name The path of the image file to load
      */
     void loadImageFromFile(const std::string& file_name);
 
+    /**
+     * Loads an image from disk on the TaskPool and uploads it on the render thread
+     * Nothing is drawn until the image is ready
+     * @param file_name The path of the image file to load
+     */
+    void loadImageFromFileAsync(const std::string& file_name);
+
     /**
      * Loads an image from an incoming OpenCV::Mat
      * @param mat A reference to a OpenCV::Mat to load
@@ -54,6 +70,12 @@ namespace argosClient {
      */
     void deleteTexture();
 
+    /**
+     * Checks whether the texture holds the image
+     * @return true once the image is uploaded
+     */
+    bool isLoaded() const;
+
   private:
     /**
      * The specific logic used to draw this graphic component
@@ -65,12 +87,54 @@ namespace argosClient {
      */
     void setUpShader() override;
 
+    /**
+     * Decodes an image on the TaskPool and uploads it uncompressed on the render thread
+     * @param file_name The path of the image file
+     */
+    void decodeImageAsync(const std::string& file_name);
+
+    /**
+     * Uploads an image already decoded in the AssetBundle
+     * @param file_name The path of the image file
+     * @return true if the bundle holds the image, false if it has to be decoded
+     */
+    bool loadImageFromBundle(const std::string& file_name);
+
+    /**
+     * Creates the texture of the image
+     * @param buffer The pixels, tightly packed
+     * @param width The width of the image
+     * @param height The height of the image
+     * @param channels The number of channels (1 to 4)
+     */
+    void uploadTexture(const unsigned char* buffer, int width, int height, int channels);
+
+    /**
+     * Creates the ETC1 textures of the image
+     * @param color The colour plane
+     * @param alpha The alpha plane, empty for opaque images
+     */
+    void uploadCompressedTexture(const Etc1Texture& color, const Etc1Texture& alpha);
+
+    /**
+     * Creates a texture and sets its filtering, leaving it bound
+     * @param mipmaps Whether the texture is sampled from its mipmaps
+     * @return the texture
+     */
+    GLuint createTexture(bool mipmaps);
+
   private:
     GLushort* _indices; ///< Indices defining the shared vertex of the triangles
     GLfloat* _vertexData; ///< Positions of the vertex and their uv mapping
     GLfloat _width; ///< The width of this graphic component
     GLfloat _height; ///< The height of this graphic component
     GLuint _textureId; ///< The OpenGL texture id used to render the image
+    GLuint _alphaTextureId; ///< The alpha plane of an ETC1 image with alpha, 0 otherwise
+    GLint _alphaSamplerHandler; ///< Handler of the alpha plane sampler
+    GLint _alphaPlaneHandler; ///< Handler of the flag telling whether the alpha plane is used
+    bool _loaded; ///< Whether the texture holds the image or not
+    TextureFit _textureFit; ///< How the images are resized before their upload
+    std::shared_ptr<bool> _alive; ///< Expires with the component, so pending loads know it is gone
   };
 
 }
@@ -0,0 +1,42 @@
+#ifndef JPEGDECODER_H
+#define JPEGDECODER_H
+
+#include <cstddef>
+#include <opencv2/opencv.hpp>
+
+namespace argosClient {
+
+  /**
+   * A JPEG decoder built on libjpeg
+   * It uses the DCT scaling of libjpeg (1/2, 1/4 or 1/8) to decode straight to the
+   * smallest size still covering the requested one, so small overlays do not pay
+   * for decoding and uploading full size frames
+   */
+  class JpegDecoder {
+  public:
+    /**
+     * Decodes a JPEG image as RGB
+     * The output buffer is reused when the decoded size does not change
+     * @param data The compressed image
+     * @param size The size in bytes of the compressed image
+     * @param targetWidth The width the image will be shown at (0 to decode at full size)
+     * @param targetHeight The height the image will be shown at (0 to decode at full size)
+     * @param output The decoded image
+     * @return true if the image could be decoded
+     */
+    static bool decode(const unsigned char* data, size_t size, int targetWidth, int targetHeight, cv::Mat& output);
+
+    /**
+     * Chooses the scale denominator for an image
+     * @param width The width of the image
+     * @param height The height of the image
+     * @param targetWidth The width the image will be shown at (0 to decode at full size)
+     * @param targetHeight The height the image will be shown at (0 to decode at full size)
+     * @return the largest denominator among 1, 2, 4 and 8 which keeps the image larger than the target
+     */
+    static int scaleDenominator(int width, int height, int targetWidth, int targetHeight);
+  };
+
+}
+
+#endif
@@ -2,15 +2,60 @@
 #define LOG_H
 
 #include <string>
-#include <iostream>
 #include <vector>
-#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Messages below this level are removed at compile time when logged through the
+ * ARGOS_LOG_* macros (make LOG_LEVEL=1 drops the debug ones)
+ */
+#ifndef ARGOS_LOG_MIN_LEVEL
+#define ARGOS_LOG_MIN_LEVEL 0
+#endif
+
+/**
+ * The message is only built if its level is enabled, so these macros are the way
+ * to log anything expensive to format. The _EVERY variants log at most once every
+ * given seconds per call site, for messages written every frame
+ */
+#define ARGOS_LOG(level, function, msg) \
+  do { \
+    if((level) >= ARGOS_LOG_MIN_LEVEL && argosClient::Log::isEnabled(level)) \
+      argosClient::Log::function(msg); \
+  } while(0)
+
+#define ARGOS_LOG_EVERY(seconds, level, function, msg) \
+  do { \
+    static std::atomic<int64_t> argosLogLast(0); \
+    if((level) >= ARGOS_LOG_MIN_LEVEL && argosClient::Log::isEnabled(level) && \
+       argosClient::Log::allowEvery(argosLogLast, seconds)) \
+      argosClient::Log::function(msg); \
+  } while(0)
+
+#define ARGOS_LOG_DEBUG(msg) ARGOS_LOG(argosClient::Log::LEVEL_DEBUG, debug, msg)
+#define ARGOS_LOG_VIDEO(msg) ARGOS_LOG(argosClient::Log::LEVEL_DEBUG, video, msg)
+#define ARGOS_LOG_INFO(msg) ARGOS_LOG(argosClient::Log::LEVEL_INFO, info, msg)
+#define ARGOS_LOG_SUCCESS(msg) ARGOS_LOG(argosClient::Log::LEVEL_INFO, success, msg)
+#define ARGOS_LOG_ERROR(msg) ARGOS_LOG(argosClient::Log::LEVEL_ERROR, error, msg)
+
+#define ARGOS_LOG_DEBUG_EVERY(seconds, msg) ARGOS_LOG_EVERY(seconds, argosClient::Log::LEVEL_DEBUG, debug, msg)
+#define ARGOS_LOG_VIDEO_EVERY(seconds, msg) ARGOS_LOG_EVERY(seconds, argosClient::Log::LEVEL_DEBUG, video, msg)
+#define ARGOS_LOG_INFO_EVERY(seconds, msg) ARGOS_LOG_EVERY(seconds, argosClient::Log::LEVEL_INFO, info, msg)
+#define ARGOS_LOG_SUCCESS_EVERY(seconds, msg) ARGOS_LOG_EVERY(seconds, argosClient::Log::LEVEL_INFO, success, msg)
+#define ARGOS_LOG_ERROR_EVERY(seconds, msg) ARGOS_LOG_EVERY(seconds, argosClient::Log::LEVEL_ERROR, error, msg)
 
 namespace argosClient {
 
+  class LogWriter;
+
   /**
    * A utility class for logging
    * It's capable to provide coloured output and a timestamp with every message
+   * Messages are only queued by the calling thread; a background thread formats
+   * the timestamps and writes them to the console and the log files. A full queue
+   * drops messages instead of blocking
    */
   class Log {
   public:
@@ -45,36 +90,54 @@ namespace argosClient {
       BG_BLUE             = 44,
     };
 
+    /**
+     * The importance of a message
+     * debug, video and function messages are LEVEL_DEBUG
+     * plain, info, success, vector and matrix messages are LEVEL_INFO
+     */
+    enum Level {
+      LEVEL_DEBUG         = 0,
+      LEVEL_INFO          = 1,
+      LEVEL_ERROR         = 2,
+      LEVEL_OFF           = 3
+    };
+
   public:
     /**
      * Logs a message using simple output, i.e. no colours
      * @param msg The message to output
      */
-    static void plain(const std::string& msg, const std::string& filename = "");
+    static void plain(std::string msg, const std::string& filename = "");
+
+    /**
+     * Logs a debug message (dark gray)
+     * @param msg The message to output
+     */
+    static void debug(std::string msg, const std::string& filename = "");
 
     /**
      * Logs an info message (blue)
      * @param msg The message to output
      */
-    static void info(const std::string& msg, const std::string& filename = "");
+    static void info(std::string msg, const std::string& filename = "");
 
     /**
      * Logs an error message (red)
      * @param msg The message to output
      */
-    static void error(const std::string& msg, const std::string& filename = "");
+    static void error(std::string msg, const std::string& filename = "");
 
     /**
      * Logs a success message (green)
      * @param msg The message to output
      */
-    static void success(const std::string& msg, const std::string& filename = "");
+    static void success(std::string msg, const std::string& filename = "");
 
     /**
      * Logs a video message (yellow)
      * @param msg The message to output
      */
-    static void video(const std::string& msg, const std::string& filename = "");
+    static void video(std::string msg, const std::string& filename = "");
 
     /**
      * Logs a function message (magenta)
@@ -110,76 +173,88 @@ namespace argosClient {
      */
     static void setColouredOutput(bool coloured);
 
+    /**
+     * Sets the lowest level logged, LEVEL_INFO by default
+     * @param level The lowest level logged
+     */
+    static void setLevel(Level level);
+
+    /**
+     * Parses a level name
+     * @param name debug, info, error or off
+     * @param level Where to store the level
+     * @return false if the name is unknown
+     */
+    static bool parseLevel(const std::string& name, Level& level);
+
+    /**
+     * Checks whether messages of a level are logged
+     * @param level The level of the message
+     * @return true if the message would be logged
+     */
+    static bool isEnabled(Level level) {
+      return level >= minLevel.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Rate limits a call site, used by the ARGOS_LOG_*_EVERY macros
+     * @param last When the call site last logged (monotonic nanoseconds)
+     * @param seconds The minimum time between two messages
+     * @return true if the message may be logged now
+     */
+    static bool allowEvery(std::atomic<int64_t>& last, float seconds);
+
+    /**
+     * Waits until every queued message has been written
+     */
+    static void flush();
+
   private:
+    /**
+     * Queues a message for the writer thread
+     * @param level The level of the message
+     * @param colour The colour of the message
+     * @param tag The tag after the timestamp, e.g. "[INFO]" (a literal)
+     * @param text The message
+     * @param filename A file to append the message to (empty if none)
+     */
+    static void enqueue(Level level, Colour colour, const char* tag, std::string&& text, const std::string& filename);
+
+  private:
+    friend class LogWriter;
+
     static bool coloured_output; ///< Whether the log should be coloured or not
+    static std::atomic<int> minLevel; ///< The lowest level logged
   };
 
   template<typename T>
   void Log::vector(const std::vector<T>& vec, Colour color, const std::string& filename) {
-    if(coloured_output)
-      std::cout << "\033[" << color << "m";
+    if(!isEnabled(LEVEL_INFO))
+      return;
 
-    std::cout << currentDateTime() << " [VECTOR] \n";
-    std::cout << "                      [";
+    std::ostringstream text;
+    text << "\n                      [";
     typename std::vector<T>::const_iterator i;
     for(i = vec.begin(); i != vec.end(); ++i)
-      std::cout << *i << ' ';
-    std::cout << "]" << std::endl;
-
-    if(coloured_output)
-      std::cout << "\033[" << Colour::FG_DEFAULT << "m";
-
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [VECTOR] \n";
-      ofs << "                      [";
-      for(i = vec.begin(); i != vec.end(); ++i)
-        ofs << *i << ' ';
-      ofs << "]" << std::endl;
-      ofs.close();
-    }
+      text << *i << ' ';
+    text << "]";
+
+    enqueue(LEVEL_INFO, color, "[VECTOR]", text.str(), filename);
   }
 
   template<typename T>
   void Log::matrix(const T* matrix, Colour color, const std::string& filename) {
-    if(coloured_output)
-      std::cout << "\033[" << color << "m";
+    if(!isEnabled(LEVEL_INFO))
+      return;
 
-    std::cout << currentDateTime() << " [MATRIX] \n";
+    std::ostringstream text;
     for(int i = 0; i < 16; i += 4) {
-      std::cout << "                      [";
-      std::cout << matrix[i] << " " << matrix[i+1] << " " << matrix[i+2] << " " << matrix[i+3];
-      std::cout << "]" << std::endl;
+      text << "\n                      [";
+      text << matrix[i] << " " << matrix[i+1] << " " << matrix[i+2] << " " << matrix[i+3];
+      text << "]";
     }
 
-    if(coloured_output)
-      std::cout << "\033[" << Colour::FG_DEFAULT << "m";
-
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [MATRIX] \n";
-      for(int i = 0; i < 16; i += 4) {
-        ofs << "                      [";
-        ofs << matrix[i] << " " << matrix[i+1] << " " << matrix[i+2] << " " << matrix[i+3];
-        ofs << "]" << std::endl;
-      }
-      ofs.close();
-    }
-
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      for(int i = 0; i < 16; i += 4) {
-        if(i < 4) {
-          ofs << currentDateTime() << " [ ";
-        }
-        else {
-          ofs << "                      [ ";
-        }
-        ofs << matrix[i] << " " << matrix[i+1] << " " << matrix[i+2] << " " << matrix[i+3];
-        ofs << " ] " << std::endl;
-      }
-      ofs.close();
-    }
+    enqueue(LEVEL_INFO, color, "[MATRIX]", text.str(), filename);
   }
 
 }
@@ -0,0 +1,185 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "Singleton.h"
+#include "Timer.h"
+
+namespace argosClient {
+
+  /**
+   * A value which only grows, e.g. bytes sent
+   */
+  class Counter {
+  public:
+    Counter() : _value(0) {}
+
+    /**
+     * Increments the counter
+     * @param amount The amount to add
+     */
+    void add(uint64_t amount = 1) { _value.fetch_add(amount, std::memory_order_relaxed); }
+
+    /**
+     * Gets the value of the counter
+     * @return the total added so far
+     */
+    uint64_t get() const { return _value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> _value; ///< The total added so far
+  };
+
+  /**
+   * A value which is set from time to time, e.g. the frame rate
+   */
+  class Gauge {
+  public:
+    Gauge() : _value(0.0) {}
+
+    /**
+     * Sets the value of the gauge
+     * @param value The new value
+     */
+    void set(double value) { _value.store(value, std::memory_order_relaxed); }
+
+    /**
+     * Gets the value of the gauge
+     * @return the last value set
+     */
+    double get() const { return _value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<double> _value; ///< The last value set
+  };
+
+  /**
+   * The distribution of a measure, e.g. the frame time
+   * Percentiles are computed over the last WINDOW samples
+   */
+  class Histogram {
+  public:
+    static const size_t WINDOW = 1024; ///< The number of samples kept
+
+    /**
+     * The percentiles of a histogram at some point
+     */
+    struct Snapshot {
+      uint64_t count; ///< The number of samples ever recorded
+      double p50; ///< The median of the window
+      double p95; ///< The 95th percentile of the window
+      double p99; ///< The 99th percentile of the window
+      double max; ///< The largest sample of the window
+    };
+
+  public:
+    Histogram();
+
+    /**
+     * Adds a sample
+     * @param value The measured value
+     */
+    void record(double value);
+
+    /**
+     * Computes the percentiles of the recent samples
+     * @return the count and percentiles (all 0 without samples)
+     */
+    Snapshot snapshot() const;
+
+  private:
+    std::vector<double> _samples; ///< The ring of recent samples
+    uint64_t _count; ///< The number of samples ever recorded
+    mutable std::mutex _mutex; ///< Protects the samples
+  };
+
+  /**
+   * The registry of every metric of the client
+   * Metrics are created on first use and live as long as the registry, so the
+   * references returned can be kept, e.g. in a function-local static
+   * Snapshots are exported periodically in InfluxDB line protocol to a file
+   * (rewritten atomically every time) or to a UDP listener
+   */
+  class Metrics : public Singleton<Metrics> {
+  public:
+    static const float DEFAULT_EXPORT_SECONDS; ///< The time between two exports if none is given
+
+  public:
+    /**
+     * Constructs the registry, nothing is exported until setExport() is called
+     */
+    Metrics();
+
+    /**
+     * Gets a counter, creating it if needed
+     * @param name The name of the counter
+     * @return the counter
+     */
+    Counter& counter(const std::string& name);
+
+    /**
+     * Gets a gauge, creating it if needed
+     * @param name The name of the gauge
+     * @return the gauge
+     */
+    Gauge& gauge(const std::string& name);
+
+    /**
+     * Gets a histogram, creating it if needed
+     * @param name The name of the histogram
+     * @return the histogram
+     */
+    Histogram& histogram(const std::string& name);
+
+    /**
+     * Formats every metric in InfluxDB line protocol, one line per metric
+     * @return the lines, tagged with the host name
+     */
+    std::string toLineProtocol();
+
+    /**
+     * Sets where the metrics are exported to
+     * @param spec "file:<path>" or "udp:<host>:<port>"
+     * @param seconds The time between two exports
+     * @return false if the spec is not valid
+     */
+    bool setExport(const std::string& spec, float seconds = DEFAULT_EXPORT_SECONDS);
+
+    /**
+     * Exports the metrics if the export period has elapsed
+     * The writing itself runs on the task pool
+     */
+    void exportIfDue();
+
+  private:
+    /**
+     * Writes the lines to the export destination
+     * @param lines The formatted metrics
+     */
+    void write(const std::string& lines);
+
+  private:
+    std::map<std::string, std::unique_ptr<Counter>> _counters; ///< The counters by name
+    std::map<std::string, std::unique_ptr<Gauge>> _gauges; ///< The gauges by name
+    std::map<std::string, std::unique_ptr<Histogram>> _histograms; ///< The histograms by name
+    std::mutex _mutex; ///< Protects the maps, not the metrics
+    std::string _host; ///< The host tag of every line
+
+    std::string _exportPath; ///< The file to export to (empty if not exporting to a file)
+    std::string _exportHost; ///< The UDP host to export to (empty if not exporting over UDP)
+    std::string _exportPort; ///< The UDP port to export to
+    float _exportSeconds; ///< The time between two exports (0 if not exporting)
+    Timer _exportTimer; ///< Measures the time since the last export
+    std::atomic<bool> _exporting; ///< Whether an export is being written
+  };
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef METRICSOVERLAY_H
+#define METRICSOVERLAY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "Timer.h"
+
+namespace argosClient {
+
+  class TextComponent;
+
+  /**
+   * A heads-up display of the key metrics in the top left corner of the projection
+   * The text is rebuilt once per second, rendering it in between is cheap
+   */
+  class MetricsOverlay {
+  public:
+    static const int FONT_SIZE = 20; ///< The font size in pixels
+    static const int LINES = 4; ///< The number of text lines
+
+  public:
+    /**
+     * Constructs the overlay, an OpenGL context must be current
+     * @param fontFile The font to use
+     * @param screenWidth The width of the screen in pixels
+     * @param screenHeight The height of the screen in pixels
+     */
+    MetricsOverlay(const std::string& fontFile, uint32_t screenWidth, uint32_t screenHeight);
+
+    /**
+     * Destroys the overlay
+     */
+    ~MetricsOverlay();
+
+    /**
+     * Refreshes the text if a second has passed and draws it
+     */
+    void render();
+
+  private:
+    /**
+     * Reads the metrics and rebuilds the text
+     * @param seconds The time since the previous refresh
+     */
+    void refresh(double seconds);
+
+  private:
+    std::vector<std::unique_ptr<TextComponent>> _lines; ///< One text component per line
+    Timer _refreshTimer; ///< Measures the time since the last refresh
+    uint64_t _lastBytesSent; ///< The bytes sent at the last refresh
+    uint64_t _lastBytesReceived; ///< The bytes received at the last refresh
+  };
+
+}
+
+#endif
@@ -9,6 +9,7 @@
 namespace argosClient {
 
   class AudioManager;
+  class SoundScheduler;
 
   class PlaySoundDelayedSF : public ScriptFunction {
   public:
@@ -18,6 +19,7 @@ namespace argosClient {
 
   private:
     AudioManager& _audioManager;
+    SoundScheduler& _soundScheduler;
   };
 
 }
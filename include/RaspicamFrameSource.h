@@ -0,0 +1,35 @@
+#ifndef RASPICAMFRAMESOURCE_H
+#define RASPICAMFRAMESOURCE_H
+
+#include <raspicam/raspicam_cv.h>
+
+#include "FrameSource.h"
+
+namespace argosClient {
+
+  /**
+   * The Raspberry Pi camera module, through raspicam
+   */
+  class RaspicamFrameSource : public FrameSource {
+  public:
+    /**
+     * Constructs a new camera source
+     * @param width The width of the frames
+     * @param height The height of the frames
+     */
+    RaspicamFrameSource(int width, int height);
+
+    bool open() override;
+    bool isOpened() const override;
+    bool grab() override;
+    void retrieve(cv::Mat& image) override;
+    void release() override;
+    std::string getName() const override;
+
+  private:
+    raspicam::RaspiCam_Cv _camera; ///< The internal camera
+  };
+
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef SOUNDSCHEDULER_H
+#define SOUNDSCHEDULER_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+#include "Singleton.h"
+
+namespace argosClient {
+
+  class AudioManager;
+
+  /**
+   * Plays sounds at a given time and sounds one after the other, without waiting
+   * The pending sounds are kept in a timer wheel of SLOT_COUNT slots of SLOT_MS each, a sound
+   * further than a turn of the wheel waits for some rounds in its slot. tick() moves the wheel
+   * and starts the next sound of every sequence whose channel finished. Speech which is not
+   * synthesised yet waits aside, with the rest of its sequence, until the TtsCache has it
+   * It belongs to the render thread: scheduling and tick() are only called from there, the
+   * audio thread just flags the finished channels
+   */
+  class SoundScheduler : public Singleton<SoundScheduler> {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const int SLOT_MS = 10; ///< The time covered by a slot of the wheel
+    static const int SLOT_COUNT = 256; ///< The slots of the wheel, a turn takes 2.56 s
+
+    /**
+     * Constructs a new sound scheduler, hooked to the channels of the mixer
+     */
+    SoundScheduler();
+
+    /**
+     * Destroys the sound scheduler
+     */
+    ~SoundScheduler();
+
+    /**
+     * Plays a sound at a given time, right away if it already passed
+     * @param file_name The file to play, or "tts:<lang>:<text>" for synthesised speech
+     * @param time When the sound is played
+     * @param loops The number of times to play it again (-1 infinite)
+     */
+    void playAt(const std::string& file_name, Clock::time_point time, int loops = 0);
+
+    /**
+     * Plays a sound after a delay
+     * @param file_name The file to play
+     * @param delayMs The delay in milliseconds, 0 to play it right away
+     * @param loops The number of times to play it again (-1 infinite)
+     */
+    void playIn(const std::string& file_name, int delayMs, int loops = 0);
+
+    /**
+     * Plays some sounds one after the other, each one starts when the previous one finishes
+     * @param file_names The files to play, in order
+     */
+    void playSequence(const std::vector<std::string>& file_names);
+
+    /**
+     * Cancels the pending sounds and sequences and stops the playing sounds
+     */
+    void stopAll();
+
+    /**
+     * Plays the sounds which are due and the next sound of the finished sequences
+     * It never waits, it is meant to be called once per iteration of the main loop
+     */
+    void tick();
+
+    /**
+     * Gets the time left until tick() has something to do
+     * @return the time in microseconds, LONG_MAX if nothing is pending
+     */
+    long getTimeToNextTick() const;
+
+    /**
+     * Checks whether some sound or sequence is still pending
+     * @return true if there is nothing left to play
+     */
+    bool isIdle() const;
+
+  private:
+    /**
+     * A sound waiting in the wheel
+     */
+    struct Sound {
+      std::string fileName; ///< The file to play
+      int loops; ///< The number of times to play it again
+      int rounds; ///< The turns of the wheel left before it is due
+    };
+
+    /**
+     * The sounds of a sequence not played yet
+     */
+    struct Sequence {
+      std::vector<std::string> fileNames; ///< The files of the sequence
+      size_t next; ///< The index of the next file to play
+    };
+
+    /**
+     * Called by SDL_mixer when a channel finishes, on the audio thread or from a halt
+     * It must not call SDL_mixer, it only flags the channel for tick()
+     * @param channel The channel
+     */
+    static void channelFinished(int channel);
+
+    /**
+     * Gets the current time on the clock of the wheel
+     * @return the time in milliseconds
+     */
+    static int64_t nowMilliseconds();
+
+    /**
+     * Plays a sound file, or a text of the TtsCache if it is named "tts:<lang>:<text>"
+     * @param file_name The file to play
+     * @param loops The number of times to play it again (-1 infinite)
+     * @return the channel playing the sound, TtsCache::PENDING if it is speech not ready yet, -1 if it failed
+     */
+    int start(const std::string& file_name, int loops);
+
+    /**
+     * Plays a single sound, speech which is not ready yet waits until it is
+     * @param file_name The file to play
+     * @param loops The number of times to play it again (-1 infinite)
+     */
+    void playSound(const std::string& file_name, int loops);
+
+    /**
+     * Checks how far a speech sound is
+     * @param file_name The sound name, other sounds are never waited for
+     * @param ready Receives whether it can be played now
+     * @return true if it is still being synthesised or loaded
+     */
+    static bool isWaiting(const std::string& file_name, bool& ready);
+
+    /**
+     * Plays the waiting speech which became ready and drops the speech which failed
+     */
+    void resumeWaiting();
+
+    /**
+     * Plays the next sound of a sequence and keeps the rest on its channel
+     * A sequence still kept on that channel has finished, it is continued as well
+     * @param sequence The sequence
+     */
+    void playNext(Sequence sequence);
+
+    /**
+     * Moves the wheel one slot and plays the sounds due in it
+     */
+    void advance();
+
+  private:
+    AudioManager& _audioManager; ///< A reference to the AudioManager
+    std::vector<Sound> _slots[SLOT_COUNT]; ///< The wheel, the sounds due in every slot
+    int _current; ///< The slot the wheel is at
+    int64_t _wheelTime; ///< When the current slot started, in milliseconds
+    int _pending; ///< The sounds waiting in the wheel
+    std::map<int, Sequence> _sequences; ///< The rest of every sequence, indexed by the channel playing it
+    std::vector<Sound> _waitingSounds; ///< The speech sounds due but not synthesised yet
+    std::vector<Sequence> _waitingSequences; ///< The sequences whose next sound is speech not synthesised yet
+  };
+
+}
+
+#endif
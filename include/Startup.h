@@ -0,0 +1,107 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <map>
+#include <string>
+#include <future>
+#include <memory>
+#include <functional>
+
+#include "Timer.h"
+
+namespace argosClient {
+
+  /**
+   * Runs the startup steps of the client side by side and reports how long it took to come up
+   * Blocking steps (opening the camera, connecting to the server) get a thread of their
+   * own, so they neither wait for each other nor hold a TaskPool worker; the assets are
+   * decoded on the TaskPool meanwhile and uploaded by the render thread
+   */
+  class Startup {
+  public:
+    typedef std::function<bool()> Step;
+
+  public:
+    /**
+     * Constructs a new startup, its clock starts now
+     */
+    Startup();
+
+    /**
+     * Runs a step on the calling thread
+     * @param name The name of the step
+     * @param step The step, returning whether it succeeded
+     * @return the result of the step
+     */
+    bool run(const std::string& name, const Step& step);
+
+    /**
+     * Starts a step on a thread of its own
+     * @param name The name of the step
+     * @param step The step, returning whether it succeeded
+     */
+    void start(const std::string& name, const Step& step);
+
+    /**
+     * Waits for a step started with start()
+     * @param name The name of the step
+     * @return the result of the step, false if there is no such step
+     */
+    bool wait(const std::string& name);
+
+    /**
+     * Checks whether a step started with start() ended, without waiting
+     * @param name The name of the step
+     * @return true if the step ended or there is no such step
+     */
+    bool isDone(const std::string& name) const;
+
+    /**
+     * Records that the assets are loaded, only the first call counts
+     */
+    void assetsLoaded();
+
+    /**
+     * Checks whether the assets are loaded
+     * @return true after assetsLoaded() was called
+     */
+    bool areAssetsLoaded() const;
+
+    /**
+     * Records that the first frame was rendered and logs how long every step took
+     * Only the first call counts
+     */
+    void firstFrame();
+
+    /**
+     * Checks whether the first frame was rendered
+     * @return true after firstFrame() was called
+     */
+    bool isFirstFrameDone() const;
+
+  private:
+    /**
+     * The timing of a step
+     */
+    struct StepTimes {
+      double startMs; ///< When the step started
+      double endMs; ///< When the step ended
+      std::shared_future<bool> result; ///< The result of a step run on its own thread
+      std::shared_ptr<double> threadEndMs; ///< When a step run on its own thread ended, set by that thread
+    };
+
+    /**
+     * Gets the time since the startup began
+     * @return the elapsed milliseconds
+     */
+    double now() const;
+
+    Timer _clock; ///< Started with the startup
+    std::map<std::string, StepTimes> _steps; ///< The steps, run or started
+    double _assetsMs; ///< When the assets were loaded (negative until then)
+    double _firstFrameMs; ///< When the first frame was rendered (negative until then)
+  };
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SYNTHETICFRAMESOURCE_H
+#define SYNTHETICFRAMESOURCE_H
+
+#include <chrono>
+
+#include "FrameSource.h"
+
+namespace argosClient {
+
+  /**
+   * A generated test pattern delivered at a fixed rate
+   * A moving bar and the frame number change every frame, so the whole capture,
+   * encode and send path can be profiled without any camera
+   */
+  class SyntheticFrameSource : public FrameSource {
+  public:
+    static const float DEFAULT_FPS; ///< The rate used if none is given
+
+  public:
+    /**
+     * Constructs a new pattern generator
+     * @param fps The rate frames are delivered at (0 delivers them as fast as possible)
+     * @param width The width of the frames
+     * @param height The height of the frames
+     */
+    SyntheticFrameSource(float fps, int width, int height);
+
+    bool open() override;
+    bool isOpened() const override;
+    bool grab() override;
+    void retrieve(cv::Mat& image) override;
+    void release() override;
+    std::string getName() const override;
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    float _fps; ///< The rate frames are delivered at
+    bool _opened; ///< Whether the source is opened or not
+    cv::Mat _background; ///< The static part of the pattern
+    unsigned long _frameCount; ///< The number of frames generated
+    Clock::time_point _nextFrame; ///< When the next frame is due
+  };
+
+}
+
+#endif
@@ -9,6 +9,8 @@
 #include <map>
 #include <memory>
 
+#include "CameraCapture.h"
+
 using boost::asio::ip::tcp;
 
 namespace argosClient {
@@ -121,6 +123,14 @@ namespace argosClient {
 
     void start(sig_atomic_t& g_loop);
 
+    /**
+     * Makes the thread take its frames from a capture thread instead of
+     * asking the main thread for them with TD_THREAD_READY events
+     * Must be set before starting
+     * @param capture The camera capture, or nullptr to use injectData()
+     */
+    void setCameraCapture(CameraCapture* capture);
+
     void checkForErrors();
 
     void injectData(cv::Mat mat, paper_t paper);
@@ -219,6 +229,11 @@ namespace argosClient {
      */
     void addCvMat(cv::Mat& mat, int quality = 80);
 
+    /**
+     * Drops the data added to the _buff object and not sent yet
+     */
+    void clearBuffer();
+
     /**
      * Checks the _error variable looking for errors
      * @return < 0 if there was any error
@@ -230,6 +245,14 @@ namespace argosClient {
   private:
     void runThread();
 
+    /**
+     * Accounts the time from a frame capture to its pose, logged every LATENCY_REPORT_FRAMES frames
+     * @param latency The time between the capture and the reception of the paper
+     */
+    void accountLatency(CameraCapture::Clock::duration latency);
+
+    static const int LATENCY_REPORT_FRAMES = 100; ///< The number of frames between two latency reports
+
   private:
     boost::asio::io_service _ioService; ///< The needed I/O service for establishing communications
     std::thread _tdThread; ///< The main task delegation thread
@@ -240,6 +263,11 @@ namespace argosClient {
     std::string _port; ///< The Port of the connected endpoint
     int _error; ///< Control variable used to handle errors
     int _offset; ///< The offset used by "next" functions
+    unsigned long _frameId; ///< The number of the frame being processed, sent with the events
+    CameraCapture* _capture; ///< The capture thread frames are taken from (nullptr if injected)
+    float _latencySum; ///< The sum of the capture to pose latencies since the last report (ms)
+    float _latencyMax; ///< The longest capture to pose latency since the last report (ms)
+    int _latencyCount; ///< The number of latencies since the last report
     paper_t _receivedPaper;
     cv::Mat _receivedMat;
 
@@ -0,0 +1,140 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+
+#include "Singleton.h"
+
+namespace argosClient {
+
+  /**
+   * The pool of worker threads shared by every CPU heavy job of the client
+   * Every worker owns a deque of tasks. Tasks submitted from a worker go to its own
+   * deque and are taken newest first, which keeps related work on the same core;
+   * tasks submitted from other threads are spread over the workers. An idle worker
+   * steals the oldest task of the others before going to sleep
+   * The pool has one worker less than the number of cores, so the render thread
+   * keeps a core for itself
+   * Work that must run on the render thread (anything touching OpenGL) is posted
+   * to the main queue and run by drainMainQueue()
+   */
+  class TaskPool : public Singleton<TaskPool> {
+  public:
+    typedef std::function<void()> Task;
+
+  public:
+    /**
+     * Constructs a new pool and starts its workers
+     */
+    TaskPool();
+
+    /**
+     * Runs the pending tasks and stops every worker
+     */
+    ~TaskPool();
+
+    /**
+     * Queues a task to be run by any worker
+     * @param task The task to run
+     */
+    void post(const Task& task);
+
+    /**
+     * Queues a function to be run by any worker
+     * @param function The function to run
+     * @return a future holding the result of the function
+     */
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> submit(F function) {
+      typedef typename std::result_of<F()>::type Result;
+
+      std::shared_ptr<std::packaged_task<Result()>> task = std::make_shared<std::packaged_task<Result()>>(function);
+      std::future<Result> future = task->get_future();
+      post([task]() { (*task)(); });
+
+      return future;
+    }
+
+    /**
+     * Queues a function to be run by any worker and its continuation to be run
+     * on the render thread with the result
+     * @param function The function to run
+     * @param continuation The function receiving the result, run by drainMainQueue()
+     */
+    template<typename F, typename C>
+    void submitThen(F function, C continuation) {
+      post([this, function, continuation]() {
+        std::shared_ptr<typename std::result_of<F()>::type> result =
+          std::make_shared<typename std::result_of<F()>::type>(function());
+        postToMain([continuation, result]() { continuation(*result); });
+      });
+    }
+
+    /**
+     * Queues a task to be run on the render thread
+     * @param task The task to run
+     */
+    void postToMain(const Task& task);
+
+    /**
+     * Runs the tasks posted to the render thread
+     * Must be called from the render thread
+     * @return the number of tasks run
+     */
+    int drainMainQueue();
+
+    /**
+     * Gets the number of workers of the pool
+     * @return the number of workers
+     */
+    int getWorkerCount() const;
+
+  private:
+    /**
+     * The tasks of a worker
+     */
+    struct WorkerQueue {
+      std::deque<Task> tasks; ///< The pending tasks, the owner takes from the back
+      std::mutex mutex; ///< Protects the tasks
+    };
+
+    /**
+     * The loop run by every worker
+     * @param index The number of the worker
+     */
+    void runWorker(int index);
+
+    /**
+     * Takes a task from the deque of a worker or steals one from the others
+     * @param index The number of the worker
+     * @param task Where to move the task to
+     * @return false if there is no task anywhere
+     */
+    bool takeTask(int index, Task& task);
+
+  private:
+    std::vector<std::thread> _workers; ///< The worker threads
+    std::vector<std::unique_ptr<WorkerQueue>> _queues; ///< The deque of every worker
+    std::atomic<unsigned int> _nextQueue; ///< The deque the next external task goes to
+    std::atomic<int> _pending; ///< The number of queued tasks
+    std::mutex _sleepMutex; ///< Only used to sleep and wake up workers
+    std::condition_variable _taskAdded; ///< Wakes up a worker when a task is queued
+    bool _running; ///< Whether the workers should keep waiting for tasks or not
+
+    std::deque<Task> _mainTasks; ///< The tasks for the render thread
+    std::mutex _mainMutex; ///< Protects the tasks for the render thread
+
+    static thread_local int workerIndex; ///< The number of the calling worker (-1 if not a worker)
+  };
+
+}
+
+#endif
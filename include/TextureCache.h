@@ -0,0 +1,92 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <string>
+
+#include "Singleton.h"
+#include "Etc1Texture.h"
+#include "TextureFit.h"
+
+namespace argosClient {
+
+  /**
+   * The cache of ETC1 compressed images
+   * Images are compressed the first time they are requested, or offline by
+   * tools/argos_etc1, and stored as PKM files next to each other: <name><fit>.pkm for
+   * the colour and <name><fit>_alpha.pkm for the alpha channel of translucent images,
+   * where <fit> is the key of the TextureFit the image was resized with
+   * The configuration is set at startup; get() and build() may then run on any thread
+   */
+  class TextureCache : public Singleton<TextureCache> {
+  public:
+    /**
+     * Constructs a new texture cache, enabled
+     */
+    TextureCache();
+
+    /**
+     * Sets the directory where the PKM files are stored
+     * @param path The directory path of the PKM files
+     */
+    void setCachePath(const std::string& path);
+
+    /**
+     * Enables or disables the compressed textures
+     * They are disabled on GPUs without OES_compressed_ETC1_RGB8_texture
+     * @param enabled Whether the images are uploaded compressed
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * Checks whether the images are uploaded compressed
+     * @return true if the compressed textures are enabled
+     */
+    bool isEnabled() const;
+
+    /**
+     * Retrieves the compressed planes of an image, building them if they do not
+     * exist or if they are older than the image file
+     * @param imageFile The path of the image file
+     * @param fit How the image is resized, and whether it gets mipmaps
+     * @param color Receives the colour plane
+     * @param alpha Receives the alpha plane, left empty for opaque images
+     * @return true if the image is available compressed
+     */
+    bool get(const std::string& imageFile, const TextureFit& fit, Etc1Texture& color, Etc1Texture& alpha) const;
+
+    /**
+     * Builds the compressed planes of an image without loading them
+     * @param imageFile The path of the image file
+     * @param fit How the image is resized, and whether it gets mipmaps
+     * @return true if the PKM files are up to date
+     */
+    bool build(const std::string& imageFile, const TextureFit& fit) const;
+
+  private:
+    /**
+     * Gets the path of the PKM file of a plane of an image
+     * @param imageFile The path of the image file
+     * @param fit How the image is resized
+     * @param plane The plane
+     * @return the path of the PKM file
+     */
+    std::string pkmFileFor(const std::string& imageFile, const TextureFit& fit, Etc1Texture::Plane plane) const;
+
+    /**
+     * Compresses a plane of a resized image and its mipmaps
+     * @param level The resized image
+     * @param mipmaps The mipmap levels, if any
+     * @param plane The plane
+     * @param pkmFile The path of the PKM file
+     * @return true if the file was written
+     */
+    static bool compress(const cv::Mat& level, const std::vector<cv::Mat>& mipmaps, Etc1Texture::Plane plane, const std::string& pkmFile);
+
+  private:
+    std::string _cachePath; ///< The directory where the PKM files are stored
+    bool _enabled; ///< Whether the images are uploaded compressed
+  };
+
+}
+
+#endif
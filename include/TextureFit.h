@@ -0,0 +1,76 @@
+#ifndef TEXTUREFIT_H
+#define TEXTUREFIT_H
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+namespace argosClient {
+
+  /**
+   * How an image is resized before it becomes a texture
+   * Images are shrunk to the most pixels they can cover once projected, and
+   * projected images are resized to power-of-two sizes so they can be mipmapped
+   */
+  class TextureFit {
+  public:
+    /**
+     * Constructs a fit keeping the images as they are
+     */
+    TextureFit();
+
+    /**
+     * Constructs a new fit
+     * @param maxWidth The maximum width of the texture, 0 for no limit
+     * @param maxHeight The maximum height of the texture, 0 for no limit
+     * @param mipmaps Whether the texture gets power-of-two sizes and mipmaps
+     */
+    TextureFit(int maxWidth, int maxHeight, bool mipmaps);
+
+    /**
+     * Computes the size of the texture of an image
+     * @param width The width of the image
+     * @param height The height of the image
+     * @param fitWidth Receives the width of the texture
+     * @param fitHeight Receives the height of the texture
+     */
+    void getSize(int width, int height, int& fitWidth, int& fitHeight) const;
+
+    /**
+     * Checks whether the texture is mipmapped
+     * @return true if the texture gets mipmaps
+     */
+    bool hasMipmaps() const;
+
+    /**
+     * Gets a suffix telling fits apart, for the names of cached textures
+     * @return an empty string for the identity, e.g. "_512x512m" otherwise
+     */
+    std::string getKey() const;
+
+    /**
+     * Resizes an image to the size of its texture
+     * @param pixels The pixels, tightly packed
+     * @param width The width of the image
+     * @param height The height of the image
+     * @param channels The number of channels (1 to 4)
+     * @return the resized image, sharing the pixels if the size does not change
+     */
+    cv::Mat apply(const unsigned char* pixels, int width, int height, int channels) const;
+
+    /**
+     * Computes the mipmap levels below a level, down to 1x1
+     * @param level The level, e.g. the result of apply()
+     * @return the levels, each one half the size of the previous one
+     */
+    static std::vector<cv::Mat> mipmaps(const cv::Mat& level);
+
+  private:
+    int _maxWidth; ///< The maximum width of the texture, 0 for no limit
+    int _maxHeight; ///< The maximum height of the texture, 0 for no limit
+    bool _mipmaps; ///< Whether the texture gets power-of-two sizes and mipmaps
+  };
+
+}
+
+#endif
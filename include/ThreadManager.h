@@ -0,0 +1,121 @@
+#ifndef THREADMANAGER_H
+#define THREADMANAGER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "Singleton.h"
+#include "Timer.h"
+
+namespace argosClient {
+
+  /**
+   * Names, pins and prioritizes the threads of the client
+   * Every thread registers itself with a role. The settings of the role are read
+   * from a YAML file (data/threads.yml):
+   *
+   *   render:
+   *     cores: [ 0 ]     # CPU affinity, every core if missing
+   *     nice: -5         # Nice value for SCHED_OTHER threads
+   *   capture:
+   *     policy: fifo     # SCHED_FIFO, needs CAP_SYS_NICE
+   *     priority: 20     # 1-99
+   *
+   * Threads and child processes inherit the settings of their creator, a role without
+   * cores or nice value gets those the process started with instead
+   * It also reports the CPU time every registered thread has used
+   */
+  class ThreadManager : public Singleton<ThreadManager> {
+  public:
+    static const float REPORT_SECONDS; ///< The time between two CPU time reports
+
+  public:
+    /**
+     * Constructs a new thread manager with no settings
+     */
+    ThreadManager();
+
+    /**
+     * Loads the settings of every role
+     * Threads registered before keep their settings
+     * @param fileName The YAML file
+     * @return true if the file could be read
+     */
+    bool load(const std::string& fileName);
+
+    /**
+     * Names the calling thread and applies the settings of its role
+     * @param role The role of the thread, as named in the settings
+     * @param index The number of the thread when several share a role (-1 if unique)
+     */
+    void registerCurrentThread(const std::string& role, int index = -1);
+
+    /**
+     * Forgets the calling thread, it must be called before the thread exits
+     */
+    void unregisterCurrentThread();
+
+    /**
+     * Gives a child process the cores and nice value the process started with,
+     * instead of those inherited from the thread which spawned it
+     * @param pid The child process
+     */
+    void releaseChild(pid_t pid);
+
+    /**
+     * Logs the CPU time used by every registered thread since the last report
+     */
+    void report();
+
+    /**
+     * Calls report() if REPORT_SECONDS have passed since the last one
+     */
+    void reportIfDue();
+
+  private:
+    /**
+     * The settings of a role
+     */
+    struct ThreadConfig {
+      std::vector<int> cores; ///< The cores the threads may run on (empty for any)
+      bool fifo; ///< Whether the threads use SCHED_FIFO or not
+      int priority; ///< The SCHED_FIFO priority
+      int nice; ///< The nice value of SCHED_OTHER threads
+      bool hasNice; ///< Whether the nice value is set or not
+    };
+
+    /**
+     * A registered thread
+     */
+    struct ThreadInfo {
+      std::string name; ///< The name of the thread
+      clockid_t clock; ///< The CPU time clock of the thread
+      double lastCpu; ///< The CPU time at the last report (seconds)
+    };
+
+    /**
+     * Applies the settings of a role to the calling thread
+     * @param name The name of the thread, for the logs
+     * @param config The settings
+     */
+    void apply(const std::string& name, const ThreadConfig& config);
+
+  private:
+    std::map<std::string, ThreadConfig> _configs; ///< The settings of every role
+    std::map<pthread_t, ThreadInfo> _threads; ///< The registered threads
+    std::mutex _mutex; ///< Protects the settings and the registered threads
+    Timer _reportTimer; ///< The time since the last report
+    bool _permissionWarned; ///< Whether the lack of privileges has been logged already
+    cpu_set_t _defaultCores; ///< The affinity of the process before any thread was registered
+    int _defaultNice; ///< The nice value of the process before any thread was registered
+  };
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+/**
+ * Tracing is only built with ARGOS_TRACE defined (make TRACE=1)
+ * Otherwise the macros expand to nothing and cost nothing
+ *
+ *   ARGOS_TRACE_FRAME(id)    Sets the frame the calling thread is working on
+ *   ARGOS_TRACE_SPAN(name)   Records the time until the end of the scope, name must be a literal
+ */
+#ifdef ARGOS_TRACE
+#define ARGOS_TRACE_CONCAT_(a, b) a##b
+#define ARGOS_TRACE_CONCAT(a, b) ARGOS_TRACE_CONCAT_(a, b)
+#define ARGOS_TRACE_SPAN(name) argosClient::TraceSpan ARGOS_TRACE_CONCAT(_traceSpan, __LINE__)(name)
+#define ARGOS_TRACE_FRAME(id) argosClient::Trace::setCurrentFrame(id)
+#else
+#define ARGOS_TRACE_SPAN(name) do {} while(0)
+#define ARGOS_TRACE_FRAME(id) do {} while(0)
+#endif
+
+namespace argosClient {
+
+  /**
+   * A process wide recorder of timed spans
+   * Spans go to a fixed ring buffer without locks: every writer claims a slot with
+   * an atomic increment, so the newest CAPACITY spans are always available
+   * The buffer is written to a Chrome trace-event JSON file (chrome://tracing or
+   * https://ui.perfetto.dev) on demand, usually on SIGUSR1
+   */
+  class Trace {
+  public:
+    static const size_t CAPACITY = 16384; ///< The number of spans kept
+
+  public:
+    /**
+     * Records a finished span
+     * @param name The name of the span, it must outlive the trace (a literal)
+     * @param startNs When the span started (CLOCK_MONOTONIC nanoseconds)
+     * @param endNs When the span ended (CLOCK_MONOTONIC nanoseconds)
+     */
+    static void record(const char* name, uint64_t startNs, uint64_t endNs);
+
+    /**
+     * Sets the frame the calling thread is working on, attached to its next spans
+     * @param frameId The id of the camera frame
+     */
+    static void setCurrentFrame(unsigned long frameId);
+
+    /**
+     * Gets the frame the calling thread is working on
+     * @return the id of the camera frame
+     */
+    static unsigned long getCurrentFrame();
+
+    /**
+     * Names the calling thread in the trace
+     * @param name The name of the thread
+     */
+    static void setThreadName(const std::string& name);
+
+    /**
+     * Gets the current time of the trace clock
+     * @return CLOCK_MONOTONIC in nanoseconds
+     */
+    static uint64_t now();
+
+    /**
+     * Writes the spans in the buffer as Chrome trace-event JSON
+     * @param fileName The file to write
+     * @return true if the file could be written
+     */
+    static bool dump(const std::string& fileName);
+
+    /**
+     * Asks for a dump at the next dumpIfRequested() call
+     * Safe to call from a signal handler
+     */
+    static void requestDump();
+
+    /**
+     * Writes argos_trace_<time>.json if a dump was requested
+     */
+    static void dumpIfRequested();
+
+  private:
+    /**
+     * A recorded span
+     */
+    struct Span {
+      std::atomic<uint64_t> sequence; ///< Odd while the slot is being written
+      const char* name; ///< The name of the span
+      unsigned long frameId; ///< The frame the span belongs to
+      uint64_t startNs; ///< When the span started
+      uint64_t durationNs; ///< How long the span took
+      int tid; ///< The kernel id of the thread
+    };
+
+    static Span spans[CAPACITY]; ///< The ring of spans
+    static std::atomic<uint64_t> head; ///< The number of spans ever recorded
+    static std::atomic<bool> dumpRequested; ///< Whether a dump was requested
+    static thread_local unsigned long currentFrame; ///< The frame of the calling thread
+    static thread_local int currentTid; ///< The kernel id of the calling thread (0 if unknown yet)
+  };
+
+  /**
+   * Records a span from its construction to its destruction
+   */
+  class TraceSpan {
+  public:
+    /**
+     * Starts the span
+     * @param name The name of the span, it must be a literal
+     */
+    TraceSpan(const char* name) : _name(name), _start(Trace::now()) {}
+
+    /**
+     * Ends and records the span
+     */
+    ~TraceSpan() { Trace::record(_name, _start, Trace::now()); }
+
+  private:
+    TraceSpan(const TraceSpan&);
+    TraceSpan& operator=(const TraceSpan&);
+
+    const char* _name; ///< The name of the span
+    uint64_t _start; ///< When the span started
+  };
+
+}
+
+#endif
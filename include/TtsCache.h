@@ -0,0 +1,179 @@
+#ifndef TTSCACHE_H
+#define TTSCACHE_H
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <sys/types.h>
+
+#include "Singleton.h"
+
+namespace argosClient {
+
+  class AudioManager;
+
+  /**
+   * The cache of synthesised speech, keyed by the language and the text
+   * Every text is synthesised once into <sounds path>tts/<lang>-<hash>.wav, the hash being the
+   * FNV-1a of the language and the text, by a local command run as
+   *   <command> <lang> <text> <output.wav>
+   * The command runs as a child process polled by update(), and the WAV file is then loaded by
+   * the AudioManager on the TaskPool, so nothing waits on the render thread. A text played before
+   * it is ready is kept by the SoundScheduler, which plays it once isReady() says so. Script
+   * functions name these sounds "tts:<lang>:<text>"
+   * It belongs to the render thread, like the AudioManager
+   */
+  class TtsCache : public Singleton<TtsCache> {
+  public:
+    static const char* const DEFAULT_COMMAND; ///< The command run when none is set
+    static const char* const DIRECTORY; ///< The directory of the WAV files, inside the sounds path
+    static const int MAX_RUNNING = 2; ///< The commands running at once, the rest wait in a queue
+    static const int PENDING = -2; ///< Returned by play() for a text which is not ready yet
+
+    /**
+     * Constructs a new TTS cache
+     */
+    TtsCache();
+
+    /**
+     * Destroys the TTS cache, killing the commands still running
+     */
+    ~TtsCache();
+
+    /**
+     * Sets the command which synthesises the speech, DEFAULT_COMMAND otherwise
+     * @param command The path of the command, looked up in PATH if it has no slash
+     */
+    static void setCommand(const std::string& command);
+
+    /**
+     * Splits the name of a speech sound
+     * @param name The sound name, "tts:<lang>:<text>"
+     * @param lang Receives the language
+     * @param text Receives the text, which may contain colons
+     * @return true if the name is the name of a speech sound
+     */
+    static bool parse(const std::string& name, std::string& lang, std::string& text);
+
+    /**
+     * Gets the name of the WAV file of a text, relative to the sounds path
+     * @param lang The language of the voice
+     * @param text The text
+     * @return the file name, e.g. "tts/es-5f3a0c1e2b9d8e47.wav"
+     */
+    std::string getSoundName(const std::string& lang, const std::string& text) const;
+
+    /**
+     * Synthesises and loads a text in the background, unless it is already
+     * @param lang The language of the voice
+     * @param text The text
+     */
+    void prefetch(const std::string& lang, const std::string& text);
+
+    /**
+     * Synthesises and loads the texts of a document in the background
+     * @param lang The language of the voice
+     * @param texts The texts
+     */
+    void prefetch(const std::string& lang, const std::vector<std::string>& texts);
+
+    /**
+     * Synthesises and loads a speech sound in the background, other sounds are ignored
+     * @param name The sound name, "tts:<lang>:<text>"
+     */
+    void prefetch(const std::string& name);
+
+    /**
+     * Plays a text, or requests it if it is not ready yet
+     * @param lang The language of the voice
+     * @param text The text
+     * @param loops The number of times to play it again (-1 infinite)
+     * @return the channel playing the sound, PENDING if it is not ready yet, -1 if it failed
+     */
+    int play(const std::string& lang, const std::string& text, int loops = 0);
+
+    /**
+     * Checks whether a text can be played right away
+     * @param lang The language of the voice
+     * @param text The text
+     * @return true if the sound is loaded
+     */
+    bool isReady(const std::string& lang, const std::string& text) const;
+
+    /**
+     * Checks whether a text is still on its way, a failed one is not
+     * @param lang The language of the voice
+     * @param text The text
+     * @return true if the text is requested and not ready yet
+     */
+    bool isPending(const std::string& lang, const std::string& text) const;
+
+    /**
+     * Collects the finished commands and starts the queued ones
+     * Never waits, it is meant to be called once per iteration of the main loop
+     */
+    void update();
+
+  private:
+    /**
+     * What is known about a text
+     */
+    enum State {
+      QUEUED, ///< Waiting for a command slot
+      SYNTHESISING, ///< The command is running
+      LOADING, ///< The AudioManager is loading the WAV file
+      READY ///< The sound can be played
+    };
+
+    /**
+     * A text requested to the cache
+     */
+    struct Request {
+      std::string lang; ///< The language of the voice
+      std::string text; ///< The text
+      State state; ///< How far it is
+      pid_t pid; ///< The command synthesising it
+    };
+
+    /**
+     * Hashes a text with 64 bits FNV-1a
+     * @param lang The language of the voice
+     * @param text The text
+     * @return the hash
+     */
+    static uint64_t hash(const std::string& lang, const std::string& text);
+
+    /**
+     * Runs the command for a queued text
+     * @param name The sound name of the text
+     * @return true if the command started
+     */
+    bool spawn(const std::string& name);
+
+    /**
+     * Hands a synthesised WAV file to the AudioManager
+     * @param name The sound name of the text
+     */
+    void load(const std::string& name);
+
+    /**
+     * Gets the path of the WAV file being written by the command
+     * @param name The sound name of the text
+     * @return the path of the temporary file
+     */
+    std::string temporaryPath(const std::string& name) const;
+
+  private:
+    static std::string command; ///< The command which synthesises the speech
+
+    AudioManager& _audioManager; ///< A reference to the AudioManager
+    std::map<std::string, Request> _requests; ///< The texts requested, indexed by their sound name
+    std::deque<std::string> _queue; ///< The sound names waiting for a command slot
+    int _running; ///< The commands running
+  };
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef V4L2FRAMESOURCE_H
+#define V4L2FRAMESOURCE_H
+
+#include <vector>
+
+#include "FrameSource.h"
+
+namespace argosClient {
+
+  /**
+   * A Video4Linux2 capture device, such as an USB camera
+   * The driver fills buffers mapped in our address space, so frames are never
+   * copied out of the kernel: retrieve() converts them to BGR straight from the
+   * mapped buffer into the destination image
+   */
+  class V4L2FrameSource : public FrameSource {
+  public:
+    static const int BUFFER_COUNT = 4; ///< The number of buffers requested to the driver
+
+  public:
+    /**
+     * Constructs a new device source
+     * @param device The path of the device
+     * @param width The requested width of the frames
+     * @param height The requested height of the frames
+     */
+    V4L2FrameSource(const std::string& device, int width, int height);
+
+    /**
+     * Closes the device
+     */
+    ~V4L2FrameSource();
+
+    bool open() override;
+    bool isOpened() const override;
+    bool grab() override;
+    void retrieve(cv::Mat& image) override;
+    void release() override;
+    std::string getName() const override;
+
+  private:
+    /**
+     * A buffer shared with the driver
+     */
+    struct Buffer {
+      void* start; ///< The address the buffer is mapped at
+      size_t length; ///< The size of the buffer
+    };
+
+    /**
+     * Calls ioctl, retrying when interrupted by a signal
+     * @return the result of ioctl
+     */
+    int xioctl(unsigned long request, void* argument);
+
+    /**
+     * Asks the driver for the frame size and a pixel format we can convert
+     * @return true if the device accepted a format
+     */
+    bool setFormat();
+
+    /**
+     * Maps the driver buffers, queues them and starts streaming
+     * @return true if streaming started
+     */
+    bool startStreaming();
+
+  private:
+    std::string _device; ///< The path of the device
+    int _fd; ///< The file descriptor of the device (-1 if closed)
+    unsigned int _pixelFormat; ///< The pixel format delivered by the device
+    size_t _bytesPerLine; ///< The size of a row of the frames
+    std::vector<Buffer> _buffers; ///< The mapped buffers
+    int _dequeued; ///< The buffer holding the last grabbed frame (-1 if none)
+    size_t _dequeuedBytes; ///< The number of bytes used in that buffer
+  };
+
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef VIDEOCLIP_H
+#define VIDEOCLIP_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace argosClient {
+
+  /**
+   * A short video clip stored as pre-decoded RGB frames in a memory-mapped file
+   * Clips are produced once from any video file OpenCV can read and then played
+   * back straight from the page cache, without decoding anything
+   *
+   *       Header        Frame 0       Frame 1             Frame N-1
+   * +---------------+-------------+-------------+-----+-------------+
+   * |   64 bytes    | w * h * 3   | w * h * 3   | ... | w * h * 3   |
+   * +---------------+-------------+-------------+-----+-------------+
+   */
+  class VideoClip {
+  public:
+    /**
+     * The header written at the beginning of every clip file
+     */
+    struct Header {
+      char magic[8]; ///< Always "ARGOSCLP"
+      uint32_t version; ///< The version of the clip format
+      uint32_t width; ///< The width of every frame
+      uint32_t height; ///< The height of every frame
+      uint32_t channels; ///< The number of channels of every frame (RGB)
+      uint32_t frameCount; ///< The number of frames in the clip
+      uint32_t frameSize; ///< The size in bytes of every frame
+      float fps; ///< The frame rate of the source video
+      char reserved[28]; ///< Padding up to 64 bytes so frames stay aligned
+    };
+
+  public:
+    /**
+     * Constructs a new empty clip
+     */
+    VideoClip();
+
+    /**
+     * Unmaps the clip file
+     */
+    ~VideoClip();
+
+    /**
+     * Decodes a whole video file and writes it as a clip file
+     * @param videoFile The path of the video file to decode
+     * @param clipFile The path of the resulting clip file
+     * @param maxBytes The maximum size allowed for the clip (0 means no limit)
+     * @return true if the clip was written, false otherwise
+     */
+    static bool convert(const std::string& videoFile, const std::string& clipFile, size_t maxBytes = 0);
+
+    /**
+     * Maps a clip file in memory
+     * @param clipFile The path of the clip file to map
+     * @return true if the file is a valid clip, false otherwise
+     */
+    bool open(const std::string& clipFile);
+
+    /**
+     * Unmaps the clip file if it is mapped
+     */
+    void close();
+
+    /**
+     * Checks whether the clip is mapped or not
+     * @return true if the clip is mapped
+     */
+    bool isOpened() const;
+
+    /**
+     * Retrieves the pixels of a frame
+     * @param index The index of the frame
+     * @return a pointer to the RGB pixels of the frame, nullptr if the index is out of range
+     */
+    const unsigned char* frame(int index) const;
+
+    /**
+     * Gets the width of the frames
+     * @return the width of the frames
+     */
+    int getWidth() const;
+
+    /**
+     * Gets the height of the frames
+     * @return the height of the frames
+     */
+    int getHeight() const;
+
+    /**
+     * Gets the number of frames
+     * @return the number of frames of the clip
+     */
+    int getFrameCount() const;
+
+    /**
+     * Gets the frame rate of the source video
+     * @return the frame rate in frames per second
+     */
+    float getFps() const;
+
+  private:
+    VideoClip(const VideoClip&);
+    VideoClip& operator=(const VideoClip&);
+
+  private:
+    void* _mapping; ///< The address of the mapped file
+    size_t _mappingSize; ///< The size of the mapped file
+    const Header* _header; ///< The header of the clip, inside the mapping
+    const unsigned char* _frames; ///< The first frame of the clip, inside the mapping
+  };
+
+}
+
+#endif
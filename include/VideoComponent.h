@@ -2,17 +2,25 @@
 #define VIDEO_H
 
 #include <string>
+#include <memory>
 #include <GLES2/gl2.h>
 #include <opencv2/opencv.hpp>
 
 #include "GraphicComponent.h"
 #include "GfxProgram.h"
+#include "Timer.h"
 
 namespace argosClient {
 
+  class VideoClip;
+  class AVDecoder;
+
   /**
    * A class representing a video
    * It allows to load a video from disk
+   * Short videos are played from the ClipCache, longer ones are decoded ahead by an
+   * AVDecoder and converted from YUV on the GPU. cv::VideoCapture is the last resort
+   * Playback is paced by the frame rate of the video, not by the render rate
    */
   class VideoComponent : public GraphicComponent {
   public:
@@ -61,7 +69,60 @@ namespace argosClient {
      */
     void makeVideoTexture(const cv::Mat& mat);
 
+    static const float DEFAULT_FPS; ///< The frame rate assumed when the video does not report it
+
   private:
+    /**
+     * Computes the frame which should be on screen according to the media clock
+     * The clock starts the first time this is called
+     * @return the index of the frame to present
+     */
+    int presentationFrame();
+
+    /**
+     * Counts the frames skipped to present a frame in video_frames_dropped
+     * @param frame The index of the frame about to be shown
+     */
+    void countDropped(int frame) const;
+
+    /**
+     * Uploads the clip frame matching the media clock, if it is not already on the texture
+     * @return false if the clip has finished
+     */
+    bool updateClipFrame();
+
+    /**
+     * Uploads the decoded YUV frame matching the media clock, if any new one is ready
+     * @return false if the video has finished or no frame has been decoded yet
+     */
+    bool updateDecoderFrame();
+
+    /**
+     * Draws the quad sampling the YUV textures
+     */
+    void renderYUV();
+
+    /**
+     * Loads the YUV to RGB shader program the first time it is needed
+     */
+    void loadYUVProgram();
+
+    /**
+     * Decodes the video frame matching the media clock, skipping late frames and
+     * reusing the current one if it is still due
+     * @return false if the video has finished
+     */
+    bool decodeFrame();
+
+    /**
+     * Uploads RGB pixels to the video texture, allocating it only when the size changes
+     * @param data The RGB pixels
+     * @param width The width of the frame
+     * @param height The height of the frame
+     * @param step The size in bytes of every row
+     */
+    void uploadVideoTexture(const unsigned char* data, int width, int height, size_t step);
+
     /**
      * The specific logic used to draw this graphic component
      */
@@ -80,6 +141,25 @@ namespace argosClient {
     GLuint _textureId; ///< The OpenGL texture id used to render the video
     cv::VideoCapture _videoReader; ///< The video file reader
     cv::Mat _videoFrame; ///< The current video frame read from the file
+    std::shared_ptr<VideoClip> _clip; ///< The pre-decoded clip, if the video could be cached
+    std::unique_ptr<AVDecoder> _decoder; ///< The libavcodec decoder, if the video is not cached
+    GfxProgram _yuvShader; ///< The shader program converting YUV to RGB
+    GLuint _yuvTextures[3]; ///< The Y, U and V textures (0 if not created yet)
+    GLint _yuvVertexHandler; ///< The vertex handler for the YUV shader
+    GLint _yuvTexHandler; ///< The texture handler for the YUV shader
+    GLint _yuvMvpHandler; ///< The model view projection matrix handler for the YUV shader
+    GLint _yuvSamplerHandlers[3]; ///< The sampler handlers of every plane for the YUV shader
+    GLint _yuvRangeHandler; ///< The range handler for the YUV shader
+    int _yuvWidth; ///< The width the Y texture was allocated with
+    int _yuvHeight; ///< The height the Y texture was allocated with
+    int _shownFrame; ///< The clip frame currently on the texture
+    int _decodedFrame; ///< The index of the last frame decoded from the video file
+    int _textureWidth; ///< The width the video texture was allocated with
+    int _textureHeight; ///< The height the video texture was allocated with
+    float _fps; ///< The frame rate of the video
+    Timer _clock; ///< The media clock, started with the first rendered frame
+    bool _playing; ///< Whether the media clock has been started or not
+    bool _finished; ///< Whether the video file has reached its end or not
     bool _loop; ///< Whether loop the video or not
     std::string _fileName; ///< The file name of the video
   };
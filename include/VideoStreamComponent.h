@@ -2,7 +2,11 @@
 #define VIDEOSTREAM_H
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <atomic>
 #include <condition_variable>
 #include <boost/asio.hpp>
 
@@ -20,7 +24,8 @@ namespace argosClient {
   /**
    * A class representing a networked video stream
    * It receives video from an endpoint and renders it
-   * The video is actually a sequence of OpenCV::Mat retrieved from the server
+   * The video is actually a sequence of JPEG frames retrieved from the server
+   * Frames are decoded scaled down to the size the component takes on screen
    */
   class VideoStreamComponent : public GraphicComponent {
   public:
@@ -61,6 +66,47 @@ namespace argosClient {
      */
     void receiveVideo(unsigned short port);
 
+    /**
+     * What the decode tasks share with the component, they may outlive it
+     */
+    struct DecodeState {
+      std::mutex mutex; ///< Protects the received frame
+      cv::Mat receivedFrame; ///< The last decoded frame, waiting to be uploaded
+      cv::Mat decodingFrame; ///< The frame the decode task decodes into, swapped with the received one
+      std::vector<unsigned char> jpegData; ///< The JPEG frame handed to the decode task
+      size_t jpegBytes; ///< The size of the JPEG frame
+      std::atomic<bool> decoding; ///< Whether a decode task is queued or running
+      std::atomic<bool> ready; ///< Whether the component is allowed to render or not
+      std::atomic<bool> received; ///< Whether a new frame is waiting to be uploaded
+      std::atomic<int> targetWidth; ///< The on-screen width of the component in pixels (0 if unknown)
+      std::atomic<int> targetHeight; ///< The on-screen height of the component in pixels (0 if unknown)
+
+      DecodeState();
+    };
+
+    /**
+     * Decodes the last received JPEG frame, run by the TaskPool
+     * @param state The state of the component, kept alive by the task
+     */
+    static void decodeReceived(const std::shared_ptr<DecodeState>& state);
+
+    /**
+     * Waits for a datagram, giving up when the component is destroyed
+     * @param udpSocket The non-blocking UDP socket
+     * @param buffer Receives the datagram
+     * @param size The size of the buffer
+     * @param udpSenderEndpoint Receives the sender endpoint
+     * @param bytes Receives the size of the datagram
+     * @return false if the component is being destroyed
+     */
+    bool receivePacket(udp::socket& udpSocket, void* buffer, size_t size, udp::endpoint& udpSenderEndpoint, size_t& bytes);
+
+    /**
+     * Computes the size in pixels this component takes on screen under the current
+     * projection, so the receiving thread can decode the frames at that size
+     */
+    void updateTargetSize();
+
     /**
      * Sends video frames back to the sender
      * @param mat The OpenCV::Mat frame to send
@@ -81,12 +127,12 @@ namespace argosClient {
     GLfloat _width; ///< The width of this graphic component
     GLfloat _height; ///< The height of this graphic component
     GLuint _textureId; ///< The OpenGL texture id used to render the image
+    int _textureWidth; ///< The width the texture was allocated with
+    int _textureHeight; ///< The height the texture was allocated with
 
-    bool _ready; ///< Whether the component is allowed to render or not
-    bool _receive; ///< Whether the component has received a new frame or not
-    cv::Mat _receivedFrame; ///< The received frame
-    std::thread* _videoThread; ///< A thread object used to receive video concurrently
-    std::mutex _mutex;
+    std::shared_ptr<DecodeState> _state; ///< The frames and flags shared with the receiving thread and the decode tasks
+    std::atomic<bool> _stopping; ///< Whether the receiving thread has to finish
+    std::thread _videoThread; ///< A thread object used to receive video concurrently, joined on destruction
 
     /** @name Timeout
      *  Timers used to simulate timeouts when no video is received for 1 second
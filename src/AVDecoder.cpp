@@ -0,0 +1,370 @@
+#include "AVDecoder.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include "TaskPool.h"
+#include "Log.h"
+
+namespace argosClient {
+
+  int AVDecoder::threadCount = 2;
+
+  static const int SLOT_FREE = -1;
+  static const int SLOT_DECODING = -2;
+
+  static std::string errorString(int code) {
+    char message[128];
+    if(av_strerror(code, message, sizeof(message)) < 0)
+      return "error " + std::to_string(code);
+
+    return message;
+  }
+
+  AVDecoder::AVDecoder()
+    : _format(nullptr), _codec(nullptr), _frame(nullptr), _packet(nullptr), _sws(nullptr),
+      _stream(-1), _width(0), _height(0), _fps(0.0f), _fullRange(false),
+      _nextIndex(0), _loopBase(0), _packetPending(false), _wantedIndex(-1), _loop(false), _draining(false), _finished(false), _decoding(false) {
+    for(int i = 0; i < RING_SIZE; ++i) {
+      _frames[i].index = SLOT_FREE;
+    }
+  }
+
+  AVDecoder::~AVDecoder() {
+    close();
+  }
+
+  bool AVDecoder::open(const std::string& fileName) {
+    close();
+
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+    av_register_all();
+#endif
+
+    if(avformat_open_input(&_format, fileName.c_str(), nullptr, nullptr) < 0) {
+      Log::error("libavformat could not open '" + fileName + "'.");
+      return false;
+    }
+
+    if(avformat_find_stream_info(_format, nullptr) < 0) {
+      Log::error("libavformat could not find the streams of '" + fileName + "'.");
+      close();
+      return false;
+    }
+
+    _stream = av_find_best_stream(_format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if(_stream < 0) {
+      Log::error("'" + fileName + "' has no video stream.");
+      close();
+      return false;
+    }
+
+    AVStream* stream = _format->streams[_stream];
+    const AVCodec* decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+    if(!decoder) {
+      Log::error("There is no decoder for the video stream of '" + fileName + "'.");
+      close();
+      return false;
+    }
+
+    _codec = avcodec_alloc_context3(decoder);
+    avcodec_parameters_to_context(_codec, stream->codecpar);
+
+    // Let libavcodec split every frame (slices) or pipeline consecutive frames (frame threads)
+    _codec->thread_count = threadCount;
+    _codec->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+    if(avcodec_open2(_codec, decoder, nullptr) < 0) {
+      Log::error("Could not open the decoder for '" + fileName + "'.");
+      close();
+      return false;
+    }
+
+    _frame = av_frame_alloc();
+    _packet = av_packet_alloc();
+    _width = _codec->width;
+    _height = _codec->height;
+    _fullRange = (_codec->pix_fmt == AV_PIX_FMT_YUVJ420P);
+
+    AVRational rate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+    _fps = rate.den ? (float) av_q2d(rate) : 0.0f;
+
+    Log::success("Video file '" + fileName + "' opened with libavcodec (" + decoder->name + ", " +
+                 std::to_string(threadCount) + " threads).");
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    scheduleDecode();
+
+    return true;
+  }
+
+  void AVDecoder::close() {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _finished = true;
+      _idle.wait(lock, [this]{ return !_decoding; });
+    }
+
+    if(_sws) {
+      sws_freeContext(_sws);
+    }
+    if(_packet) {
+      av_packet_free(&_packet);
+    }
+    if(_frame) {
+      av_frame_free(&_frame);
+    }
+    if(_codec) {
+      avcodec_free_context(&_codec);
+    }
+    if(_format) {
+      avformat_close_input(&_format);
+    }
+
+    _sws = nullptr;
+    _packet = nullptr;
+    _frame = nullptr;
+    _codec = nullptr;
+    _format = nullptr;
+    _stream = -1;
+
+    for(int i = 0; i < RING_SIZE; ++i) {
+      _frames[i].index = SLOT_FREE;
+    }
+    _nextIndex = 0;
+    _loopBase = 0;
+    _packetPending = false;
+    _wantedIndex = -1;
+    _draining = false;
+    _finished = false;
+  }
+
+  void AVDecoder::setLoop(bool loop) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _loop = loop;
+  }
+
+  const AVDecoder::YUVFrame* AVDecoder::frameAt(int index) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _wantedIndex = index;
+
+    YUVFrame* best = nullptr;
+    for(int i = 0; i < RING_SIZE; ++i) {
+      if(_frames[i].index >= 0 && _frames[i].index <= index && (!best || _frames[i].index > best->index))
+        best = &_frames[i];
+    }
+
+    // Frames older than the one to present will never be shown
+    if(best) {
+      for(int i = 0; i < RING_SIZE; ++i) {
+        if(_frames[i].index >= 0 && _frames[i].index < best->index)
+          _frames[i].index = SLOT_FREE;
+      }
+    }
+
+    scheduleDecode();
+
+    return best;
+  }
+
+  bool AVDecoder::isFinished() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _finished && _wantedIndex >= _nextIndex;
+  }
+
+  bool AVDecoder::isFullRange() const {
+    return _fullRange;
+  }
+
+  int AVDecoder::getWidth() const {
+    return _width;
+  }
+
+  int AVDecoder::getHeight() const {
+    return _height;
+  }
+
+  float AVDecoder::getFps() const {
+    return _fps;
+  }
+
+  void AVDecoder::setThreadCount(int threads) {
+    threadCount = threads;
+  }
+
+  void AVDecoder::scheduleDecode() {
+    if(_decoding || _finished || !_codec)
+      return;
+
+    for(int i = 0; i < RING_SIZE; ++i) {
+      if(_frames[i].index == SLOT_FREE) {
+        _decoding = true;
+        TaskPool::getInstance().post(std::bind(&AVDecoder::decodeAhead, this));
+        return;
+      }
+    }
+  }
+
+  void AVDecoder::decodeAhead() {
+    while(true) {
+      YUVFrame* slot = nullptr;
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(!_finished) {
+          for(int i = 0; i < RING_SIZE && !slot; ++i) {
+            if(_frames[i].index == SLOT_FREE)
+              slot = &_frames[i];
+          }
+        }
+
+        if(!slot) {
+          _decoding = false;
+          _idle.notify_all();
+          return;
+        }
+
+        slot->index = SLOT_DECODING;
+
+        // When the renderer is far behind, drop the frames nobody depends on
+        _codec->skip_frame = (_wantedIndex - _nextIndex > RING_SIZE) ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+      }
+
+      int index;
+      bool decoded = decodeInto(*slot, index);
+      if(!decoded) {
+        bool loop;
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          loop = _loop;
+        }
+        decoded = loop && rewind() && decodeInto(*slot, index);
+      }
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      if(decoded) {
+        // The timestamp keeps the number on the media clock when frames are discarded; never
+        // behind the previous frame, for streams without timestamps or with a broken one
+        slot->index = index > _nextIndex ? index : _nextIndex;
+        _nextIndex = slot->index + 1;
+      }
+      else {
+        slot->index = SLOT_FREE;
+        _finished = true;
+      }
+    }
+  }
+
+  bool AVDecoder::decodeInto(YUVFrame& frame, int& index) {
+    while(true) {
+      int result = avcodec_receive_frame(_codec, _frame);
+
+      if(result == 0) {
+        AVStream* stream = _format->streams[_stream];
+        int64_t timestamp = _frame->best_effort_timestamp;
+        if(timestamp != AV_NOPTS_VALUE && _fps > 0.0f) {
+          if(stream->start_time != AV_NOPTS_VALUE)
+            timestamp -= stream->start_time;
+          index = _loopBase + (int) llround(timestamp * av_q2d(stream->time_base) * _fps);
+        }
+        else {
+          index = -1;
+        }
+
+        int chromaWidth = (_frame->width + 1) / 2;
+        int chromaHeight = (_frame->height + 1) / 2;
+
+        frame.width = _frame->width;
+        frame.height = _frame->height;
+        frame.strides[0] = _frame->width;
+        frame.strides[1] = frame.strides[2] = chromaWidth;
+        frame.planes[0].resize(frame.strides[0] * frame.height);
+        frame.planes[1].resize(chromaWidth * chromaHeight);
+        frame.planes[2].resize(chromaWidth * chromaHeight);
+
+        if(_frame->format == AV_PIX_FMT_YUV420P || _frame->format == AV_PIX_FMT_YUVJ420P) {
+          for(int p = 0; p < 3; ++p) {
+            int rows = (p == 0) ? frame.height : chromaHeight;
+            for(int row = 0; row < rows; ++row) {
+              memcpy(&frame.planes[p][row * frame.strides[p]], _frame->data[p] + row * _frame->linesize[p], frame.strides[p]);
+            }
+          }
+        }
+        else {
+          // Any other pixel format is converted on the CPU, still on the decode worker
+          _sws = sws_getCachedContext(_sws, _frame->width, _frame->height, (AVPixelFormat) _frame->format,
+                                      _frame->width, _frame->height, AV_PIX_FMT_YUV420P,
+                                      SWS_BILINEAR, nullptr, nullptr, nullptr);
+          uint8_t* planes[3] = { &frame.planes[0][0], &frame.planes[1][0], &frame.planes[2][0] };
+          sws_scale(_sws, _frame->data, _frame->linesize, 0, _frame->height, planes, frame.strides);
+        }
+
+        av_frame_unref(_frame);
+        return true;
+      }
+
+      if(result != AVERROR(EAGAIN)) {
+        if(result != AVERROR_EOF)
+          Log::error("Could not decode the video: " + errorString(result) + ".");
+        return false;
+      }
+
+      // The decoder needs more data
+      if(_draining)
+        return false;
+
+      if(!_packetPending) {
+        if(av_read_frame(_format, _packet) < 0) {
+          int sent = avcodec_send_packet(_codec, nullptr);
+          if(sent < 0 && sent != AVERROR_EOF)
+            Log::error("Could not drain the video decoder: " + errorString(sent) + ".");
+          _draining = true;
+          continue;
+        }
+
+        if(_packet->stream_index != _stream) {
+          av_packet_unref(_packet);
+          continue;
+        }
+      }
+
+      // A full decoder gives its frames back first, then the same packet is sent again
+      int sent = avcodec_send_packet(_codec, _packet);
+      _packetPending = (sent == AVERROR(EAGAIN));
+      if(_packetPending)
+        continue;
+
+      av_packet_unref(_packet);
+      if(sent == AVERROR_EOF)
+        return false;
+
+      // A corrupt packet is skipped, the decoder recovers on the next key frame
+      if(sent < 0)
+        ARGOS_LOG_ERROR_EVERY(1.0f, "Video packet dropped by the decoder: " + errorString(sent) + ".");
+    }
+  }
+
+  bool AVDecoder::rewind() {
+    if(av_seek_frame(_format, _stream, 0, AVSEEK_FLAG_BACKWARD) < 0)
+      return false;
+
+    avcodec_flush_buffers(_codec);
+    av_packet_unref(_packet);
+    _packetPending = false;
+    _draining = false;
+
+    // The timestamps start again, the numbers go on from the last frame
+    _loopBase = _nextIndex;
+
+    return true;
+  }
+
+}
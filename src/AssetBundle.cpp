@@ -0,0 +1,309 @@
+#include "AssetBundle.h"
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <GLES2/gl2.h>
+#include <SOIL/SOIL.h>
+#include <SDL/SDL.h>
+
+#include "Log.h"
+
+namespace argosClient {
+
+  const char* const AssetBundle::DEFAULT_FILE = "data/assets.bundle";
+
+  static const char BUNDLE_MAGIC[8] = { 'A', 'R', 'G', 'O', 'S', 'B', 'N', 'D' };
+  static const uint32_t BUNDLE_VERSION = 1;
+  static const size_t BUNDLE_ALIGNMENT = 64;
+
+  AssetBundle::AssetBundle()
+    : _mapping(nullptr), _mappingSize(0), _header(nullptr), _entries(nullptr) {
+
+  }
+
+  AssetBundle::~AssetBundle() {
+    close();
+  }
+
+  /**
+   * Lists the files of a directory with one of the given extensions, sorted by name
+   */
+  static std::vector<std::string> listFiles(const std::string& dir, const std::vector<std::string>& extensions) {
+    std::vector<std::string> files;
+    DIR* d = opendir(dir.c_str());
+    if(!d)
+      return files;
+
+    dirent* ent;
+    while((ent = readdir(d)) != nullptr) {
+      std::string name(ent->d_name);
+      size_t dot = name.rfind('.');
+      if(dot == std::string::npos)
+        continue;
+
+      std::string extension = name.substr(dot + 1);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if(std::find(extensions.begin(), extensions.end(), extension) != extensions.end())
+        files.push_back(dir + "/" + name);
+    }
+    closedir(d);
+
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+
+  /**
+   * Fills the common fields of an entry
+   */
+  static bool makeEntry(const std::string& file, uint32_t type, AssetBundle::Entry& entry) {
+    memset(&entry, 0, sizeof(AssetBundle::Entry));
+    if(file.size() >= sizeof(entry.name)) {
+      Log::error("Asset name '" + file + "' is too long for the bundle.");
+      return false;
+    }
+
+    struct stat st;
+    if(stat(file.c_str(), &st) < 0)
+      return false;
+
+    strncpy(entry.name, file.c_str(), sizeof(entry.name) - 1);
+    entry.type = type;
+    entry.mtime = st.st_mtime;
+
+    return true;
+  }
+
+  /**
+   * Appends a data block to the bundle, aligned, and records where it went
+   */
+  static bool writeData(FILE* f, const void* data, size_t size, AssetBundle::Entry& entry) {
+    static const char padding[BUNDLE_ALIGNMENT] = { 0 };
+
+    long position = ftell(f);
+    size_t pad = (BUNDLE_ALIGNMENT - position % BUNDLE_ALIGNMENT) % BUNDLE_ALIGNMENT;
+    fwrite(padding, 1, pad, f);
+
+    entry.offset = position + pad;
+    entry.size = size;
+
+    return fwrite(data, 1, size, f) == size;
+  }
+
+  bool AssetBundle::build(const std::string& dataDir, const std::string& bundleFile, int rate, int channels) {
+    std::string dir = dataDir;
+    while(dir.size() > 1 && dir[dir.size() - 1] == '/')
+      dir.erase(dir.size() - 1);
+
+    // Write to a temporary file first so a half-written bundle is never mapped
+    std::string tmpFile = bundleFile + ".tmp";
+    FILE* f = fopen(tmpFile.c_str(), "wb");
+    if(!f) {
+      Log::error("Could not create the bundle '" + tmpFile + "'.");
+      return false;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+    header.version = BUNDLE_VERSION;
+    fwrite(&header, sizeof(Header), 1, f);
+
+    std::vector<Entry> entries;
+    bool ok = true;
+
+    // Textures, exactly as ImageComponent would upload them
+    for(const std::string& file : listFiles(dir + "/images", { "jpg", "jpeg", "png", "bmp", "tga" })) {
+      Entry entry;
+      if(!makeEntry(file, TEXTURE, entry))
+        continue;
+
+      int width, height, components;
+      unsigned char* pixels = SOIL_load_image(file.c_str(), &width, &height, &components, SOIL_LOAD_AUTO);
+      if(!pixels) {
+        Log::error("Could not decode the image '" + file + "': " + std::string(SOIL_last_result()));
+        continue;
+      }
+
+      static const uint32_t formats[] = { GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA };
+      entry.format = formats[components - 1];
+      entry.width = width;
+      entry.height = height;
+      ok = writeData(f, pixels, (size_t) width * height * components, entry) && ok;
+      SOIL_free_image_data(pixels);
+
+      entries.push_back(entry);
+    }
+
+    // Sounds, converted the same way Mix_LoadWAV converts them to the mixer format
+    for(const std::string& file : listFiles(dir + "/sounds", { "wav" })) {
+      Entry entry;
+      if(!makeEntry(file, SOUND, entry))
+        continue;
+
+      SDL_AudioSpec spec;
+      Uint8* samples;
+      Uint32 length;
+      if(!SDL_LoadWAV(file.c_str(), &spec, &samples, &length)) {
+        Log::error("Could not decode the sound '" + file + "': " + std::string(SDL_GetError()));
+        continue;
+      }
+
+      SDL_AudioCVT cvt;
+      if(SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_S16SYS, channels, rate) < 0) {
+        Log::error("Could not convert the sound '" + file + "': " + std::string(SDL_GetError()));
+        SDL_FreeWAV(samples);
+        continue;
+      }
+
+      std::vector<Uint8> converted((size_t) length * cvt.len_mult);
+      memcpy(&converted[0], samples, length);
+      SDL_FreeWAV(samples);
+      cvt.buf = &converted[0];
+      cvt.len = length;
+      SDL_ConvertAudio(&cvt);
+
+      entry.format = AUDIO_S16SYS;
+      entry.width = rate;
+      entry.height = channels;
+      ok = writeData(f, &converted[0], cvt.len_cvt, entry) && ok;
+
+      entries.push_back(entry);
+    }
+
+    // The index goes last, sorted for the binary search of find()
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+      return strncmp(a.name, b.name, sizeof(a.name)) < 0;
+    });
+
+    long position = ftell(f);
+    header.indexOffset = position + (BUNDLE_ALIGNMENT - position % BUNDLE_ALIGNMENT) % BUNDLE_ALIGNMENT;
+    fseek(f, header.indexOffset, SEEK_SET);
+    header.entryCount = entries.size();
+    if(!entries.empty())
+      fwrite(&entries[0], sizeof(Entry), entries.size(), f);
+
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(Header), 1, f);
+    ok = ok && !ferror(f);
+    fclose(f);
+
+    if(!ok || rename(tmpFile.c_str(), bundleFile.c_str()) != 0) {
+      Log::error("Could not write the bundle '" + bundleFile + "'.");
+      unlink(tmpFile.c_str());
+      return false;
+    }
+
+    Log::success("Bundle '" + bundleFile + "' built: " + std::to_string(entries.size()) + " assets, " +
+                 std::to_string((header.indexOffset + entries.size() * sizeof(Entry)) / 1024) + " KB.");
+
+    return true;
+  }
+
+  bool AssetBundle::open(const std::string& bundleFile) {
+    close();
+
+    int fd = ::open(bundleFile.c_str(), O_RDONLY);
+    if(fd < 0) {
+      return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(Header)) {
+      ::close(fd);
+      return false;
+    }
+
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED) {
+      Log::error("Could not map the bundle '" + bundleFile + "'.");
+      return false;
+    }
+
+    const Header* header = static_cast<const Header*>(mapping);
+    if(memcmp(header->magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0 || header->version != BUNDLE_VERSION ||
+       header->indexOffset + (uint64_t) header->entryCount * sizeof(Entry) > (uint64_t) st.st_size) {
+      Log::error("Bundle '" + bundleFile + "' is not valid.");
+      munmap(mapping, st.st_size);
+      return false;
+    }
+
+    // Only the assets used are read, in no particular order
+    madvise(mapping, st.st_size, MADV_RANDOM);
+
+    _mapping = mapping;
+    _mappingSize = st.st_size;
+    _header = header;
+    _entries = reinterpret_cast<const Entry*>(static_cast<const unsigned char*>(mapping) + header->indexOffset);
+
+    Log::success("Bundle '" + bundleFile + "' mapped: " + std::to_string(header->entryCount) + " assets.");
+
+    return true;
+  }
+
+  void AssetBundle::close() {
+    if(_mapping) {
+      munmap(_mapping, _mappingSize);
+    }
+
+    _mapping = nullptr;
+    _mappingSize = 0;
+    _header = nullptr;
+    _entries = nullptr;
+  }
+
+  bool AssetBundle::isOpened() const {
+    return _mapping != nullptr;
+  }
+
+  const AssetBundle::Entry* AssetBundle::find(const std::string& name, Type type) const {
+    if(!_header)
+      return nullptr;
+
+    const Entry* end = _entries + _header->entryCount;
+    const Entry* entry = std::lower_bound(_entries, end, name, [](const Entry& e, const std::string& n) {
+      return strncmp(e.name, n.c_str(), sizeof(e.name)) < 0;
+    });
+    if(entry == end || name.compare(0, std::string::npos, entry->name, strnlen(entry->name, sizeof(entry->name))) != 0 ||
+       entry->type != (uint32_t) type || entry->offset + entry->size > _mappingSize)
+      return nullptr;
+
+    // The bundle may ship without the sources, but a source edited afterwards wins
+    struct stat st;
+    if(stat(name.c_str(), &st) == 0 && st.st_mtime > entry->mtime) {
+      Log::info("Asset '" + name + "' is newer than the bundle, it is decoded again.");
+      return nullptr;
+    }
+
+    return entry;
+  }
+
+  const unsigned char* AssetBundle::data(const Entry& entry) const {
+    return static_cast<const unsigned char*>(_mapping) + entry.offset;
+  }
+
+  int AssetBundle::getChannels(const Entry& entry) {
+    switch(entry.format) {
+    case GL_LUMINANCE:
+      return 1;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    case GL_RGB:
+      return 3;
+    case GL_RGBA:
+      return 4;
+    default:
+      return 0;
+    }
+  }
+
+}
@@ -1,12 +1,39 @@
 #include "AudioManager.h"
 #include "Log.h"
+#include "ThreadManager.h"
+#include "TaskPool.h"
+#include "AssetBundle.h"
+#include "AudioStream.h"
 #include <SDL/SDL.h>
 #include <SDL/SDL_mixer.h>
 #include <dirent.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <chrono>
+
+#include "Metrics.h"
 
 namespace argosClient {
 
-  AudioManager::AudioManager() {
+  bool AudioManager::lowLatency = false;
+
+  // When play() started every channel, in microseconds (0 once measured), handed to the audio thread
+  static const int MAX_TRACKED_CHANNELS = 32;
+  static std::atomic<int64_t> playTimes[MAX_TRACKED_CHANNELS];
+
+  // How often the fill thread checks the ring, a tenth of it
+  static const int FILL_POLL_MS = AudioStream::RING_MS / 10;
+
+  static int64_t nowMicroseconds() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void AudioManager::setLowLatency(bool enabled) {
+    lowLatency = enabled;
+  }
+
+  AudioManager::AudioManager()
+    : _pendingLoads(0), _streamVolume(MIX_MAX_VOLUME), _fillStopping(false) {
     if(SDL_Init(SDL_INIT_AUDIO) < 0) {
       Log::error("Could not init audio system.");
       SDL_Quit();
@@ -15,15 +42,60 @@ namespace argosClient {
     atexit(SDL_Quit);
 
     // Inicializando SDL mixer...
-    if(Mix_OpenAudio(16000, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 4096) < 0) {
+    int rate = lowLatency ? LOW_LATENCY_RATE : DEFAULT_RATE;
+    int buffer = lowLatency ? LOW_LATENCY_BUFFER : DEFAULT_BUFFER;
+    if(Mix_OpenAudio(rate, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, buffer) < 0) {
       Log::error("Could not init audio mixer.");
       SDL_Quit();
     }
 
     atexit(Mix_CloseAudio);
+
+    // The chunks are converted to this format when they are loaded, never when they are played
+    int frequency, channels;
+    Uint16 format;
+    if(Mix_QuerySpec(&frequency, &format, &channels)) {
+      double bufferMs = 1000.0 * buffer / frequency;
+      Metrics::getInstance().gauge("audio_buffer_ms").set(bufferMs);
+      Log::info("Audio mixer opened at " + std::to_string(frequency) + " Hz, " + std::to_string(channels) + " channels, " +
+                std::to_string(buffer) + " samples per buffer (" + std::to_string((int) bufferMs) + " ms).");
+    }
+
+    // SDL owns the audio thread, it is only reachable from its callbacks
+    Mix_SetPostMix(AudioManager::postMix, nullptr);
+  }
+
+  void AudioManager::postMix(void* udata, uint8_t* stream, int len) {
+    static bool registered = false;
+
+    if(!registered) {
+      ThreadManager::getInstance().registerCurrentThread("audio");
+      registered = true;
+    }
+  }
+
+  void AudioManager::latencyEffect(int channel, void* stream, int len, void* udata) {
+    int64_t start = playTimes[channel].exchange(0);
+    if(start == 0)
+      return;
+
+    // Once per sound played, the histogram lock is not worth avoiding here
+    static Histogram& latency = Metrics::getInstance().histogram("audio_play_latency_ms");
+    latency.record((nowMicroseconds() - start) / 1000.0);
   }
 
   AudioManager::~AudioManager() {
+    stopStream();
+
+    if(_fillThread.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(_fillMutex);
+        _fillStopping = true;
+      }
+      _fillWake.notify_one();
+      _fillThread.join();
+    }
+
     for(auto& pair : _soundsMap)
       Mix_FreeChunk(pair.second);
   }
@@ -32,8 +104,50 @@ namespace argosClient {
     _soundsPath = path;
   }
 
+  const std::string& AudioManager::getSoundsPath() const {
+    return _soundsPath;
+  }
+
+  Mix_Chunk* AudioManager::loadFromBundle(const std::string& path) const {
+    AssetBundle& bundle = AssetBundle::getInstance();
+    const AssetBundle::Entry* entry = bundle.find(path, AssetBundle::SOUND);
+    if(entry == nullptr)
+      return nullptr;
+
+    // Mix_QuickLoad_RAW does no conversion, the samples must be in the format of the mixer
+    int frequency, channels;
+    Uint16 format;
+    if(!Mix_QuerySpec(&frequency, &format, &channels) || entry->width != (uint32_t) frequency ||
+       entry->format != format || entry->height != (uint32_t) channels) {
+      Log::info("Sound '" + path + "' was bundled for another mixer format, it is decoded again.");
+      return nullptr;
+    }
+
+    // The chunk does not own the samples, they stay in the mapping
+    return Mix_QuickLoad_RAW(const_cast<Uint8*>(bundle.data(*entry)), entry->size);
+  }
+
+  bool AudioManager::shouldStream(const std::string& path) const {
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0 || st.st_size <= STREAM_THRESHOLD)
+      return false;
+
+    // The stream converts to 16 bits samples only, other mixers load the sound as usual
+    int frequency, channels;
+    Uint16 format;
+    return Mix_QuerySpec(&frequency, &format, &channels) && format == AUDIO_S16SYS && channels <= 2 &&
+           AudioStream::canStream(path);
+  }
+
   void AudioManager::preload(const std::string& file_name) {
-    _soundsMap[file_name] = Mix_LoadWAV((_soundsPath + file_name).c_str());
+    Mix_Chunk* chunk = loadFromBundle(_soundsPath + file_name);
+    if(chunk == nullptr && shouldStream(_soundsPath + file_name)) {
+      _streamedSounds.insert(file_name);
+      Log::success("Sound '" + _soundsPath + file_name + "' will be streamed.");
+      return;
+    }
+
+    _soundsMap[file_name] = chunk != nullptr ? chunk : Mix_LoadWAV((_soundsPath + file_name).c_str());
 
     if(_soundsMap[file_name] == nullptr) {
       Log::error("Loading the sound: '" + _soundsPath + file_name + "'.");
@@ -43,54 +157,239 @@ namespace argosClient {
     }
   }
 
-  void AudioManager::preloadAll() {
+  std::vector<std::string> AudioManager::listSounds() const {
+    std::vector<std::string> files;
     DIR *dir;
     dirent *ent;
 
     if((dir = opendir(_soundsPath.c_str())) != nullptr) {
       while((ent = readdir(dir)) != nullptr) {
-        if((strcmp(ent->d_name, ".") != 0) && (strcmp(ent->d_name, "..") != 0))
-          preload(ent->d_name);
+        // Subdirectories such as tts/ are loaded on demand
+        if(ent->d_type != DT_DIR && (strcmp(ent->d_name, ".") != 0) && (strcmp(ent->d_name, "..") != 0))
+          files.push_back(ent->d_name);
       }
       closedir(dir);
     }
     else {
       Log::error("There was an error loading the sounds from '" + _soundsPath + "'. ");
     }
+
+    return files;
+  }
+
+  void AudioManager::preloadAll() {
+    for(const std::string& file_name : listSounds()) {
+      preload(file_name);
+    }
   }
 
-  void AudioManager::play(const std::string& file_name, int loops) {
-    if(_soundsMap.find(file_name) != _soundsMap.end()) {
-      Mix_PlayChannel(-1, _soundsMap[file_name], loops);
+  void AudioManager::preloadAllAsync() {
+    for(const std::string& file_name : listSounds()) {
+      preloadAsync(file_name);
+    }
+  }
+
+  void AudioManager::preloadAsync(const std::string& file_name, const std::function<void(bool)>& loaded) {
+    std::string path = _soundsPath + file_name;
+
+    // Bundled sounds need no decoding, they are ready right away
+    if(Mix_Chunk* chunk = loadFromBundle(path)) {
+      if(_soundsMap.find(file_name) == _soundsMap.end() || _soundsMap[file_name] == nullptr)
+        _soundsMap[file_name] = chunk;
+      else
+        Mix_FreeChunk(chunk);
+      Log::success("Sound '" + path + "' loaded from the bundle.");
+      if(loaded)
+        loaded(true);
+      return;
+    }
+
+    // Narrations are read while they play, they cost neither memory nor startup time
+    if(shouldStream(path)) {
+      _streamedSounds.insert(file_name);
+      Log::success("Sound '" + path + "' will be streamed.");
+      if(loaded)
+        loaded(true);
+      return;
+    }
+
+    _pendingLoads++;
+
+    // Mix_LoadWAV only reads the format of the opened mixer, the chunks are independent
+    TaskPool::getInstance().submitThen(
+      [path]() {
+        return Mix_LoadWAV(path.c_str());
+      },
+      [this, file_name, path, loaded](Mix_Chunk* chunk) {
+        _pendingLoads--;
+        if(chunk == nullptr) {
+          Log::error("Loading the sound: '" + path + "'.");
+          if(loaded)
+            loaded(false);
+          return;
+        }
+
+        // Already loaded on the spot by play()
+        if(_soundsMap.find(file_name) != _soundsMap.end() && _soundsMap[file_name] != nullptr)
+          Mix_FreeChunk(chunk);
+        else {
+          _soundsMap[file_name] = chunk;
+          Log::success("Sound '" + path + "' successfully loaded.");
+        }
+
+        if(loaded)
+          loaded(true);
+      });
+  }
+
+  bool AudioManager::isLoaded(const std::string& file_name) const {
+    auto it = _soundsMap.find(file_name);
+    return _streamedSounds.find(file_name) != _streamedSounds.end() || (it != _soundsMap.end() && it->second != nullptr);
+  }
+
+  int AudioManager::getPendingLoads() const {
+    return _pendingLoads;
+  }
+
+  int AudioManager::play(const std::string& file_name, int loops) {
+    if(_streamedSounds.find(file_name) != _streamedSounds.end()) {
+      return playStream(_soundsPath + file_name, loops);
+    }
+    else if(_soundsMap.find(file_name) != _soundsMap.end()) {
+      int64_t start = nowMicroseconds();
+
+      // The audio thread must not mix the channel before its start time and effect are set,
+      // SDL_mixer takes the same recursive lock inside both calls
+      SDL_LockAudio();
+      int channel = Mix_PlayChannel(-1, _soundsMap[file_name], loops);
+
+      // The effect is dropped by SDL_mixer when the channel finishes
+      if(channel >= 0 && channel < MAX_TRACKED_CHANNELS) {
+        playTimes[channel].store(start);
+        Mix_RegisterEffect(channel, AudioManager::latencyEffect, nullptr, nullptr);
+      }
+      SDL_UnlockAudio();
+
+      return channel;
     }
     else {
+      // Loading converts the sound, which is what preloading avoids
+      static Counter& playLoads = Metrics::getInstance().counter("audio_play_loads");
+      playLoads.add();
+      Log::info("Sound '" + file_name + "' was not preloaded, it is loaded before playing it.");
+
       preload(file_name);
-      play(file_name, loops);
+      bool loaded = _streamedSounds.find(file_name) != _streamedSounds.end() || _soundsMap[file_name] != nullptr;
+      return loaded ? play(file_name, loops) : -1;
     }
   }
 
+  int AudioManager::playStream(const std::string& path, int loops) {
+    int frequency, channels;
+    Uint16 format;
+    std::shared_ptr<AudioStream> stream = std::make_shared<AudioStream>();
+    if(!Mix_QuerySpec(&frequency, &format, &channels) || !stream->open(path, frequency, channels, loops))
+      return -1;
+
+    stream->setVolume(_streamVolume);
+
+    // The music hook is free, sounds are only played as chunks; it mixes silence until the first fill
+    stopStream();
+    _stream = stream;
+    Mix_HookMusic(AudioStream::mix, _stream.get());
+
+    if(!_fillThread.joinable())
+      _fillThread = std::thread(&AudioManager::runFillThread, this);
+
+    {
+      std::lock_guard<std::mutex> lock(_fillMutex);
+      _fillStream = stream;
+    }
+    _fillWake.notify_one();
+
+    return STREAM_CHANNEL;
+  }
+
+  void AudioManager::stopStream() {
+    if(_stream) {
+      // Once unhooked the audio thread no longer uses the stream, a fill still running keeps its own reference
+      Mix_HookMusic(nullptr, nullptr);
+      _stream.reset();
+
+      std::lock_guard<std::mutex> lock(_fillMutex);
+      _fillStream.reset();
+    }
+  }
+
+  void AudioManager::runFillThread() {
+    ThreadManager::getInstance().registerCurrentThread("audiostream");
+
+    std::unique_lock<std::mutex> lock(_fillMutex);
+    while(!_fillStopping) {
+      std::shared_ptr<AudioStream> stream = _fillStream;
+      if(stream && stream->beginFill()) {
+        lock.unlock();
+        stream->fill();
+        lock.lock();
+      }
+
+      _fillWake.wait_for(lock, std::chrono::milliseconds(FILL_POLL_MS));
+    }
+    lock.unlock();
+
+    ThreadManager::getInstance().unregisterCurrentThread();
+  }
+
+  void AudioManager::update() {
+    if(!_stream)
+      return;
+
+    if(_stream->isFinished())
+      stopStream();
+  }
+
+  bool AudioManager::isStreaming() const {
+    return _stream && !_stream->isFinished();
+  }
+
   void AudioManager::pause() {
     Mix_Pause(-1);
+    if(_stream)
+      _stream->setPaused(true);
   }
 
   void AudioManager::resume() {
     Mix_Resume(-1);
+    if(_stream)
+      _stream->setPaused(false);
   }
 
   void AudioManager::stop() {
     Mix_HaltChannel(-1);
+    stopStream();
   }
 
   void AudioManager::volume(const std::string& file_name, int val) {
+    if(_streamedSounds.find(file_name) != _streamedSounds.end()) {
+      _streamVolume = val;
+      if(_stream)
+        _stream->setVolume(val);
+      return;
+    }
+
     Mix_VolumeChunk(_soundsMap[file_name], val);
   }
 
   void AudioManager::volumeAll(int val) {
     Mix_Volume(-1, val);
+
+    _streamVolume = val;
+    if(_stream)
+      _stream->setVolume(val);
   }
 
   int AudioManager::isPlaying() {
-    return Mix_Playing(-1);
+    return Mix_Playing(-1) + (isStreaming() ? 1 : 0);
   }
 
 }
@@ -0,0 +1,243 @@
+#include "AudioStream.h"
+
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <SDL/SDL_mixer.h>
+
+#include "Log.h"
+#include "Metrics.h"
+
+namespace argosClient {
+
+  static inline uint32_t readLittleEndian32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t) in[3] << 24);
+  }
+
+  static inline int readLittleEndian16(const uint8_t* in) {
+    return in[0] | (in[1] << 8);
+  }
+
+  AudioStream::AudioStream()
+    : _mapping(nullptr), _mappingSize(0), _samples(nullptr), _frames(0), _sourceRate(0), _sourceChannels(0),
+      _sourceBytes(0), _channels(0), _position(0), _step(0), _released(0), _loops(0),
+      _readIndex(0), _writeIndex(0), _filling(false), _decoded(false), _finished(false), _volume(MIX_MAX_VOLUME),
+      _paused(false), _underruns(Metrics::getInstance().counter("audio_stream_underruns")) {
+
+  }
+
+  AudioStream::~AudioStream() {
+    if(_mapping)
+      munmap(const_cast<uint8_t*>(_mapping), _mappingSize);
+  }
+
+  bool AudioStream::map(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+      return false;
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || st.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED)
+      return false;
+
+    _path = path;
+    _mapping = static_cast<const uint8_t*>(mapping);
+    _mappingSize = st.st_size;
+
+    return true;
+  }
+
+  bool AudioStream::parse() {
+    if(_mappingSize < 12 || memcmp(_mapping, "RIFF", 4) != 0 || memcmp(_mapping + 8, "WAVE", 4) != 0)
+      return false;
+
+    // The chunks follow each other, padded to an even size; "fmt " comes before "data"
+    int format = 0, bits = 0;
+    size_t offset = 12;
+    while(offset + 8 <= _mappingSize) {
+      const uint8_t* chunk = _mapping + offset;
+      size_t size = readLittleEndian32(chunk + 4);
+      const uint8_t* body = chunk + 8;
+      size_t left = _mappingSize - offset - 8;
+
+      if(memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && left >= 16) {
+        format = readLittleEndian16(body);
+        _sourceChannels = readLittleEndian16(body + 2);
+        _sourceRate = readLittleEndian32(body + 4);
+        bits = readLittleEndian16(body + 14);
+      }
+      else if(memcmp(chunk, "data", 4) == 0 && format != 0) {
+        _sourceBytes = bits / 8;
+        if(format != 1 || (bits != 8 && bits != 16) || _sourceChannels < 1 || _sourceChannels > 2 || _sourceRate <= 0)
+          return false;
+
+        // A truncated file plays what it has
+        _samples = body;
+        _frames = (size < left ? size : left) / (_sourceBytes * _sourceChannels);
+        return _frames > 0;
+      }
+
+      offset += 8 + size + (size & 1);
+    }
+
+    return false;
+  }
+
+  bool AudioStream::canStream(const std::string& path) {
+    AudioStream stream;
+    return stream.map(path) && stream.parse();
+  }
+
+  bool AudioStream::open(const std::string& path, int rate, int channels, int loops) {
+    if(!map(path)) {
+      Log::error("Could not map the sound '" + path + "'.");
+      return false;
+    }
+
+    if(!parse()) {
+      Log::error("Sound '" + path + "' is not a PCM WAV file, it cannot be streamed.");
+      return false;
+    }
+
+    // Played once, front to back
+    madvise(const_cast<uint8_t*>(_mapping), _mappingSize, MADV_SEQUENTIAL);
+
+    _channels = channels;
+    _loops = loops;
+    _step = ((uint64_t) _sourceRate << 32) / rate;
+    _ring.resize((size_t) rate * channels * RING_MS / 1000);
+
+    return true;
+  }
+
+  int AudioStream::sample(size_t frame, int channel) const {
+    const uint8_t* in = _samples + (frame * _sourceChannels + channel) * _sourceBytes;
+    return _sourceBytes == 2 ? (int16_t) readLittleEndian16(in) : (in[0] - 128) << 8;
+  }
+
+  bool AudioStream::beginFill() {
+    if(_decoded.load())
+      return false;
+
+    size_t buffered = _writeIndex.load() - _readIndex.load();
+    if(buffered > _ring.size() / 2)
+      return false;
+
+    return !_filling.exchange(true);
+  }
+
+  void AudioStream::fill() {
+    size_t capacity = _ring.size();
+    size_t write = _writeIndex.load(std::memory_order_relaxed);
+    size_t space = capacity - (write - _readIndex.load(std::memory_order_acquire));
+    bool decoded = false;
+
+    while(space >= (size_t) _channels) {
+      size_t frame = _position >> 32;
+      if(frame >= _frames) {
+        if(_loops == 0) {
+          decoded = true;
+          break;
+        }
+        if(_loops > 0)
+          _loops--;
+        _position = 0;
+        _released = 0;
+        continue;
+      }
+
+      // Linear interpolation between the two nearest frames of the file
+      size_t next = frame + 1 < _frames ? frame + 1 : frame;
+      int64_t fraction = (_position >> 16) & 0xFFFF;
+      for(int c = 0; c < _channels; ++c) {
+        int first, second;
+        if(_sourceChannels == _channels || _sourceChannels == 1) {
+          int channel = _sourceChannels == 1 ? 0 : c;
+          first = sample(frame, channel);
+          second = sample(next, channel);
+        }
+        else {
+          first = (sample(frame, 0) + sample(frame, 1)) / 2;
+          second = (sample(next, 0) + sample(next, 1)) / 2;
+        }
+        _ring[write++ % capacity] = (int16_t) (first + (((second - first) * fraction) >> 16));
+      }
+
+      space -= _channels;
+      _position += _step;
+    }
+
+    // The samples are published before the end, mix() reads them in the other order
+    _writeIndex.store(write, std::memory_order_release);
+    if(decoded)
+      _decoded.store(true, std::memory_order_release);
+
+    // The pages played are dropped from the resident memory, they are read again only when looping
+    size_t played = (size_t) (_samples - _mapping) + ((_position >> 32) < _frames ? (_position >> 32) : _frames) * _sourceChannels * _sourceBytes;
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t release = played / pageSize * pageSize;
+    if(release > _released) {
+      madvise(const_cast<uint8_t*>(_mapping) + _released, release - _released, MADV_DONTNEED);
+      _released = release;
+    }
+
+    _filling.store(false);
+  }
+
+  void AudioStream::setVolume(int volume) {
+    _volume.store(volume);
+  }
+
+  void AudioStream::setPaused(bool paused) {
+    _paused.store(paused);
+  }
+
+  bool AudioStream::isFinished() const {
+    return _finished.load();
+  }
+
+  void AudioStream::mix(void* udata, uint8_t* stream, int len) {
+    AudioStream* self = static_cast<AudioStream*>(udata);
+    int16_t* out = reinterpret_cast<int16_t*>(stream);
+    size_t wanted = len / sizeof(int16_t);
+
+    if(self->_paused.load(std::memory_order_relaxed)) {
+      memset(out, 0, wanted * sizeof(int16_t));
+      return;
+    }
+
+    // Knowing the end first guarantees the write index read next is the last one
+    bool decoded = self->_decoded.load(std::memory_order_acquire);
+    size_t read = self->_readIndex.load(std::memory_order_relaxed);
+    size_t available = self->_writeIndex.load(std::memory_order_acquire) - read;
+    size_t count = wanted < available ? wanted : available;
+
+    size_t capacity = self->_ring.size();
+    int volume = self->_volume.load(std::memory_order_relaxed);
+    for(size_t i = 0; i < count; ++i) {
+      int value = self->_ring[(read + i) % capacity];
+      out[i] = volume == MIX_MAX_VOLUME ? value : value * volume / MIX_MAX_VOLUME;
+    }
+    memset(out + count, 0, (wanted - count) * sizeof(int16_t));
+
+    self->_readIndex.store(read + count, std::memory_order_release);
+
+    if(count < wanted) {
+      if(decoded)
+        self->_finished.store(true);
+      else if(read > 0)
+        self->_underruns.add(); // Not before the first fill, the stream just started
+    }
+  }
+
+}
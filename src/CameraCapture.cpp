@@ -0,0 +1,104 @@
+#include "CameraCapture.h"
+
+#include "Log.h"
+#include "ThreadManager.h"
+#include "Trace.h"
+
+namespace argosClient {
+
+  CameraCapture::CameraCapture(FrameSource& source)
+    : _source(source), _backSlot(0), _frontSlot(1), _publishedSlot(2),
+      _captured(0), _dropped(0), _running(false) {
+    for(int i = 0; i < POOL_SIZE; ++i) {
+      _frames[i].sequence = 0;
+    }
+  }
+
+  CameraCapture::~CameraCapture() {
+    stop();
+  }
+
+  void CameraCapture::start() {
+    if(_running)
+      return;
+
+    _running = true;
+    _thread = std::thread(&CameraCapture::runThread, this);
+    Log::success("Camera capture thread running.");
+  }
+
+  void CameraCapture::stop() {
+    if(!_running)
+      return;
+
+    _running = false;
+    _thread.join();
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _frameReady.notify_all();
+    }
+
+    Log::info("Camera capture stopped. " + std::to_string(_captured.load()) + " frames grabbed, " +
+              std::to_string(_dropped.load()) + " never used.");
+  }
+
+  const CameraCapture::Frame* CameraCapture::acquireLatest(int timeoutMilliseconds) {
+    if(!(_publishedSlot.load() & NEW_FRAME) && timeoutMilliseconds > 0) {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _frameReady.wait_for(lock, std::chrono::milliseconds(timeoutMilliseconds),
+                           [this]{ return (_publishedSlot.load() & NEW_FRAME) || !_running; });
+    }
+
+    if(!(_publishedSlot.load() & NEW_FRAME))
+      return nullptr;
+
+    // Hand our slot back and take the published one
+    _frontSlot = _publishedSlot.exchange(_frontSlot) & ~NEW_FRAME;
+
+    return &_frames[_frontSlot];
+  }
+
+  unsigned long CameraCapture::getCapturedCount() const {
+    return _captured.load();
+  }
+
+  unsigned long CameraCapture::getDroppedCount() const {
+    return _dropped.load();
+  }
+
+  void CameraCapture::runThread() {
+    ThreadManager::getInstance().registerCurrentThread("capture");
+
+    while(_running) {
+      Frame& frame = _frames[_backSlot];
+
+      if(!_source.grab()) {
+        // Retried every 10 ms, an unplugged camera must not flood the log
+        ARGOS_LOG_ERROR_EVERY(1.0f, "Could not grab a frame from " + _source.getName() + ".");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+
+      frame.timestamp = Clock::now();
+      ARGOS_TRACE_FRAME(_captured + 1);
+      {
+        ARGOS_TRACE_SPAN("capture");
+        _source.retrieve(frame.image);
+      }
+      frame.sequence = ++_captured;
+
+      // Publish the frame and keep the previous one, unless the reader has it
+      int previous = _publishedSlot.exchange(_backSlot | NEW_FRAME);
+      if(previous & NEW_FRAME)
+        ++_dropped;
+      _backSlot = previous & ~NEW_FRAME;
+
+      std::lock_guard<std::mutex> lock(_mutex);
+      _frameReady.notify_one();
+    }
+
+    ThreadManager::getInstance().unregisterCurrentThread();
+  }
+
+}
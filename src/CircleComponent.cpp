@@ -3,6 +3,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "GpuCounters.h"
+
 namespace argosClient {
 
   CircleComponent::CircleComponent(GLfloat radius)
@@ -53,12 +55,12 @@ namespace argosClient {
 
     glUniformMatrix4fv(_mvpHandler, 1, GL_FALSE, glm::value_ptr(_projectionMatrix * _modelViewMatrix * _model));
 
-    glEnable(GL_BLEND);
+    GpuCounters::setBlend(true);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
+    GpuCounters::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
 
-    glDisable(GL_BLEND);
+    GpuCounters::setBlend(false);
   }
 
 }
@@ -0,0 +1,80 @@
+#include "ClipCache.h"
+
+#include <sys/stat.h>
+
+#include "Log.h"
+
+namespace argosClient {
+
+  ClipCache::ClipCache()
+    : _cachePath("data/videos/cache/"), _maxClipBytes(64 * 1024 * 1024) {
+
+  }
+
+  void ClipCache::setCachePath(const std::string& path) {
+    _cachePath = path;
+  }
+
+  void ClipCache::setMaxClipBytes(size_t bytes) {
+    _maxClipBytes = bytes;
+  }
+
+  ClipCache::VideoClipPtr ClipCache::get(const std::string& videoFile) {
+    auto it = _clips.find(videoFile);
+    if(it != _clips.end()) {
+      return it->second;
+    }
+
+    VideoClipPtr clip;
+    if(build(videoFile)) {
+      clip = std::make_shared<VideoClip>();
+      if(!clip->open(clipFileFor(videoFile))) {
+        clip.reset();
+      }
+    }
+
+    // Videos which can not be cached are remembered too, so they are not decoded twice
+    _clips[videoFile] = clip;
+
+    return clip;
+  }
+
+  bool ClipCache::build(const std::string& videoFile) {
+    struct stat videoStat, clipStat;
+    std::string clipFile = clipFileFor(videoFile);
+
+    if(stat(videoFile.c_str(), &videoStat) < 0) {
+      Log::error("Video file '" + videoFile + "' does not exist.");
+      return false;
+    }
+
+    if(stat(clipFile.c_str(), &clipStat) == 0 && clipStat.st_mtime >= videoStat.st_mtime) {
+      return true;
+    }
+
+    mkdir(_cachePath.c_str(), 0755);
+
+    Log::info("Building clip for '" + videoFile + "'...");
+    return VideoClip::convert(videoFile, clipFile, _maxClipBytes);
+  }
+
+  void ClipCache::purge() {
+    for(auto it = _clips.begin(); it != _clips.end();) {
+      if(it->second.use_count() == 1)
+        it = _clips.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  std::string ClipCache::clipFileFor(const std::string& videoFile) const {
+    std::string name = videoFile;
+
+    size_t slash = name.find_last_of('/');
+    if(slash != std::string::npos)
+      name = name.substr(slash + 1);
+
+    return _cachePath + name + ".clip";
+  }
+
+}
@@ -8,8 +8,14 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <atomic>
+#include <opencv2/opencv.hpp>
 
 #include "Log.h"
+#include "Trace.h"
+#include "TaskPool.h"
 
 namespace argosClient {
 
@@ -21,10 +27,21 @@ namespace argosClient {
     _context = nullptr;
     _surface = nullptr;
 
+    _captureEvery = 1;
+    _captureDigits = 0;
+    _frameNumber = 0;
+
+#ifdef ARGOS_HEADLESS
+    // No display to ask, setScreen() gives the size of the pbuffer
+    _width = HEADLESS_WIDTH;
+    _height = HEADLESS_HEIGHT;
+    Log::info("Headless OpenGL ES 2.0 context resolution: " + std::to_string(_width) + "x" + std::to_string(_height) + ".");
+#else
     int32_t success = 0;
     success = graphics_get_display_size(0, &_width, &_height);
     assert(success >= 0);
     Log::info("OpenGL ES 2.0 context resolution: " + std::to_string(_width) + "x" + std::to_string(_height) + ".");
+#endif
 
     if(!config) {
       Log::info("Making new config...");
@@ -54,17 +71,14 @@ namespace argosClient {
   }
 
   void EGLWindow::makeSurface(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
-    static EGL_DISPMANX_WINDOW_T nativeWindow;
     EGLBoolean result;
-    VC_RECT_T dstRect;
-    VC_RECT_T srcRect;
 
     static const EGLint contextAttributes[] = {
       EGL_CONTEXT_CLIENT_VERSION, 2,
       EGL_NONE
     };
 
-    _display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    _display = getDisplay();
     if(_display == EGL_NO_DISPLAY) {
       Log::error("Getting display: EGL_NO_DISPLAY.");
       exit(EXIT_FAILURE);
@@ -78,6 +92,9 @@ namespace argosClient {
       exit(EXIT_FAILURE);
     }
 
+#ifdef ARGOS_HEADLESS
+    _config->setSurface(EGL_PBUFFER_BIT);
+#endif
     _config->chooseConfig(_display);
     EGLConfig config = _config->getConfig();
     result = eglBindAPI(EGL_OPENGL_ES_API);
@@ -92,6 +109,57 @@ namespace argosClient {
       exit(EXIT_FAILURE);
     }
 
+    _surface = createSurface(config, x, y, w, h);
+    assert(_surface != EGL_NO_SURFACE);
+
+    result = eglMakeCurrent(_display, _surface, _surface, _context);
+    assert(EGL_FALSE != result);
+
+    _activeSurface = true;
+
+    Log::success("Surface created.");
+  }
+
+  EGLDisplay EGLWindow::getDisplay() const {
+#if defined(ARGOS_HEADLESS) && defined(EGL_PLATFORM_SURFACELESS_MESA)
+    // Without any window system, Mesa still offers pbuffers on its surfaceless platform
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if(extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+      PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+      if(getPlatformDisplay) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if(display != EGL_NO_DISPLAY) {
+          Log::info("Using the Mesa surfaceless platform.");
+          return display;
+        }
+      }
+    }
+#endif
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+#ifdef ARGOS_HEADLESS
+  EGLSurface EGLWindow::createSurface(EGLConfig config, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    const EGLint surfaceAttributes[] = {
+      EGL_WIDTH, (EGLint) w,
+      EGL_HEIGHT, (EGLint) h,
+      EGL_NONE
+    };
+
+    // The pbuffer is the whole screen
+    _width = w;
+    _height = h;
+
+    return eglCreatePbufferSurface(_display, config, surfaceAttributes);
+  }
+#else
+  EGLSurface EGLWindow::createSurface(EGLConfig config, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    static EGL_DISPMANX_WINDOW_T nativeWindow;
+    VC_RECT_T dstRect;
+    VC_RECT_T srcRect;
+
     // Create an EGL window surface the way this works is we set the dimensions of the srec
     // and destination rectangles.
     // If these are the same size there is no scaling, else the window will auto scale
@@ -125,16 +193,9 @@ namespace argosClient {
 
     vc_dispmanx_update_submit_sync(_dispmanUpdate);
 
-    _surface = eglCreateWindowSurface(_display, config, &nativeWindow, nullptr);
-    assert(_surface != EGL_NO_SURFACE);
-
-    result = eglMakeCurrent(_display, _surface, _surface, _context);
-    assert(EGL_FALSE != result);
-
-    _activeSurface = true;
-
-    Log::success("Surface created.");
+    return eglCreateWindowSurface(_display, config, &nativeWindow, nullptr);
   }
+#endif
 
   void EGLWindow::destroySurface() {
     if(_activeSurface) {
@@ -148,9 +209,146 @@ namespace argosClient {
   }
 
   void EGLWindow::swapBuffers() const {
+    if(!_capturePattern.empty())
+      captureFrame();
+
+    ARGOS_TRACE_SPAN("swapBuffers");
     eglSwapBuffers(_display, _surface);
   }
 
+  /**
+   * Reads the back buffer as GL stores it: RGBA, bottom row first
+   */
+  static bool readBackBuffer(EGLDisplay display, EGLSurface surface, cv::Mat& rgba) {
+    EGLint width, height;
+    if(!eglQuerySurface(display, surface, EGL_WIDTH, &width) || !eglQuerySurface(display, surface, EGL_HEIGHT, &height))
+      return false;
+
+    rgba.create(height, width, CV_8UC4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data);
+
+    return glGetError() == GL_NO_ERROR;
+  }
+
+  /**
+   * Turns a back buffer read into an OpenCV image
+   */
+  static void toBGR(const cv::Mat& rgba, cv::Mat& frame) {
+    cv::cvtColor(rgba, frame, CV_RGBA2BGR);
+    cv::flip(frame, frame, 0);
+  }
+
+  bool EGLWindow::readPixels(cv::Mat& frame) const {
+    if(!_activeSurface)
+      return false;
+
+    cv::Mat rgba;
+    if(!readBackBuffer(_display, _surface, rgba))
+      return false;
+    toBGR(rgba, frame);
+
+    return true;
+  }
+
+  // The captured frames being converted and encoded by the TaskPool, beyond this the next ones are skipped
+  static const int MAX_PENDING_CAPTURES = 4;
+  static std::atomic<int> pendingCaptures(0);
+
+  /**
+   * Splits a capture pattern around its only frame number, so no user string is ever used as a format
+   * @return false unless the pattern has exactly one %d or %0<width>d, "%%" standing for "%"
+   */
+  static bool parseCapturePattern(const std::string& pattern, std::string& prefix, int& digits, std::string& suffix) {
+    std::string* part = &prefix;
+    bool found = false;
+    prefix.clear();
+    suffix.clear();
+    digits = 0;
+
+    for(size_t i = 0; i < pattern.size(); ++i) {
+      if(pattern[i] != '%') {
+        *part += pattern[i];
+        continue;
+      }
+
+      if(i + 1 < pattern.size() && pattern[i + 1] == '%') {
+        *part += '%';
+        ++i;
+        continue;
+      }
+
+      size_t end = i + 1;
+      while(end < pattern.size() && isdigit((unsigned char) pattern[end]))
+        ++end;
+      if(found || end >= pattern.size() || pattern[end] != 'd' || end - i - 1 > 2)
+        return false;
+
+      digits = end > i + 1 ? atoi(pattern.substr(i + 1, end - i - 1).c_str()) : 0;
+      found = true;
+      part = &suffix;
+      i = end;
+    }
+
+    return found;
+  }
+
+  void EGLWindow::setFrameCapture(const std::string& pattern, unsigned int every) {
+    _capturePattern.clear();
+    if(!pattern.empty() && !parseCapturePattern(pattern, _capturePrefix, _captureDigits, _captureSuffix)) {
+      Log::error("The capture pattern '" + pattern + "' needs exactly one %d or %0<width>d, frames are not captured.");
+      return;
+    }
+
+    _capturePattern = pattern;
+    _captureEvery = (every > 0) ? every : 1;
+    _frameNumber = 0;
+
+    if(!pattern.empty())
+      Log::info("Capturing one frame out of " + std::to_string(_captureEvery) + " to '" + pattern + "'.");
+  }
+
+  void EGLWindow::captureFrame() const {
+    unsigned int number = _frameNumber++;
+    if(number % _captureEvery != 0 || !_activeSurface)
+      return;
+
+    // Encoding every frame can be slower than rendering them, the queue must not grow without bound
+    if(pendingCaptures.load() >= MAX_PENDING_CAPTURES) {
+      ARGOS_LOG_ERROR_EVERY(5.0f, "Frame capture is falling behind, frames are skipped.");
+      return;
+    }
+
+    ARGOS_TRACE_SPAN("captureFrame");
+    std::shared_ptr<cv::Mat> rgba = std::make_shared<cv::Mat>();
+    if(!readBackBuffer(_display, _surface, *rgba)) {
+      ARGOS_LOG_ERROR_EVERY(5.0f, "Could not read the captured frame back.");
+      return;
+    }
+
+    std::string digits = std::to_string(number);
+    if((int) digits.size() < _captureDigits)
+      digits.insert(0, _captureDigits - digits.size(), '0');
+    std::string file = _capturePrefix + digits + _captureSuffix;
+
+    // Converting and encoding take longer than the read back
+    pendingCaptures++;
+    TaskPool::getInstance().post([rgba, file]() {
+      cv::Mat frame;
+      toBGR(*rgba, frame);
+      if(!cv::imwrite(file, frame))
+        Log::error("Could not write the captured frame '" + file + "'.");
+      pendingCaptures--;
+    });
+  }
+
+  void EGLWindow::setSwapInterval(int interval) {
+    if(eglSwapInterval(_display, interval) == EGL_TRUE)
+      Log::info("EGL swap interval set to " + std::to_string(interval) + ".");
+    else
+      Log::error("Could not set the EGL swap interval to " + std::to_string(interval) + ".");
+  }
+
   void EGLWindow::resizeScreen(uint32_t w, uint32_t h) {
     destroySurface();
     makeSurface(0, 0, w, h);
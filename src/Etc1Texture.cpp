@@ -0,0 +1,326 @@
+#include "Etc1Texture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+
+#include "Log.h"
+
+namespace argosClient {
+
+  static const char PKM_MAGIC[6] = { 'P', 'K', 'M', ' ', '1', '0' };
+  static const size_t PKM_HEADER_SIZE = 16;
+  static const int BLOCK_SIZE = 8;
+
+  // The intensity modifiers of the ETC1 specification, in pixel index order
+  static const int MODIFIERS[8][4] = {
+    {  2,   8,  -2,   -8 },
+    {  5,  17,  -5,  -17 },
+    {  9,  29,  -9,  -29 },
+    { 13,  42, -13,  -42 },
+    { 18,  60, -18,  -60 },
+    { 24,  80, -24,  -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 }
+  };
+
+  /**
+   * A sub-block candidate: its base colour, table and pixel indices
+   */
+  struct SubBlock {
+    int base[3]; ///< The base colour, expanded to 8 bits
+    int table; ///< The modifier table
+    int error; ///< The squared error of the best pixel indices
+    int indices[8]; ///< The modifier of every pixel of the sub-block
+  };
+
+  static inline int clamp255(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+  }
+
+  /**
+   * Picks the table and the pixel indices which best approximate 8 pixels from a base colour
+   */
+  static void fitSubBlock(const int pixels[8][3], SubBlock& sub) {
+    sub.error = INT_MAX;
+    for(int t = 0; t < 8; ++t) {
+      int error = 0;
+      int indices[8];
+      for(int p = 0; p < 8 && error < sub.error; ++p) {
+        int best = INT_MAX;
+        for(int m = 0; m < 4; ++m) {
+          int e = 0;
+          for(int c = 0; c < 3; ++c) {
+            int d = clamp255(sub.base[c] + MODIFIERS[t][m]) - pixels[p][c];
+            e += d * d;
+          }
+          if(e < best) {
+            best = e;
+            indices[p] = m;
+          }
+        }
+        error += best;
+      }
+
+      if(error < sub.error) {
+        sub.error = error;
+        sub.table = t;
+        memcpy(sub.indices, indices, sizeof(indices));
+      }
+    }
+  }
+
+  /**
+   * Compresses a 4x4 block of RGB pixels, stored column by column as ETC1 numbers them
+   */
+  static void encodeBlock(const int block[16][3], unsigned char* out) {
+    int bestError = INT_MAX;
+    uint64_t bestBits = 0;
+
+    for(int flip = 0; flip < 2; ++flip) {
+      // Not flipped: two 2x4 halves side by side. Flipped: two 4x2 halves on top of each other
+      int pixels[2][8][3];
+      int positions[2][8];
+      int count[2] = { 0, 0 };
+      for(int i = 0; i < 16; ++i) {
+        int x = i / 4, y = i % 4;
+        int half = flip ? (y >= 2) : (x >= 2);
+        positions[half][count[half]] = i;
+        memcpy(pixels[half][count[half]++], block[i], sizeof(block[i]));
+      }
+
+      int average[2][3];
+      for(int h = 0; h < 2; ++h) {
+        for(int c = 0; c < 3; ++c) {
+          int sum = 0;
+          for(int p = 0; p < 8; ++p)
+            sum += pixels[h][p][c];
+          average[h][c] = (sum + 4) / 8;
+        }
+      }
+
+      for(int differential = 0; differential < 2; ++differential) {
+        SubBlock subs[2];
+        int quantized[2][3];
+        for(int c = 0; c < 3; ++c) {
+          if(differential) {
+            // 5 bits for the first colour, the second one within [-4, 3] of it
+            quantized[0][c] = (average[0][c] * 31 + 127) / 255;
+            int second = (average[1][c] * 31 + 127) / 255;
+            int delta = second - quantized[0][c];
+            quantized[1][c] = quantized[0][c] + (delta < -4 ? -4 : (delta > 3 ? 3 : delta));
+            for(int h = 0; h < 2; ++h)
+              subs[h].base[c] = (quantized[h][c] << 3) | (quantized[h][c] >> 2);
+          }
+          else {
+            // 4 bits for each colour
+            for(int h = 0; h < 2; ++h) {
+              quantized[h][c] = (average[h][c] * 15 + 127) / 255;
+              subs[h].base[c] = quantized[h][c] * 17;
+            }
+          }
+        }
+
+        fitSubBlock(pixels[0], subs[0]);
+        fitSubBlock(pixels[1], subs[1]);
+        int error = subs[0].error + subs[1].error;
+        if(error >= bestError)
+          continue;
+
+        uint64_t bits = 0;
+        for(int c = 0; c < 3; ++c) {
+          uint64_t colour = differential ? ((quantized[0][c] << 3) | ((quantized[1][c] - quantized[0][c]) & 7))
+                                         : ((quantized[0][c] << 4) | quantized[1][c]);
+          bits |= colour << (56 - 8 * c);
+        }
+        bits |= (uint64_t) subs[0].table << 37;
+        bits |= (uint64_t) subs[1].table << 34;
+        bits |= (uint64_t) differential << 33;
+        bits |= (uint64_t) flip << 32;
+        for(int h = 0; h < 2; ++h) {
+          for(int p = 0; p < 8; ++p) {
+            int index = subs[h].indices[p];
+            int position = positions[h][p];
+            bits |= (uint64_t) (index >> 1) << (16 + position);
+            bits |= (uint64_t) (index & 1) << position;
+          }
+        }
+
+        bestError = error;
+        bestBits = bits;
+      }
+    }
+
+    for(int i = 0; i < 8; ++i)
+      out[i] = (unsigned char) (bestBits >> (56 - 8 * i));
+  }
+
+  static inline void writeBigEndian16(unsigned char* out, int value) {
+    out[0] = (unsigned char) (value >> 8);
+    out[1] = (unsigned char) value;
+  }
+
+  static inline int readBigEndian16(const unsigned char* in) {
+    return (in[0] << 8) | in[1];
+  }
+
+  Etc1Texture::Etc1Texture() {
+
+  }
+
+  void Etc1Texture::encode(const unsigned char* pixels, int width, int height, int channels, Plane plane) {
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+
+    _levels.push_back(Level());
+    Level& level = _levels.back();
+    level.width = width;
+    level.height = height;
+    level.data.resize((size_t) blocksX * blocksY * BLOCK_SIZE);
+
+    for(int by = 0; by < blocksY; ++by) {
+      for(int bx = 0; bx < blocksX; ++bx) {
+        int block[16][3];
+        for(int x = 0; x < 4; ++x) {
+          for(int y = 0; y < 4; ++y) {
+            // The borders are replicated into the blocks sticking out of the image
+            int px = bx * 4 + x < width ? bx * 4 + x : width - 1;
+            int py = by * 4 + y < height ? by * 4 + y : height - 1;
+            const unsigned char* pixel = pixels + ((size_t) py * width + px) * channels;
+            int* out = block[x * 4 + y];
+
+            if(plane == ALPHA)
+              out[0] = out[1] = out[2] = (channels == 2 || channels == 4) ? pixel[channels - 1] : 255;
+            else if(channels < 3)
+              out[0] = out[1] = out[2] = pixel[0];
+            else
+              for(int c = 0; c < 3; ++c)
+                out[c] = pixel[c];
+          }
+        }
+
+        encodeBlock(block, &level.data[((size_t) by * blocksX + bx) * BLOCK_SIZE]);
+      }
+    }
+  }
+
+  bool Etc1Texture::load(const std::string& pkmFile) {
+    FILE* f = fopen(pkmFile.c_str(), "rb");
+    if(!f)
+      return false;
+
+    _levels.clear();
+
+    // One PKM header and its blocks per level, until the end of the file
+    unsigned char header[PKM_HEADER_SIZE];
+    bool ok = true;
+    size_t read;
+    while(ok && (read = fread(header, 1, PKM_HEADER_SIZE, f)) > 0) {
+      ok = read == PKM_HEADER_SIZE && memcmp(header, PKM_MAGIC, sizeof(PKM_MAGIC)) == 0 && readBigEndian16(header + 6) == 0;
+      if(!ok)
+        break;
+
+      Level level;
+      int extendedWidth = readBigEndian16(header + 8);
+      int extendedHeight = readBigEndian16(header + 10);
+      level.width = readBigEndian16(header + 12);
+      level.height = readBigEndian16(header + 14);
+      ok = level.width > 0 && level.height > 0 &&
+           extendedWidth == (level.width + 3) / 4 * 4 && extendedHeight == (level.height + 3) / 4 * 4;
+      if(ok) {
+        level.data.resize((size_t) extendedWidth * extendedHeight / 2);
+        ok = fread(&level.data[0], 1, level.data.size(), f) == level.data.size();
+        _levels.push_back(level);
+      }
+    }
+    fclose(f);
+
+    if(!ok || _levels.empty()) {
+      Log::error("PKM file '" + pkmFile + "' is not a valid ETC1 texture.");
+      _levels.clear();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool Etc1Texture::save(const std::string& pkmFile) const {
+    // Several workers may build the same texture, each one writes a file of its own
+    std::string tmpFile = pkmFile + "." + std::to_string(getpid()) + "." + std::to_string((unsigned long) this) + ".tmp";
+    FILE* f = fopen(tmpFile.c_str(), "wb");
+    if(!f) {
+      Log::error("Could not create the PKM file '" + tmpFile + "'.");
+      return false;
+    }
+
+    bool ok = true;
+    for(const Level& level : _levels) {
+      unsigned char header[PKM_HEADER_SIZE];
+      memcpy(header, PKM_MAGIC, sizeof(PKM_MAGIC));
+      writeBigEndian16(header + 6, 0); // ETC1_RGB_NO_MIPMAPS
+      writeBigEndian16(header + 8, (level.width + 3) / 4 * 4);
+      writeBigEndian16(header + 10, (level.height + 3) / 4 * 4);
+      writeBigEndian16(header + 12, level.width);
+      writeBigEndian16(header + 14, level.height);
+
+      ok = ok && fwrite(header, 1, PKM_HEADER_SIZE, f) == PKM_HEADER_SIZE &&
+           fwrite(&level.data[0], 1, level.data.size(), f) == level.data.size();
+    }
+    ok = fclose(f) == 0 && ok;
+
+    if(!ok || rename(tmpFile.c_str(), pkmFile.c_str()) != 0) {
+      Log::error("Could not write the PKM file '" + pkmFile + "'.");
+      unlink(tmpFile.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  bool Etc1Texture::isEmpty() const {
+    return _levels.empty();
+  }
+
+  int Etc1Texture::getLevelCount() const {
+    return _levels.size();
+  }
+
+  int Etc1Texture::getWidth(int level) const {
+    return _levels[level].width;
+  }
+
+  int Etc1Texture::getHeight(int level) const {
+    return _levels[level].height;
+  }
+
+  const unsigned char* Etc1Texture::getData(int level) const {
+    return &_levels[level].data[0];
+  }
+
+  size_t Etc1Texture::getSize(int level) const {
+    return _levels[level].data.size();
+  }
+
+  size_t Etc1Texture::getTotalSize() const {
+    size_t size = 0;
+    for(const Level& level : _levels)
+      size += level.data.size();
+
+    return size;
+  }
+
+  bool Etc1Texture::hasAlpha(const unsigned char* pixels, int width, int height, int channels) {
+    if(channels != 2 && channels != 4)
+      return false;
+
+    size_t count = (size_t) width * height;
+    for(size_t i = 0; i < count; ++i) {
+      if(pixels[i * channels + channels - 1] != 255)
+        return true;
+    }
+
+    return false;
+  }
+
+}
@@ -1,46 +1,71 @@
 #include "EventManager.h"
 #include <iostream>
+#include <chrono>
+
+#include "Log.h"
 
 namespace argosClient {
 
-  void EventManager::addEvent(EventManager::EventType ev) {
-    if(_eventsQueue.size() > MAX_EVENTS)
-      _eventsQueue.pop_front();
+  EventManager::EventManager()
+    : _eventsQueue(MAX_EVENTS), _overflows(0), _waiting(false) {
 
-    _eventsQueue.push_back(ev);
   }
 
-  EventManager::EventType EventManager::popEvent() {
-    EventType ev = EventType::NONE;
+  bool EventManager::addEvent(const EventManager::Event& ev) {
+    if(!_eventsQueue.tryPush(ev)) {
+      unsigned long overflows = ++_overflows;
+
+      // Only log when the count doubles, the main thread is already behind
+      if((overflows & (overflows - 1)) == 0)
+        Log::error("Event queue full, " + std::to_string(overflows) + " events dropped so far.");
+
+      return false;
+    }
 
-    if(!_eventsQueue.empty()) {
-      ev = _eventsQueue.back();
-      _eventsQueue.pop_back();
+    // Pairs with the fence in waitEvent: either the consumer sees the event or we see it waiting.
+    // The lock keeps the wakeup from slipping between its check and its wait
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(_waiting.load()) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _eventAdded.notify_one();
     }
 
+    return true;
+  }
+
+  EventManager::Event EventManager::popEvent() {
+    Event ev;
+    _eventsQueue.tryPop(ev);
+
+    return ev;
+  }
+
+  EventManager::Event EventManager::waitEvent(long timeoutMicroseconds) {
+    Event ev;
+    if(_eventsQueue.tryPop(ev) || timeoutMicroseconds <= 0)
+      return ev;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _waiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    _eventAdded.wait_for(lock, std::chrono::microseconds(timeoutMicroseconds), [this, &ev]{ return _eventsQueue.tryPop(ev); });
+    _waiting.store(false);
+
     return ev;
   }
 
   void EventManager::clearQueue() {
-    _eventsQueue.clear();
+    Event ev;
+    while(_eventsQueue.tryPop(ev));
   }
 
   void EventManager::visualizeQueue() {
-    std::cout << "[";
-    for(EventType ev : _eventsQueue) {
-      switch(ev) {
-      case EventType::TD_THREAD_READY:
-        std::cout << "R|";
-        break;
-      case EventType::TD_THREAD_FINISHED:
-        std::cout << "F|";
-        break;
-      case EventType::NONE:
-        std::cout << "*|";
-        break;
-      }
-    }
-    std::cout << "]" << std::endl;
+    std::cout << "[" << _eventsQueue.size() << "/" << _eventsQueue.capacity() << " events, "
+              << _overflows.load() << " dropped]" << std::endl;
+  }
+
+  unsigned long EventManager::getOverflowCount() const {
+    return _overflows.load();
   }
 
 }
@@ -0,0 +1,70 @@
+#include "FileFrameSource.h"
+
+#include <thread>
+#include <algorithm>
+
+#include "Log.h"
+
+namespace argosClient {
+
+  const float FileFrameSource::DEFAULT_FPS = 30.0f;
+
+  FileFrameSource::FileFrameSource(const std::string& path, float fps, int width, int height)
+    : FrameSource(width, height), _path(path), _fps(fps) {
+
+  }
+
+  bool FileFrameSource::open() {
+    if(!_reader.open(_path)) {
+      Log::error("Could not open '" + _path + "' as a frame source.");
+      return false;
+    }
+
+    if(_fps <= 0.0f) {
+      _fps = (float) _reader.get(CV_CAP_PROP_FPS);
+      if(!(_fps > 0.0f) || _fps > 120.0f)
+        _fps = DEFAULT_FPS;
+    }
+
+    _nextFrame = Clock::now();
+
+    return true;
+  }
+
+  bool FileFrameSource::isOpened() const {
+    return _reader.isOpened();
+  }
+
+  bool FileFrameSource::grab() {
+    // Deliver frames at the rate of a camera, not as fast as they can be decoded
+    std::this_thread::sleep_until(_nextFrame);
+    _nextFrame = std::max(_nextFrame + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _fps)),
+                          Clock::now());
+
+    if(_reader.read(_frame) && !_frame.empty())
+      return true;
+
+    // Start again
+    _reader.release();
+    if(!_reader.open(_path))
+      return false;
+
+    return _reader.read(_frame) && !_frame.empty();
+  }
+
+  void FileFrameSource::retrieve(cv::Mat& image) {
+    if(_frame.cols == _width && _frame.rows == _height)
+      _frame.copyTo(image);
+    else
+      cv::resize(_frame, image, cv::Size(_width, _height), 0, 0, cv::INTER_AREA);
+  }
+
+  void FileFrameSource::release() {
+    _reader.release();
+  }
+
+  std::string FileFrameSource::getName() const {
+    return "file " + _path + " at " + std::to_string((int) _fps) + " fps";
+  }
+
+}
@@ -0,0 +1,125 @@
+#include "FrameScheduler.h"
+
+#include <time.h>
+#include <cstdio>
+
+#include "Log.h"
+#include "Metrics.h"
+
+namespace argosClient {
+
+  const float FrameScheduler::DEFAULT_FPS = 30.0f;
+  const float FrameScheduler::REPORT_SECONDS = 10.0f;
+
+  static double cpuSeconds(clockid_t clock) {
+    struct timespec time;
+    clock_gettime(clock, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+  }
+
+  FrameScheduler::FrameScheduler(float fps)
+    : _fpsFrames(0), _frames(0), _frameTime(0), _maxFrameTime(0), _lateFrames(0), _averageFrameTime(0.0f), _cpuUsage(0.0f) {
+    setTargetFps(fps);
+
+    _deadline = _frameStart = _periodStart = _fpsStart = Clock::now();
+    _processCpuStart = cpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    _threadCpuStart = cpuSeconds(CLOCK_THREAD_CPUTIME_ID);
+  }
+
+  void FrameScheduler::setTargetFps(float fps) {
+    if(fps > 0.0f)
+      _period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    else
+      _period = Clock::duration::zero();
+  }
+
+  float FrameScheduler::getTargetFps() const {
+    if(_period == Clock::duration::zero())
+      return 0.0f;
+
+    return 1.0f / std::chrono::duration<float>(_period).count();
+  }
+
+  long FrameScheduler::getTimeToDeadline() const {
+    Clock::duration left = _deadline - Clock::now();
+    if(left <= Clock::duration::zero())
+      return 0;
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(left).count();
+  }
+
+  bool FrameScheduler::isFrameDue() const {
+    return Clock::now() >= _deadline;
+  }
+
+  void FrameScheduler::beginFrame() {
+    _frameStart = Clock::now();
+  }
+
+  void FrameScheduler::endFrame() {
+    Clock::time_point now = Clock::now();
+    Clock::duration frameTime = now - _frameStart;
+
+    static Histogram& frameTimes = Metrics::getInstance().histogram("frame_time_ms");
+    frameTimes.record(std::chrono::duration<double, std::milli>(frameTime).count());
+
+    // The frame rate gauge is refreshed every second, the log report is much less frequent
+    _fpsFrames++;
+    if(now - _fpsStart >= std::chrono::seconds(1)) {
+      static Gauge& fps = Metrics::getInstance().gauge("fps");
+      fps.set(_fpsFrames / std::chrono::duration<double>(now - _fpsStart).count());
+      _fpsStart = now;
+      _fpsFrames = 0;
+    }
+
+    _frames++;
+    _frameTime += frameTime;
+    if(frameTime > _maxFrameTime)
+      _maxFrameTime = frameTime;
+
+    // Keep a steady cadence, but do not try to catch up with frames already missed
+    _deadline += _period;
+    if(_deadline < now) {
+      if(_period != Clock::duration::zero())
+        _lateFrames++;
+      _deadline = now;
+    }
+
+    if(now - _periodStart >= std::chrono::duration<float>(REPORT_SECONDS))
+      report();
+  }
+
+  float FrameScheduler::getAverageFrameTime() const {
+    return _averageFrameTime;
+  }
+
+  float FrameScheduler::getCpuUsage() const {
+    return _cpuUsage;
+  }
+
+  void FrameScheduler::report() {
+    Clock::time_point now = Clock::now();
+    double processCpu = cpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    double threadCpu = cpuSeconds(CLOCK_THREAD_CPUTIME_ID);
+    double elapsed = std::chrono::duration<double>(now - _periodStart).count();
+
+    _averageFrameTime = _frames ? std::chrono::duration<float, std::milli>(_frameTime).count() / _frames : 0.0f;
+    _cpuUsage = (float) (100.0 * (processCpu - _processCpuStart) / elapsed);
+    float threadUsage = (float) (100.0 * (threadCpu - _threadCpuStart) / elapsed);
+
+    char line[256];
+    snprintf(line, sizeof(line), "%.1f fps (target %.0f, %d late). Frame %.2f ms avg, %.2f ms max. CPU %.0f%% (main thread %.0f%%).",
+             _frames / elapsed, getTargetFps(), _lateFrames, _averageFrameTime,
+             std::chrono::duration<float, std::milli>(_maxFrameTime).count(), _cpuUsage, threadUsage);
+    Log::info(line);
+
+    _periodStart = now;
+    _processCpuStart = processCpu;
+    _threadCpuStart = threadCpu;
+    _frames = 0;
+    _frameTime = Clock::duration::zero();
+    _maxFrameTime = Clock::duration::zero();
+    _lateFrames = 0;
+  }
+
+}
@@ -0,0 +1,67 @@
+#include "FrameSource.h"
+
+#include <cstdlib>
+
+#include "V4L2FrameSource.h"
+#include "FileFrameSource.h"
+#include "SyntheticFrameSource.h"
+#ifdef ARGOS_WITH_RASPICAM
+#include "RaspicamFrameSource.h"
+#endif
+#include "Log.h"
+
+namespace argosClient {
+
+  std::unique_ptr<FrameSource> FrameSource::create(const std::string& spec, int width, int height) {
+    std::string type = spec;
+    std::string argument;
+
+    size_t colon = spec.find(':');
+    if(colon != std::string::npos) {
+      type = spec.substr(0, colon);
+      argument = spec.substr(colon + 1);
+    }
+
+    if(type == "raspicam") {
+#ifdef ARGOS_WITH_RASPICAM
+      return std::unique_ptr<FrameSource>(new RaspicamFrameSource(width, height));
+#else
+      Log::error("This build has no raspicam support.");
+      return nullptr;
+#endif
+    }
+
+    if(type == "v4l2") {
+      return std::unique_ptr<FrameSource>(new V4L2FrameSource(argument.empty() ? "/dev/video0" : argument, width, height));
+    }
+
+    if(type == "file" && !argument.empty()) {
+      float fps = 0.0f;
+
+      size_t at = argument.rfind('@');
+      if(at != std::string::npos) {
+        fps = atof(argument.substr(at + 1).c_str());
+        argument = argument.substr(0, at);
+      }
+
+      return std::unique_ptr<FrameSource>(new FileFrameSource(argument, fps, width, height));
+    }
+
+    if(type == "synthetic") {
+      float fps = argument.empty() ? SyntheticFrameSource::DEFAULT_FPS : atof(argument.c_str());
+      return std::unique_ptr<FrameSource>(new SyntheticFrameSource(fps, width, height));
+    }
+
+    Log::error("Unknown frame source '" + spec + "'.");
+    return nullptr;
+  }
+
+  std::string FrameSource::getDefaultSpec() {
+#ifdef ARGOS_WITH_RASPICAM
+    return "raspicam";
+#else
+    return "v4l2:/dev/video0";
+#endif
+  }
+
+}
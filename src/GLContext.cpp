@@ -1,6 +1,7 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 
 #include <glm/glm.hpp>
@@ -13,6 +14,11 @@
 #include "TaskDelegation.h"
 #include "Log.h"
 #include "AudioManager.h"
+#include "SoundScheduler.h"
+#include "TtsCache.h"
+#include "Trace.h"
+#include "GpuCounters.h"
+#include "TextureCache.h"
 
 #include "DrawImageSF.h"
 #include "DrawVideoSF.h"
@@ -28,6 +34,7 @@
 
 #include "ImageComponent.h"
 #include "RectangleComponent.h"
+#include "MetricsOverlay.h"
 
 namespace argosClient {
 
@@ -35,12 +42,15 @@ namespace argosClient {
     : EGLWindow(config), _projectionMatrix(glm::mat4(1.0f)),
       _gcManager(GraphicComponentsManager::getInstance()),
       _audioManager(AudioManager::getInstance()),
-      _isVideostream(0), _isVideo1(0), _isVideo2(0), _isClothes(0) {
+      _soundScheduler(SoundScheduler::getInstance()),
+      _metricsOverlay(nullptr), _isVideostream(0), _isVideo1(0), _isVideo2(0), _isClothes(0) {
 
   }
 
   GLContext::~GLContext() {
     GraphicComponentsManager::getInstance().destroy();
+    TtsCache::getInstance().destroy();
+    SoundScheduler::getInstance().destroy();
     AudioManager::getInstance().destroy();
 
     for(auto& pair : _handlers) {
@@ -49,6 +59,7 @@ namespace argosClient {
 
     //delete _fingerPoint;
     delete _projArea;
+    delete _metricsOverlay;
 
     for(int i = 0; i < 2; ++i) {
       delete _videoButtonInv[i];
@@ -61,7 +72,7 @@ namespace argosClient {
   void GLContext::start() {
     // Audio dependencies
     _audioManager.setSoundsPath("data/sounds/");
-    _audioManager.getInstance().preloadAll();
+    _audioManager.preloadAllAsync();
 
     // Handlers
     _handlers[CallingFunctionType::DRAW_IMAGE] = new DrawImageSF;
@@ -76,8 +87,17 @@ namespace argosClient {
     _handlers[CallingFunctionType::PLAY_SOUND] = new PlaySoundSF;
     _handlers[CallingFunctionType::PLAY_SOUND_DELAYED] = new PlaySoundDelayedSF;
 
+    // Compressed textures need OES_compressed_ETC1_RGB8_texture, known once the context is current
+    TextureCache& textureCache = TextureCache::getInstance();
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if(textureCache.isEnabled() && (!extensions || !strstr(extensions, "GL_OES_compressed_ETC1_RGB8_texture"))) {
+      Log::info("The GPU does not support ETC1 textures, images are uploaded uncompressed.");
+      textureCache.setEnabled(false);
+    }
+
     // Graphic dependencies
     _gcManager.setProjectionMatrix(_projectionMatrix);
+    _gcManager.setScreenSize(_width, _height);
     _gcManager.setImagesPath("data/images/");
     _gcManager.setVideosPath("data/videos/");
     _gcManager.setFontsPath("data/fonts/");
@@ -90,7 +110,9 @@ namespace argosClient {
     //_fingerPoint->show(true);
 
     // Projection area
-    _projArea = new ImageComponent("data/images/background.jpg", 1.0f, 1.0f);
+    _projArea = new ImageComponent(1.0f, 1.0f);
+    _projArea->setTextureFit(_gcManager.getTextureFit(glm::vec2(1.0f, 1.0f), true));
+    _projArea->loadImageFromFileAsync("data/images/background.jpg");
     _projArea->setPosition(glm::vec3(0.0f, 0.0f, 0.0f));
     _projArea->noUpdate();
     _projArea->show(true);
@@ -99,29 +121,42 @@ namespace argosClient {
     _gcManager.createVideostream("Videostream", "videoconference.jpg", glm::vec2(10.5f, 14.85f), 9999);
 
     // Inverted buttons
-    _videoButtonInv[0] = new ImageComponent("data/images/VideoButton_inv.jpg", -1.25f, 1.25f);
+    TextureFit buttonFit = _gcManager.getTextureFit(glm::vec2(1.25f, 1.25f), false);
+    _videoButtonInv[0] = new ImageComponent(-1.25f, 1.25f);
+    _videoButtonInv[0]->setTextureFit(buttonFit);
+    _videoButtonInv[0]->loadImageFromFileAsync("data/images/VideoButton_inv.jpg");
     _videoButtonInv[0]->setProjectionMatrix(_projectionMatrix);
     _videoButtonInv[0]->setPosition(glm::vec3(-9.00f, -2.00f, 0.00f));
     _videoButtonInv[0]->show(false);
-    _videoButtonInv[1] = new ImageComponent("data/images/VideoButton_inv.jpg", -1.25f, 1.25f);
+    _videoButtonInv[1] = new ImageComponent(-1.25f, 1.25f);
+    _videoButtonInv[1]->setTextureFit(buttonFit);
+    _videoButtonInv[1]->loadImageFromFileAsync("data/images/VideoButton_inv.jpg");
     _videoButtonInv[1]->setProjectionMatrix(_projectionMatrix);
     _videoButtonInv[1]->setPosition(glm::vec3(-9.00f, 3.75f, 0.00f));
     _videoButtonInv[1]->show(false);
 
-    _handButtonInv[0] = new ImageComponent("data/images/HandButton_inv.jpg", -1.25f, 1.25f);
+    _handButtonInv[0] = new ImageComponent(-1.25f, 1.25f);
+    _handButtonInv[0]->setTextureFit(buttonFit);
+    _handButtonInv[0]->loadImageFromFileAsync("data/images/HandButton_inv.jpg");
     _handButtonInv[0]->setProjectionMatrix(_projectionMatrix);
     _handButtonInv[0]->setPosition(glm::vec3(-9.00f, 4.00f, 0.00f));
     _handButtonInv[0]->show(false);
-    _handButtonInv[1] = new ImageComponent("data/images/HandButton_inv.jpg", -1.25f, 1.25f);
+    _handButtonInv[1] = new ImageComponent(-1.25f, 1.25f);
+    _handButtonInv[1]->setTextureFit(buttonFit);
+    _handButtonInv[1]->loadImageFromFileAsync("data/images/HandButton_inv.jpg");
     _handButtonInv[1]->setProjectionMatrix(_projectionMatrix);
     _handButtonInv[1]->setPosition(glm::vec3(-9.00f, -2.50f, 0.00f));
     _handButtonInv[1]->show(false);
 
-    _helpButtonInv[0] = new ImageComponent("data/images/HelpButton_inv.jpg", -1.25f, 1.25f);
+    _helpButtonInv[0] = new ImageComponent(-1.25f, 1.25f);
+    _helpButtonInv[0]->setTextureFit(buttonFit);
+    _helpButtonInv[0]->loadImageFromFileAsync("data/images/HelpButton_inv.jpg");
     _helpButtonInv[0]->setProjectionMatrix(_projectionMatrix);
     _helpButtonInv[0]->setPosition(glm::vec3(-9.00f, 3.50f, 0.00f));
     _helpButtonInv[0]->show(false);
-    _helpButtonInv[1] = new ImageComponent("data/images/HelpButton_inv.jpg", -1.25f, 1.25f);
+    _helpButtonInv[1] = new ImageComponent(-1.25f, 1.25f);
+    _helpButtonInv[1]->setTextureFit(buttonFit);
+    _helpButtonInv[1]->loadImageFromFileAsync("data/images/HelpButton_inv.jpg");
     _helpButtonInv[1]->setProjectionMatrix(_projectionMatrix);
     _helpButtonInv[1]->setPosition(glm::vec3(-9.00f, -2.65f, 0.00f));
     _helpButtonInv[1]->show(false);
@@ -142,6 +177,7 @@ namespace argosClient {
   }
 
   bool GLContext::update(paper_t paper) {
+    ARGOS_TRACE_SPAN("update");
     static int oldId = -2;
 
     glm::mat4 modelview_matrix = glm::make_mat4(paper.modelview_matrix);
@@ -151,7 +187,7 @@ namespace argosClient {
     //_fingerPoint->setModelMatrix(glm::mat4(1.0f));
     //_fingerPoint->setPosition(point);
     //_fingerPoint->setModelViewMatrix(modelview_matrix);
-    Log::info("Finger point: (" + std::to_string(point.x) + ", " + std::to_string(point.y) + ")");
+    ARGOS_LOG_DEBUG("Finger point: (" + std::to_string(point.x) + ", " + std::to_string(point.y) + ")");
 
     // Operarios
     if(paper.id == 0) {
@@ -165,9 +201,8 @@ namespace argosClient {
         _pointsFlags[0] = true;
         _videoButtonInv[0]->show(true);
 
-        _audioManager.stop();
-        _audioManager.play("success.wav", 0);
-        _audioManager.play("iniciar_videoconferencia.wav", 0);
+        _soundScheduler.stopAll();
+        _soundScheduler.playSequence({ "success.wav", "iniciar_videoconferencia.wav" });
 
         _isVideostream = 1;
       }
@@ -180,9 +215,8 @@ namespace argosClient {
         _pointsFlags[1] = true;
         _videoButtonInv[1]->show(true);
 
-        _audioManager.stop();
-        _audioManager.play("success.wav", 0);
-        _audioManager.play("iniciar_videoconferencia.wav", 0);
+        _soundScheduler.stopAll();
+        _soundScheduler.playSequence({ "success.wav", "iniciar_videoconferencia.wav" });
 
         _isVideostream = 1;
       }
@@ -243,8 +277,7 @@ namespace argosClient {
         _pointsFlags[4] = true;
         _helpButtonInv[0]->show(true);
         _isClothes = 1;
-        _audioManager.play("success.wav", 0);
-        _audioManager.play("estampacion.wav", 0);
+        _soundScheduler.playSequence({ "success.wav", "estampacion.wav" });
       }
       else {
         _pointsFlags[4] = false;
@@ -255,8 +288,7 @@ namespace argosClient {
         _pointsFlags[5] = true;
         _helpButtonInv[1]->show(true);
         _isClothes = 2;
-        _audioManager.play("success.wav", 0);
-        _audioManager.play("estampacion.wav", 0);
+        _soundScheduler.playSequence({ "success.wav", "estampacion.wav" });
       }
       else {
         _pointsFlags[5] = false;
@@ -267,8 +299,7 @@ namespace argosClient {
         _pointsFlags[6] = true;
         _helpButtonInv[2]->show(true);
         _isClothes = 3;
-        _audioManager.play("success.wav", 0);
-        _audioManager.play("estampacion.wav", 0);
+        _soundScheduler.playSequence({ "success.wav", "estampacion.wav" });
       }
       else {
         _pointsFlags[6] = false;
@@ -286,6 +317,13 @@ namespace argosClient {
       }
       //_helpButtonInv[2]->show(false);
       _gcManager.cleanForId(oldId);
+
+      // The speech of a new document is synthesised at once, not text by text as it is played
+      TtsCache& ttsCache = TtsCache::getInstance();
+      for(const CallingFunctionData& cfd : paper.cfds) {
+        if((cfd.id == CallingFunctionType::PLAY_SOUND || cfd.id == CallingFunctionType::PLAY_SOUND_DELAYED) && !cfd.args.empty())
+          ttsCache.prefetch(cfd.args[0]);
+      }
     }
 
     // Blank
@@ -295,6 +333,14 @@ namespace argosClient {
 
     int sentences = paper.cfds.size();
     for(int i = 0; i < sentences; ++i) {
+#ifdef ARGOS_TRACE
+      // Span names must be literals, one per script function
+      static const char* handlerSpans[] = { "DrawImage", "DrawVideo", "DrawCorners", "DrawAxis", "InitVideostream",
+                                            "DrawTextPanel", "DrawHighlight", "DrawButton", "DrawFactureHint",
+                                            "PlaySound", "PlaySoundDelayed" };
+      int type = paper.cfds[i].id;
+      TraceSpan span((type >= 0 && type <= PLAY_SOUND_DELAYED) ? handlerSpans[type] : "ScriptFunction");
+#endif
       _handlers[paper.cfds[i].id]->execute(paper.cfds[i].args, paper.id);
     }
 
@@ -304,6 +350,8 @@ namespace argosClient {
   }
 
   void GLContext::render() {
+    GpuCounters::beginFrame();
+
     // Clears the screen
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glViewport(0, 0, _width, _height);
@@ -322,10 +370,37 @@ namespace argosClient {
 
     //_fingerPoint->render();
 
+    if(_metricsOverlay)
+      _metricsOverlay->render();
+
+    GpuCounters::endFrame();
+
     // To update we need to swap the buffers
     swapBuffers();
   }
 
+  bool GLContext::isLoaded() const {
+    if(_audioManager.getPendingLoads() > 0 || !_projArea->isLoaded())
+      return false;
+
+    for(int i = 0; i < 2; ++i) {
+      if(!_videoButtonInv[i]->isLoaded() || !_handButtonInv[i]->isLoaded() || !_helpButtonInv[i]->isLoaded())
+        return false;
+    }
+
+    return true;
+  }
+
+  void GLContext::showMetrics(bool show) {
+    if(show && !_metricsOverlay) {
+      _metricsOverlay = new MetricsOverlay("data/fonts/ProximaNova-Bold.ttf", _width, _height);
+    }
+    else if(!show) {
+      delete _metricsOverlay;
+      _metricsOverlay = nullptr;
+    }
+  }
+
   void GLContext::setProjectionMatrix(glm::mat4 projectionMatrix) {
     _projectionMatrix = projectionMatrix;
   }
@@ -1,5 +1,6 @@
 #include <cassert>
 #include "GfxProgram.h"
+#include "GpuCounters.h"
 
 namespace argosClient {
 
@@ -39,7 +40,7 @@ namespace argosClient {
   }
 
   void GfxProgram::useProgram() const {
-    glUseProgram(_id);
+    GpuCounters::useProgram(_id);
     assert(glGetError() == 0);
   }
 
@@ -0,0 +1,160 @@
+#include "GpuCounters.h"
+
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+#include "Log.h"
+#include "Metrics.h"
+#include "GpuMemoryTracker.h"
+
+namespace argosClient {
+
+  const char* const GpuCounters::NO_COLLECTION = "(context)";
+
+  GpuCounts GpuCounters::frame;
+  GpuCounts GpuCounters::lastFrame;
+  std::map<std::string, GpuCounters::CollectionCounts> GpuCounters::collections;
+  GpuCounts* GpuCounters::current = &GpuCounters::collections[GpuCounters::NO_COLLECTION].building;
+  GLuint GpuCounters::currentProgram = 0;
+  float GpuCounters::reportSeconds = 0.0f;
+  Timer GpuCounters::reportTimer;
+
+  GpuCounts::GpuCounts()
+    : drawCalls(0), vertices(0), programSwitches(0), textureBinds(0), blendToggles(0), uploadedBytes(0), fboPasses(0) {
+
+  }
+
+  void GpuCounts::add(const GpuCounts& counts) {
+    drawCalls += counts.drawCalls;
+    vertices += counts.vertices;
+    programSwitches += counts.programSwitches;
+    textureBinds += counts.textureBinds;
+    blendToggles += counts.blendToggles;
+    uploadedBytes += counts.uploadedBytes;
+    fboPasses += counts.fboPasses;
+  }
+
+  unsigned int GpuCounters::bytesPerPixel(GLenum format, GLenum type) {
+    if(type == GL_UNSIGNED_SHORT_5_6_5 || type == GL_UNSIGNED_SHORT_4_4_4_4 || type == GL_UNSIGNED_SHORT_5_5_5_1)
+      return 2;
+
+    switch(format) {
+    case GL_RGBA:
+      return 4;
+    case GL_RGB:
+      return 3;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    default:
+      return 1;
+    }
+  }
+
+  void GpuCounters::beginFrame() {
+    // Not reset here, the uploads done by the main loop before the render belong to this frame
+    current = &collections[NO_COLLECTION].building;
+  }
+
+  void GpuCounters::endFrame() {
+    lastFrame = frame;
+    collections[NO_COLLECTION].rendered = true;
+
+    // Collections which are gone stop being reported
+    for(auto it = collections.begin(); it != collections.end();) {
+      if(it->second.rendered) {
+        it->second.last = it->second.building;
+        it->second.building = GpuCounts();
+        it->second.rendered = false;
+        ++it;
+      }
+      else {
+        it = collections.erase(it);
+      }
+    }
+    current = &collections[NO_COLLECTION].building;
+    frame = GpuCounts();
+
+    static Gauge& drawCalls = Metrics::getInstance().gauge("gpu_draw_calls");
+    static Gauge& vertices = Metrics::getInstance().gauge("gpu_vertices");
+    static Gauge& programSwitches = Metrics::getInstance().gauge("gpu_program_switches");
+    static Gauge& textureBinds = Metrics::getInstance().gauge("gpu_texture_binds");
+    static Gauge& blendToggles = Metrics::getInstance().gauge("gpu_blend_toggles");
+    static Gauge& uploadedBytes = Metrics::getInstance().gauge("gpu_uploaded_bytes");
+    static Gauge& fboPasses = Metrics::getInstance().gauge("gpu_fbo_passes");
+    drawCalls.set(lastFrame.drawCalls);
+    vertices.set(lastFrame.vertices);
+    programSwitches.set(lastFrame.programSwitches);
+    textureBinds.set(lastFrame.textureBinds);
+    blendToggles.set(lastFrame.blendToggles);
+    uploadedBytes.set(lastFrame.uploadedBytes);
+    fboPasses.set(lastFrame.fboPasses);
+
+    if(reportSeconds > 0.0f && reportTimer.getMicroseconds() >= reportSeconds * 1e6) {
+      report();
+      reportTimer.start();
+    }
+  }
+
+  void GpuCounters::beginCollection(const std::string& name) {
+    CollectionCounts& counts = collections[name];
+    counts.rendered = true;
+    current = &counts.building;
+  }
+
+  void GpuCounters::endCollection() {
+    current = &collections[NO_COLLECTION].building;
+  }
+
+  const GpuCounts& GpuCounters::getFrameCounts() {
+    return lastFrame;
+  }
+
+  std::map<std::string, GpuCounts> GpuCounters::getCollectionCounts() {
+    std::map<std::string, GpuCounts> counts;
+    for(auto& pair : collections) {
+      counts[pair.first] = pair.second.last;
+    }
+
+    return counts;
+  }
+
+  void GpuCounters::setReportSeconds(float seconds) {
+    reportSeconds = seconds;
+    reportTimer.start();
+  }
+
+  static std::string format(const std::string& name, const GpuCounts& counts) {
+    char line[256];
+    snprintf(line, sizeof(line), "%s: %lu draws, %lu vertices, %lu programs, %lu textures, %lu blends, %lu KB uploaded, %lu FBO passes.",
+             name.c_str(), counts.drawCalls, counts.vertices, counts.programSwitches, counts.textureBinds,
+             counts.blendToggles, counts.uploadedBytes / 1024, counts.fboPasses);
+
+    return line;
+  }
+
+  void GpuCounters::report() {
+    static const size_t TOP_COLLECTIONS = 5;
+
+    Log::info(format("GPU work per frame", lastFrame));
+
+    std::vector<std::pair<std::string, GpuCounts>> busiest(collections.size());
+    std::transform(collections.begin(), collections.end(), busiest.begin(),
+                   [](const std::pair<const std::string, CollectionCounts>& pair) {
+                     return std::make_pair(pair.first, pair.second.last);
+                   });
+    std::sort(busiest.begin(), busiest.end(),
+              [](const std::pair<std::string, GpuCounts>& a, const std::pair<std::string, GpuCounts>& b) {
+                return a.second.drawCalls + a.second.fboPasses > b.second.drawCalls + b.second.fboPasses;
+              });
+
+    for(size_t i = 0; i < busiest.size() && i < TOP_COLLECTIONS; ++i) {
+      if(busiest[i].second.drawCalls == 0 && busiest[i].second.uploadedBytes == 0)
+        break;
+      Log::info(format("  " + busiest[i].first, busiest[i].second));
+    }
+
+    GpuMemoryTracker::report();
+  }
+
+}
@@ -0,0 +1,254 @@
+#include "GpuMemoryTracker.h"
+
+#include <vector>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "GpuCounters.h"
+#include "Log.h"
+#include "Metrics.h"
+
+namespace argosClient {
+
+  const char* const GpuMemoryTracker::NO_OWNER = "(context)";
+
+  static const std::string noOwner(GpuMemoryTracker::NO_OWNER);
+
+  const std::string* GpuMemoryTracker::owner = &noOwner;
+  std::map<GpuMemoryTracker::Key, GpuMemoryTracker::Allocation> GpuMemoryTracker::allocations;
+  std::map<std::string, GpuMemoryTracker::Usage> GpuMemoryTracker::collections;
+  std::map<int, GpuMemoryTracker::Usage> GpuMemoryTracker::documents;
+  unsigned long GpuMemoryTracker::totalBytes = 0;
+  unsigned long GpuMemoryTracker::peakBytes = 0;
+  unsigned long GpuMemoryTracker::loggedPeakBytes = 0;
+  unsigned long GpuMemoryTracker::budget = GpuMemoryTracker::DEFAULT_BUDGET;
+  bool GpuMemoryTracker::overBudget = false;
+
+  GpuMemoryTracker::Scope::Scope(const std::string& owner)
+    : _previous(GpuMemoryTracker::owner) {
+    GpuMemoryTracker::owner = &owner;
+  }
+
+  GpuMemoryTracker::Scope::~Scope() {
+    GpuMemoryTracker::owner = _previous;
+  }
+
+  const std::string& GpuMemoryTracker::getOwner() {
+    return *owner;
+  }
+
+  void GpuMemoryTracker::genTextures(GLsizei n, GLuint* textures) {
+    glGenTextures(n, textures);
+    generated(TEXTURE, n, textures);
+  }
+
+  void GpuMemoryTracker::deleteTextures(GLsizei n, const GLuint* textures) {
+    glDeleteTextures(n, textures);
+    deleted(TEXTURE, n, textures);
+  }
+
+  void GpuMemoryTracker::genFramebuffers(GLsizei n, GLuint* framebuffers) {
+    glGenFramebuffers(n, framebuffers);
+    generated(FRAMEBUFFER, n, framebuffers);
+  }
+
+  void GpuMemoryTracker::deleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    glDeleteFramebuffers(n, framebuffers);
+    deleted(FRAMEBUFFER, n, framebuffers);
+  }
+
+  void GpuMemoryTracker::genRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+    glGenRenderbuffers(n, renderbuffers);
+    generated(RENDERBUFFER, n, renderbuffers);
+  }
+
+  void GpuMemoryTracker::deleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+    glDeleteRenderbuffers(n, renderbuffers);
+    deleted(RENDERBUFFER, n, renderbuffers);
+  }
+
+  void GpuMemoryTracker::renderbufferStorage(GLuint renderbuffer, GLenum internalFormat, GLsizei width, GLsizei height) {
+    glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+
+    unsigned int bytesPerPixel;
+    switch(internalFormat) {
+    case GL_STENCIL_INDEX8:
+      bytesPerPixel = 1;
+      break;
+    case GL_DEPTH_COMPONENT16:
+    case GL_RGBA4:
+    case GL_RGB5_A1:
+    case GL_RGB565:
+      bytesPerPixel = 2;
+      break;
+    default:
+      bytesPerPixel = 4;
+      break;
+    }
+
+    resize(RENDERBUFFER, renderbuffer, (unsigned long) width * height * bytesPerPixel);
+  }
+
+  void GpuMemoryTracker::textureStorage(GLuint texture, GLsizei width, GLsizei height, GLenum format, GLenum type, bool mipmaps) {
+    unsigned long bytes = (unsigned long) width * height * GpuCounters::bytesPerPixel(format, type);
+    resize(TEXTURE, texture, mipmaps ? bytes * 4 / 3 : bytes);
+  }
+
+  void GpuMemoryTracker::compressedTextureStorage(GLuint texture, GLsizei imageSize) {
+    resize(TEXTURE, texture, imageSize);
+  }
+
+  void GpuMemoryTracker::textureDeleted(GLuint texture) {
+    deleted(TEXTURE, 1, &texture);
+  }
+
+  void GpuMemoryTracker::setBudget(unsigned long bytes) {
+    budget = bytes;
+    overBudget = false;
+  }
+
+  unsigned long GpuMemoryTracker::getTotalBytes() {
+    return totalBytes;
+  }
+
+  unsigned long GpuMemoryTracker::getPeakBytes() {
+    return peakBytes;
+  }
+
+  const std::map<std::string, GpuMemoryTracker::Usage>& GpuMemoryTracker::getCollectionUsage() {
+    return collections;
+  }
+
+  const std::map<int, GpuMemoryTracker::Usage>& GpuMemoryTracker::getDocumentUsage() {
+    return documents;
+  }
+
+  static std::string megabytes(unsigned long bytes) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+    return text;
+  }
+
+  /**
+   * Lists the biggest entries of a usage map, biggest first
+   */
+  template<typename T>
+  static std::string biggest(const std::map<T, GpuMemoryTracker::Usage>& usages, size_t count) {
+    std::vector<std::pair<T, GpuMemoryTracker::Usage>> sorted(usages.begin(), usages.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<T, GpuMemoryTracker::Usage>& a, const std::pair<T, GpuMemoryTracker::Usage>& b) {
+                return a.second.bytes > b.second.bytes;
+              });
+
+    std::ostringstream list;
+    for(size_t i = 0; i < sorted.size() && i < count; ++i) {
+      list << (i ? ", " : "") << sorted[i].first << " " << megabytes(sorted[i].second.bytes)
+           << " (peak " << megabytes(sorted[i].second.peakBytes) << ", " << sorted[i].second.objects << " objects)";
+    }
+
+    return list.str();
+  }
+
+  void GpuMemoryTracker::report() {
+    static const size_t TOP_ENTRIES = 5;
+
+    Log::info("GPU memory: " + megabytes(totalBytes) + " held, " + megabytes(peakBytes) + " peak, " +
+              std::to_string(allocations.size()) + " objects.");
+    if(!collections.empty())
+      Log::info("  Collections: " + biggest(collections, TOP_ENTRIES) + ".");
+    if(!documents.empty())
+      Log::info("  Documents: " + biggest(documents, TOP_ENTRIES) + ".");
+  }
+
+  void GpuMemoryTracker::generated(Kind kind, GLsizei n, const GLuint* names) {
+    for(GLsizei i = 0; i < n; ++i) {
+      Allocation& allocation = allocations[Key(kind, names[i])];
+      allocation.owner = *owner;
+      allocation.bytes = 0;
+      account(*owner, 0, 1);
+    }
+  }
+
+  void GpuMemoryTracker::deleted(Kind kind, GLsizei n, const GLuint* names) {
+    for(GLsizei i = 0; i < n; ++i) {
+      auto it = allocations.find(Key(kind, names[i]));
+      if(it == allocations.end())
+        continue;
+
+      account(it->second.owner, -(long) it->second.bytes, -1);
+      allocations.erase(it);
+    }
+  }
+
+  void GpuMemoryTracker::resize(Kind kind, GLuint name, unsigned long bytes) {
+    auto it = allocations.find(Key(kind, name));
+    if(it == allocations.end()) {
+      generated(kind, 1, &name);
+      it = allocations.find(Key(kind, name));
+    }
+
+    long change = (long) bytes - (long) it->second.bytes;
+    it->second.bytes = bytes;
+    account(it->second.owner, change, 0);
+
+    if(change <= 0)
+      return;
+
+    if(totalBytes >= loggedPeakBytes + HIGH_WATER_STEP) {
+      loggedPeakBytes = totalBytes;
+      Log::info("GPU memory high-water mark: " + megabytes(totalBytes) + ", last allocation by '" + it->second.owner + "'.");
+    }
+
+    if(budget > 0 && totalBytes > budget && !overBudget) {
+      overBudget = true;
+      Log::error("GPU memory over budget: " + megabytes(totalBytes) + " held for " + megabytes(budget) + ".");
+      report();
+    }
+  }
+
+  void GpuMemoryTracker::account(const std::string& owner, long bytes, int objects) {
+    static Gauge& heldBytes = Metrics::getInstance().gauge("gpu_memory_bytes");
+    static Gauge& heldPeakBytes = Metrics::getInstance().gauge("gpu_memory_peak_bytes");
+
+    totalBytes += bytes;
+    peakBytes = std::max(peakBytes, totalBytes);
+    heldBytes.set(totalBytes);
+    heldPeakBytes.set(peakBytes);
+
+    // The warning is logged again once the memory went back under the budget
+    if(overBudget && totalBytes <= budget)
+      overBudget = false;
+
+    auto collection = collections.find(owner);
+    if(collection == collections.end())
+      collection = collections.insert(std::make_pair(owner, Usage())).first;
+    collection->second.bytes += bytes;
+    collection->second.objects += objects;
+    collection->second.peakBytes = std::max(collection->second.peakBytes, collection->second.bytes);
+    if(collection->second.objects == 0)
+      collections.erase(collection);
+
+    int id = documentOf(owner);
+    if(id < 0)
+      return;
+
+    Usage& document = documents[id];
+    document.bytes += bytes;
+    document.objects += objects;
+    document.peakBytes = std::max(document.peakBytes, document.bytes);
+    if(document.objects == 0)
+      documents.erase(id);
+  }
+
+  int GpuMemoryTracker::documentOf(const std::string& owner) {
+    // Same naming as GraphicComponentsManager::cleanForId()
+    size_t pos = owner.find("id:");
+    if(pos == std::string::npos)
+      return -1;
+
+    return atoi(owner.c_str() + pos + 3);
+  }
+
+}
@@ -8,16 +8,22 @@
 #include "VideoStreamComponent.h"
 #include "VideoComponent.h"
 #include "Log.h"
+#include "GpuCounters.h"
+#include "GpuMemoryTracker.h"
 
 #include <sstream>
+#include <cmath>
+#include <algorithm>
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace argosClient {
 
+  const float GraphicComponentsManager::NEAREST_PAGE_DISTANCE = 30.0f;
+
   GraphicComponentsManager::GraphicComponentsManager()
-    : _projectionMatrix(glm::mat4(1.0f)), _imagesPath(""), _videosPath(""), _fontsPath("") {
+    : _projectionMatrix(glm::mat4(1.0f)), _imagesPath(""), _videosPath(""), _fontsPath(""), _screenWidth(0), _screenHeight(0) {
 
   }
 
@@ -53,25 +59,32 @@ namespace argosClient {
   void GraphicComponentsManager::cleanForId(int id) {
     std::string str = "id:" + std::to_string(id);
 
-    for(auto& pair : _gcCollections) {
-      if(pair.first.find(str) != std::string::npos) {
-        removeGCCollection(pair.first);
-      }
+    // Erasing invalidates the iterator, so step past the collection first
+    for(auto it = _gcCollections.begin(); it != _gcCollections.end();) {
+      if(it->first.find(str) != std::string::npos)
+        it = _gcCollections.erase(it);
+      else
+        ++it;
     }
   }
 
   void GraphicComponentsManager::render(const std::string& name) {
+    GpuMemoryTracker::Scope scope(name);
     _gcCollections[name]->render();
   }
 
   void GraphicComponentsManager::renderAll() {
     for(auto& gcc : _gcCollections) {
+      GpuMemoryTracker::Scope scope(gcc.first);
+      GpuCounters::beginCollection(gcc.first);
       gcc.second->render();
     }
+    GpuCounters::endCollection();
   }
 
   void GraphicComponentsManager::update(const glm::mat4& modelViewMatrix) {
     for(auto& gcc : _gcCollections) {
+      GpuMemoryTracker::Scope scope(gcc.first);
       gcc.second->update(modelViewMatrix);
     }
   }
@@ -80,6 +93,29 @@ namespace argosClient {
     _projectionMatrix = projectionMatrix;
   }
 
+  void GraphicComponentsManager::setScreenSize(int width, int height) {
+    _screenWidth = width;
+    _screenHeight = height;
+  }
+
+  TextureFit GraphicComponentsManager::getTextureFit(const glm::vec2& size, bool flat) const {
+    if(_screenWidth <= 0 || _screenHeight <= 0)
+      return TextureFit();
+
+    // Flat images span [-size, size] of the screen, whose normalized coordinates go from -1 to 1
+    if(flat) {
+      return TextureFit(std::min(_screenWidth, (int) std::ceil(std::fabs(size.x) * _screenWidth)),
+                        std::min(_screenHeight, (int) std::ceil(std::fabs(size.y) * _screenHeight)), false);
+    }
+
+    // A unit at distance d covers focal / d pixels, the focal lengths come from the projection matrix
+    float pixelsPerUnitX = std::fabs(_projectionMatrix[0][0]) * _screenWidth / 2.0f / NEAREST_PAGE_DISTANCE;
+    float pixelsPerUnitY = std::fabs(_projectionMatrix[1][1]) * _screenHeight / 2.0f / NEAREST_PAGE_DISTANCE;
+
+    return TextureFit(std::min(_screenWidth, (int) std::ceil(2.0f * std::fabs(size.x) * pixelsPerUnitX)),
+                      std::min(_screenHeight, (int) std::ceil(2.0f * std::fabs(size.y) * pixelsPerUnitY)), true);
+  }
+
   void GraphicComponentsManager::setImagesPath(const std::string& path) {
     _imagesPath = path;
   }
@@ -94,7 +130,10 @@ namespace argosClient {
 
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createImageFromFile(const std::string& name, const std::string& file_name,
                                                                                           const glm::vec3& pos, const glm::vec2& size, bool flat) {
-    std::shared_ptr<ImageComponent> imageComponent = std::make_shared<ImageComponent>(_imagesPath + file_name, size.x, size.y);
+    GpuMemoryTracker::Scope scope(name);
+    std::shared_ptr<ImageComponent> imageComponent = std::make_shared<ImageComponent>(size.x, size.y);
+    imageComponent->setTextureFit(getTextureFit(size, flat));
+    imageComponent->loadImageFromFileAsync(_imagesPath + file_name);
     imageComponent->setPosition(pos);
 
     if(!flat)
@@ -112,6 +151,7 @@ namespace argosClient {
 
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createVideoFromFile(const std::string& name, const std::string& file_name,
                                                                                           const glm::vec3& pos, const glm::vec2& size) {
+    GpuMemoryTracker::Scope scope(name);
     std::shared_ptr<VideoComponent> videoComponent = std::make_shared<VideoComponent>(_videosPath + file_name, size.x, size.y);
     videoComponent->setPosition(pos);
     videoComponent->setProjectionMatrix(_projectionMatrix);
@@ -126,6 +166,7 @@ namespace argosClient {
 
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createCorners(const std::string& name, float length, float wide,
                                                                                     const glm::vec4& colour, const glm::vec2& size) {
+    GpuMemoryTracker::Scope scope(name);
     // Positions
     float width = size.x;
     float height = size.y;
@@ -179,6 +220,7 @@ namespace argosClient {
 
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createAxis(const std::string& name, float length, float wide,
                                                                                  const glm::vec3& pos) {
+    GpuMemoryTracker::Scope scope(name);
     // Lines
     std::vector<std::shared_ptr<GraphicComponent>> lines = {
       std::make_shared<LineComponent>(glm::vec3(0, 0, 0), glm::vec3(length, 0, 0), wide),
@@ -206,7 +248,10 @@ namespace argosClient {
 
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createVideostream(const std::string& name, const std::string& bg_file,
                                                                                         const glm::vec2& size, int port) {
-    std::shared_ptr<ImageComponent> bg = std::make_shared<ImageComponent>(_imagesPath + bg_file, size.x, size.y);
+    GpuMemoryTracker::Scope scope(name);
+    std::shared_ptr<ImageComponent> bg = std::make_shared<ImageComponent>(size.x, size.y);
+    bg->setTextureFit(getTextureFit(size, false));
+    bg->loadImageFromFileAsync(_imagesPath + bg_file);
     bg->setProjectionMatrix(_projectionMatrix);
 
     std::shared_ptr<VideoStreamComponent> videoStream = std::make_shared<VideoStreamComponent>(size.y / 1.77, size.x / 1.77);
@@ -225,6 +270,7 @@ namespace argosClient {
   }
 
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createTextPanel(const std::string& name, const glm::vec4& colour, int fontSize, const std::wstring& text, const glm::vec3& pos, const glm::vec2& size) {
+    GpuMemoryTracker::Scope scope(name);
     float scaleFactor = 0.016f;
 
     std::shared_ptr<RenderToTextureComponent> rtt = std::make_shared<RenderToTextureComponent>(size.x, size.y);
@@ -252,6 +298,7 @@ namespace argosClient {
 
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createHighlight(const std::string& name, const glm::vec4& colour,
                                                                                       const glm::vec3& pos, const glm::vec3& scale) {
+    GpuMemoryTracker::Scope scope(name);
     std::shared_ptr<RectangleComponent> hl = std::make_shared<RectangleComponent>(1.0f, 1.0f);
     hl->setProjectionMatrix(_projectionMatrix);
     hl->setColor(colour.r, colour.g, colour.b, colour.a);
@@ -268,6 +315,7 @@ namespace argosClient {
 
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createButton(const std::string& name, const glm::vec4& colour,
                                                                                    const std::wstring& text, const glm::vec3& pos) {
+    GpuMemoryTracker::Scope scope(name);
     float scaleFactor = 0.008f;
     float w = 150.0f;
     float h = 75.0f;
@@ -306,6 +354,7 @@ namespace argosClient {
   GraphicComponentsManager::GCCollectionPtr GraphicComponentsManager::createFactureHint(const std::string& name, const glm::vec3& pos, const glm::vec2& size,
                                                                                         const glm::vec4& colour, const std::wstring& title,
                                                                                         const std::vector<std::pair<std::wstring, glm::vec3>>& textBlocks) {
+    GpuMemoryTracker::Scope scope(name);
     float scaleFactor = 0.008f;
     std::shared_ptr<RenderToTextureComponent> rtt = std::make_shared<RenderToTextureComponent>(size.x, size.y);
     rtt->setScale(glm::vec3(-scaleFactor, scaleFactor, scaleFactor));
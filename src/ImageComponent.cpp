@@ -3,16 +3,22 @@
 #include <iostream>
 
 #include <SOIL/SOIL.h>
+#include <GLES2/gl2ext.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Log.h"
+#include "TaskPool.h"
+#include "AssetBundle.h"
+#include "TextureCache.h"
+#include "GpuCounters.h"
+#include "GpuMemoryTracker.h"
 
 namespace argosClient {
 
   ImageComponent::ImageComponent(GLfloat width, GLfloat height)
-    : _width(width), _height(height), _textureId(-1) {
+    : _width(width), _height(height), _textureId(-1), _alphaTextureId(0), _loaded(false), _alive(std::make_shared<bool>(true)) {
     /**
      *    0__1
      *    | /|
@@ -44,7 +50,24 @@ namespace argosClient {
     deleteTexture();
   }
 
+  void ImageComponent::setTextureFit(const TextureFit& fit) {
+    _textureFit = fit;
+  }
+
   void ImageComponent::loadImageFromFile(const std::string& file_name) {
+    TextureCache& textureCache = TextureCache::getInstance();
+    if(textureCache.isEnabled()) {
+      Etc1Texture color, alpha;
+      if(textureCache.get(file_name, _textureFit, color, alpha)) {
+        uploadCompressedTexture(color, alpha);
+        Log::success("Image '" + file_name + "' (" + std::to_string(color.getWidth()) + "x" + std::to_string(color.getHeight()) + ") successfully loaded as ETC1");
+        return;
+      }
+    }
+
+    if(loadImageFromBundle(file_name))
+      return;
+
     int width, height, channels;
 
     unsigned char* buffer = SOIL_load_image(file_name.c_str(), &width, &height, &channels, SOIL_LOAD_AUTO);
@@ -53,12 +76,153 @@ namespace argosClient {
       Log::error(std::string(SOIL_last_result()));
       exit(1);
     }
-    else {
-      Log::success("Image '" + file_name + "' (" + std::to_string(width) + "x" + std::to_string(height) + ") successfully loaded");
+
+    cv::Mat level = _textureFit.apply(buffer, width, height, channels);
+    uploadTexture(level.data, level.cols, level.rows, channels);
+    Log::success("Image '" + file_name + "' (" + std::to_string(width) + "x" + std::to_string(height) + ") successfully loaded" +
+                 (level.data != buffer ? " at " + std::to_string(level.cols) + "x" + std::to_string(level.rows) : ""));
+
+    // Free the image data
+    SOIL_free_image_data(buffer);
+  }
+
+  /**
+   * An image decoded and resized by a worker, waiting to be uploaded
+   */
+  struct DecodedImage {
+    unsigned char* buffer; ///< The pixels decoded by SOIL, nullptr if they come from the bundle
+    int width, height, channels;
+    cv::Mat level; ///< The resized pixels, possibly sharing the decoded ones
+    std::string error;
+  };
+
+  /**
+   * An image compressed by a worker, waiting to be uploaded
+   */
+  struct CompressedImage {
+    Etc1Texture color, alpha;
+    bool ok;
+  };
+
+  void ImageComponent::loadImageFromFileAsync(const std::string& file_name) {
+    if(TextureCache::getInstance().isEnabled()) {
+      std::weak_ptr<bool> alive = _alive;
+      TextureFit fit = _textureFit;
+      std::string owner = GpuMemoryTracker::getOwner();
+
+      // The first load compresses the image, the following ones only read the PKM files
+      TaskPool::getInstance().submitThen(
+        [file_name, fit]() {
+          CompressedImage image;
+          image.ok = TextureCache::getInstance().get(file_name, fit, image.color, image.alpha);
+          return image;
+        },
+        [this, alive, file_name, owner](const CompressedImage& image) {
+          // The component may have been destroyed while the image was compressed
+          if(alive.expired())
+            return;
+
+          // The continuation runs outside the collection which queued the load
+          GpuMemoryTracker::Scope scope(owner);
+
+          if(image.ok) {
+            uploadCompressedTexture(image.color, image.alpha);
+            Log::success("Image '" + file_name + "' (" + std::to_string(image.color.getWidth()) + "x" + std::to_string(image.color.getHeight()) + ") successfully loaded as ETC1");
+          }
+          else if(!loadImageFromBundle(file_name)) {
+            decodeImageAsync(file_name);
+          }
+        });
+      return;
     }
 
+    // Nothing to decode, the upload alone is not worth a round trip through the TaskPool
+    if(loadImageFromBundle(file_name))
+      return;
+
+    decodeImageAsync(file_name);
+  }
+
+  void ImageComponent::decodeImageAsync(const std::string& file_name) {
+    std::weak_ptr<bool> alive = _alive;
+    TextureFit fit = _textureFit;
+    std::string owner = GpuMemoryTracker::getOwner();
+
+    // Resizing is as slow as decoding, both are done by the worker
+    TaskPool::getInstance().submitThen(
+      [file_name, fit]() {
+        DecodedImage image;
+        AssetBundle& bundle = AssetBundle::getInstance();
+        const AssetBundle::Entry* entry = bundle.find(file_name, AssetBundle::TEXTURE);
+        const unsigned char* pixels;
+        if(entry != nullptr && AssetBundle::getChannels(*entry) > 0) {
+          image.buffer = nullptr;
+          image.width = entry->width;
+          image.height = entry->height;
+          image.channels = AssetBundle::getChannels(*entry);
+          pixels = bundle.data(*entry);
+        }
+        else {
+          image.buffer = SOIL_load_image(file_name.c_str(), &image.width, &image.height, &image.channels, SOIL_LOAD_AUTO);
+          if(image.buffer == nullptr) {
+            image.error = SOIL_last_result();
+            return image;
+          }
+          pixels = image.buffer;
+        }
+
+        image.level = fit.apply(pixels, image.width, image.height, image.channels);
+        return image;
+      },
+      [this, alive, file_name, owner](const DecodedImage& image) {
+        if(image.level.data == nullptr) {
+          Log::error("Image '" + file_name + "' loaded incorrectly");
+          Log::error(image.error);
+          return;
+        }
+
+        // The component may have been destroyed while the image was decoded
+        if(!alive.expired()) {
+          GpuMemoryTracker::Scope scope(owner);
+          uploadTexture(image.level.data, image.level.cols, image.level.rows, image.channels);
+          Log::success("Image '" + file_name + "' (" + std::to_string(image.width) + "x" + std::to_string(image.height) + ") successfully loaded" +
+                       (image.level.cols != image.width || image.level.rows != image.height ?
+                        " at " + std::to_string(image.level.cols) + "x" + std::to_string(image.level.rows) : ""));
+        }
+
+        if(image.buffer)
+          SOIL_free_image_data(image.buffer);
+      });
+  }
+
+  bool ImageComponent::loadImageFromBundle(const std::string& file_name) {
+    AssetBundle& bundle = AssetBundle::getInstance();
+    const AssetBundle::Entry* entry = bundle.find(file_name, AssetBundle::TEXTURE);
+    int channels = entry != nullptr ? AssetBundle::getChannels(*entry) : 0;
+    if(channels == 0)
+      return false;
+
+    // Images to resize go through the TaskPool
+    int width, height;
+    _textureFit.getSize(entry->width, entry->height, width, height);
+    if(width != (int) entry->width || height != (int) entry->height)
+      return false;
+
+    uploadTexture(bundle.data(*entry), entry->width, entry->height, channels);
+    Log::success("Image '" + file_name + "' (" + std::to_string(entry->width) + "x" + std::to_string(entry->height) + ") loaded from the bundle");
+
+    return true;
+  }
+
+  void ImageComponent::uploadTexture(const unsigned char* buffer, int width, int height, int channels) {
     GLenum format;
     switch(channels) {
+    case 1:
+      format = GL_LUMINANCE;
+      break;
+    case 2:
+      format = GL_LUMINANCE_ALPHA;
+      break;
     case 3:
       format = GL_RGB;
       break;
@@ -67,26 +231,60 @@ namespace argosClient {
       break;
     }
 
+    // Mipmaps need power-of-two sizes in OpenGL ES 2.0, which the fit gives
+    bool mipmaps = _textureFit.hasMipmaps() && !(width & (width - 1)) && !(height & (height - 1));
+
     // Use tightly packed data
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
+    _textureId = createTexture(mipmaps);
+
+    // Create the texture
+    GpuCounters::texImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, buffer);
+    if(mipmaps)
+      glGenerateMipmap(GL_TEXTURE_2D);
+    GpuMemoryTracker::textureStorage(_textureId, width, height, format, GL_UNSIGNED_BYTE, mipmaps);
+
+    _loaded = true;
+  }
+
+  void ImageComponent::uploadCompressedTexture(const Etc1Texture& color, const Etc1Texture& alpha) {
+    _textureId = createTexture(color.getLevelCount() > 1);
+    for(int level = 0; level < color.getLevelCount(); ++level) {
+      GpuCounters::compressedTexImage2D(GL_TEXTURE_2D, level, GL_ETC1_RGB8_OES, color.getWidth(level), color.getHeight(level), 0,
+                                        color.getSize(level), color.getData(level));
+    }
+    GpuMemoryTracker::compressedTextureStorage(_textureId, color.getTotalSize());
+
+    // ETC1 has no alpha, it is sampled from a second texture
+    if(!alpha.isEmpty()) {
+      _alphaTextureId = createTexture(alpha.getLevelCount() > 1);
+      for(int level = 0; level < alpha.getLevelCount(); ++level) {
+        GpuCounters::compressedTexImage2D(GL_TEXTURE_2D, level, GL_ETC1_RGB8_OES, alpha.getWidth(level), alpha.getHeight(level), 0,
+                                          alpha.getSize(level), alpha.getData(level));
+      }
+      GpuMemoryTracker::compressedTextureStorage(_alphaTextureId, alpha.getTotalSize());
+    }
+
+    _loaded = true;
+  }
+
+  GLuint ImageComponent::createTexture(bool mipmaps) {
+    GLuint texture;
+
     // Generate a texture object
-    glGenTextures(1, &_textureId);
+    GpuMemoryTracker::genTextures(1, &texture);
 
     // Bind the texture object
-    glBindTexture(GL_TEXTURE_2D, _textureId);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, texture);
 
-    // Set the filtering mode
+    // Set the filtering mode, the nearest mipmap is enough once the texture fits what it covers
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Create the texture
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, buffer);
-
-    // Free the image data
-    SOIL_free_image_data(buffer);
+    return texture;
   }
 
   void ImageComponent::loadImageFromMat(cv::Mat& mat) {
@@ -94,10 +292,10 @@ namespace argosClient {
     glPixelStorei(GL_UNPACK_ALIGNMENT, (mat.step & 3) ? 1 : 4);
 
     // Generate a texture object
-    glGenTextures(1, &_textureId);
+    GpuMemoryTracker::genTextures(1, &_textureId);
 
     // Bind the texture object
-    glBindTexture(GL_TEXTURE_2D, _textureId);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, _textureId);
 
     // Set the filtering mode
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -114,7 +312,10 @@ namespace argosClient {
     }
 
     // Create the texture
-    glTexImage2D(GL_TEXTURE_2D, 0, inputColourFormat, mat.cols, mat.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, mat.data);
+    GpuCounters::texImage2D(GL_TEXTURE_2D, 0, inputColourFormat, mat.cols, mat.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, mat.data);
+    GpuMemoryTracker::textureStorage(_textureId, mat.cols, mat.rows, GL_RGB, GL_UNSIGNED_BYTE);
+
+    _loaded = true;
 
     assert(glGetError() == 0);
   }
@@ -126,9 +327,14 @@ namespace argosClient {
     _texHandler = glGetAttribLocation(id, "a_texCoord");
     _mvpHandler = glGetUniformLocation(id, "u_mvp");
     _samplerHandler = glGetUniformLocation(id, "s_texture");
+    _alphaSamplerHandler = glGetUniformLocation(id, "s_alpha");
+    _alphaPlaneHandler = glGetUniformLocation(id, "u_alphaPlane");
   }
 
   void ImageComponent::specificRender() {
+    if(!_loaded)
+      return;
+
     _shader.useProgram();
 
     glVertexAttribPointer(_vertexHandler, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), _vertexData);
@@ -139,16 +345,37 @@ namespace argosClient {
     glUniformMatrix4fv(_mvpHandler, 1, GL_FALSE, glm::value_ptr(_projectionMatrix * _modelViewMatrix * _model));
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _textureId);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, _textureId);
     glUniform1i(_samplerHandler, 0);
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
+    glUniform1i(_alphaPlaneHandler, _alphaTextureId != 0);
+    if(_alphaTextureId != 0) {
+      glActiveTexture(GL_TEXTURE1);
+      GpuCounters::bindTexture(GL_TEXTURE_2D, _alphaTextureId);
+      glUniform1i(_alphaSamplerHandler, 1);
+    }
+
+    GpuCounters::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    if(_alphaTextureId != 0) {
+      GpuCounters::bindTexture(GL_TEXTURE_2D, 0);
+      glActiveTexture(GL_TEXTURE0);
+    }
+
+    GpuCounters::bindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  bool ImageComponent::isLoaded() const {
+    return _loaded;
   }
 
   void ImageComponent::deleteTexture() {
-    glDeleteTextures(1, &_textureId);
+    GpuMemoryTracker::deleteTextures(1, &_textureId);
+
+    if(_alphaTextureId != 0) {
+      GpuMemoryTracker::deleteTextures(1, &_alphaTextureId);
+      _alphaTextureId = 0;
+    }
   }
 
 }
@@ -0,0 +1,82 @@
+#include "JpegDecoder.h"
+
+#include <cstdio>
+#include <csetjmp>
+#include <jpeglib.h>
+
+#include "Log.h"
+
+namespace argosClient {
+
+  /**
+   * The libjpeg error manager, jumping back to the decoder instead of exiting
+   */
+  struct JpegError {
+    jpeg_error_mgr manager; ///< The standard error manager
+    jmp_buf jump; ///< Where to return on error
+  };
+
+  static void jpegErrorExit(j_common_ptr info) {
+    JpegError* error = (JpegError*) info->err;
+
+    char message[JMSG_LENGTH_MAX];
+    (*info->err->format_message)(info, message);
+    Log::error("JPEG decoding failed: " + std::string(message) + ".");
+
+    longjmp(error->jump, 1);
+  }
+
+  bool JpegDecoder::decode(const unsigned char* data, size_t size, int targetWidth, int targetHeight, cv::Mat& output) {
+    jpeg_decompress_struct info;
+    JpegError error;
+
+    info.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = jpegErrorExit;
+
+    if(setjmp(error.jump)) {
+      jpeg_destroy_decompress(&info);
+      return false;
+    }
+
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, const_cast<unsigned char*>(data), size);
+
+    if(jpeg_read_header(&info, TRUE) != JPEG_HEADER_OK) {
+      jpeg_destroy_decompress(&info);
+      return false;
+    }
+
+    info.scale_num = 1;
+    info.scale_denom = scaleDenominator(info.image_width, info.image_height, targetWidth, targetHeight);
+    info.out_color_space = JCS_RGB;
+    info.dct_method = JDCT_IFAST;
+
+    jpeg_calc_output_dimensions(&info);
+
+    // Does not reallocate if the size is the same as the previous frame
+    output.create(info.output_height, info.output_width, CV_8UC3);
+
+    jpeg_start_decompress(&info);
+    while(info.output_scanline < info.output_height) {
+      JSAMPROW row = output.ptr(info.output_scanline);
+      jpeg_read_scanlines(&info, &row, 1);
+    }
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+
+    return true;
+  }
+
+  int JpegDecoder::scaleDenominator(int width, int height, int targetWidth, int targetHeight) {
+    if(targetWidth <= 0 || targetHeight <= 0)
+      return 1;
+
+    int denominator = 1;
+    while(denominator < 8 && width / (denominator * 2) >= targetWidth && height / (denominator * 2) >= targetHeight) {
+      denominator *= 2;
+    }
+
+    return denominator;
+  }
+
+}
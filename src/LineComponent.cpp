@@ -3,6 +3,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "GpuCounters.h"
+
 namespace argosClient {
 
   LineComponent::LineComponent(glm::vec3 const & src, glm::vec3 const & dst, GLfloat width)
@@ -46,7 +48,7 @@ namespace argosClient {
     glUniformMatrix4fv(_mvpHandler, 1, GL_FALSE, glm::value_ptr(_projectionMatrix * _modelViewMatrix * _model));
 
     glLineWidth(_width);
-    glDrawElements(GL_LINES, 2, GL_UNSIGNED_SHORT, _indices);
+    GpuCounters::drawElements(GL_LINES, 2, GL_UNSIGNED_SHORT, _indices);
   }
 
 }
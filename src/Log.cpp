@@ -1,136 +1,282 @@
 #include "Log.h"
 
 #include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <pthread.h>
+
+#include "BoundedQueue.h"
 
 namespace argosClient {
 
   bool Log::coloured_output = false;
+  std::atomic<int> Log::minLevel(Log::LEVEL_INFO);
+
+  /**
+   * A queued message
+   */
+  struct LogRecord {
+    struct timespec time; ///< When the message was logged
+    Log::Colour colour; ///< The colour of the message
+    const char* tag; ///< The tag after the timestamp
+    std::string text; ///< The message
+    std::string filename; ///< A file to append the message to (empty if none)
+  };
+
+  /**
+   * Drains the queue of messages from a background thread
+   */
+  class LogWriter {
+  public:
+    static const size_t CAPACITY = 4096; ///< The number of messages which can wait to be written
+    static const int POLL_MILLISECONDS = 10; ///< The time the writer sleeps when there is nothing to write
+
+  public:
+    LogWriter()
+      : _queue(CAPACITY), _running(true), _stopped(false), _written(0), _queued(0), _dropped(0), _lastSecond(0) {
+      _thread = std::thread(&LogWriter::run, this);
+    }
+
+    /**
+     * Queues a message, writing it directly once the writer has stopped at exit
+     * @param record The message
+     */
+    void push(LogRecord&& record) {
+      if(_stopped.load(std::memory_order_acquire)) {
+        writeDirect(record);
+        return;
+      }
 
-  void Log::plain(const std::string& msg, const std::string& filename) {
-    std::cout << currentDateTime() << " " << msg << std::endl;
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " " << msg << std::endl;
-      ofs.close();
+      if(_queue.tryPush(std::move(record)))
+        _queued.fetch_add(1, std::memory_order_relaxed);
+      else
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+
+      // The writer may have stopped after the check above and missed the message
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(_stopped.load(std::memory_order_relaxed))
+        drainDirect();
     }
 
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [INFO] " << msg << std::endl;
-      ofs.close();
+    /**
+     * Waits until every message queued so far is written
+     */
+    void flush() {
+      uint64_t queued = _queued.load(std::memory_order_acquire);
+      while(!_stopped.load(std::memory_order_acquire) && _written.load(std::memory_order_acquire) < queued) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    /**
+     * Writes the pending messages and stops the thread, called at exit
+     */
+    void stop() {
+      _stopped.store(true);
+      _running = false;
+      if(_thread.joinable())
+        _thread.join();
+
+      // Pushed while the thread was finishing, after its last drain
+      drainDirect();
+    }
+
+  private:
+    void run() {
+      pthread_setname_np(pthread_self(), "log");
+
+      while(true) {
+        bool running = _running.load();
+        int written = drain();
+
+        if(!running && written == 0)
+          break;
+
+        if(written == 0)
+          std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MILLISECONDS));
+      }
     }
-  }
 
-  void Log::info(const std::string& msg, const std::string& filename) {
-    if(coloured_output)
-      std::cout << "\033[" << Colour::FG_LIGHT_BLUE << "m";
+    int drain() {
+      LogRecord record;
+      int written = 0;
 
-    std::cout << currentDateTime() << " [INFO] " << msg << std::endl;
+      while(_queue.tryPop(record)) {
+        write(record);
+        written++;
+      }
 
-    if(coloured_output)
-      std::cout << "\033[" << FG_DEFAULT << "m";
+      uint64_t dropped = _dropped.exchange(0, std::memory_order_relaxed);
+      if(dropped > 0) {
+        LogRecord notice;
+        clock_gettime(CLOCK_REALTIME, &notice.time);
+        notice.colour = Log::FG_LIGHT_RED;
+        notice.tag = "[ERROR]";
+        notice.text = std::to_string(dropped) + " log messages dropped, the log queue was full.";
+        write(notice);
+      }
 
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [INFO] " << msg << std::endl;
-      ofs.close();
+      if(written > 0) {
+        fflush(stdout);
+        for(auto& pair : _files) {
+          pair.second->flush();
+        }
+        _written.fetch_add(written, std::memory_order_release);
+      }
+
+      return written;
     }
 
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [ERROR] " << msg << std::endl;
-      ofs.close();
+    void write(const LogRecord& record) {
+      const std::string& date = formatTime(record.time.tv_sec);
+
+      if(Log::coloured_output)
+        printf("\033[%dm%s%s%s %s\033[%dm\n", record.colour, date.c_str(), *record.tag ? " " : "", record.tag,
+               record.text.c_str(), Log::FG_DEFAULT);
+      else
+        printf("%s%s%s %s\n", date.c_str(), *record.tag ? " " : "", record.tag, record.text.c_str());
+
+      if(!record.filename.empty()) {
+        std::unique_ptr<std::ofstream>& file = _files[record.filename];
+        if(!file)
+          file.reset(new std::ofstream(record.filename, std::ofstream::app));
+        *file << date << (*record.tag ? " " : "") << record.tag << " " << record.text << "\n";
+      }
     }
-  }
 
-  void Log::error(const std::string& msg, const std::string& filename) {
-    if(coloured_output)
-      std::cout << "\033[" << Colour::FG_LIGHT_RED << "m";
+    void drainDirect() {
+      std::lock_guard<std::mutex> lock(_directMutex);
 
-    std::cout << currentDateTime() << " [ERROR] " << msg << std::endl;
+      LogRecord record;
+      while(_queue.tryPop(record)) {
+        writeDirect(record);
+      }
+    }
 
-    if(coloured_output)
-      std::cout << "\033[" << FG_DEFAULT << "m";
+    void writeDirect(const LogRecord& record) {
+      std::string date = Log::currentDateTime();
+      printf("%s%s%s %s\n", date.c_str(), *record.tag ? " " : "", record.tag, record.text.c_str());
+      fflush(stdout);
 
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [ERROR] " << msg << std::endl;
-      ofs.close();
+      if(!record.filename.empty()) {
+        std::ofstream file(record.filename, std::ofstream::app);
+        file << date << (*record.tag ? " " : "") << record.tag << " " << record.text << "\n";
+      }
     }
 
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [SUCCESS] " << msg << std::endl;
-      ofs.close();
+    const std::string& formatTime(time_t seconds) {
+      // The date only changes once per second
+      if(seconds != _lastSecond) {
+        tm tstruct;
+        char buf[80];
+        localtime_r(&seconds, &tstruct);
+        strftime(buf, sizeof(buf), "[%d-%m-%Y %X]", &tstruct);
+        _lastDate = buf;
+        _lastSecond = seconds;
+      }
+
+      return _lastDate;
     }
+
+  private:
+    BoundedQueue<LogRecord> _queue; ///< The messages waiting to be written
+    std::thread _thread; ///< The writer thread
+    std::atomic<bool> _running; ///< Whether the writer should keep waiting for messages
+    std::atomic<bool> _stopped; ///< Whether the writer has stopped and messages are written directly
+    std::atomic<uint64_t> _written; ///< The number of messages written by the thread
+    std::atomic<uint64_t> _queued; ///< The number of messages queued
+    std::atomic<uint64_t> _dropped; ///< The number of messages dropped since the last drain
+    std::mutex _directMutex; ///< Keeps the messages written directly whole once the thread has stopped
+    std::map<std::string, std::unique_ptr<std::ofstream>> _files; ///< The open log files
+    time_t _lastSecond; ///< The second formatted in _lastDate
+    std::string _lastDate; ///< The last formatted timestamp
+  };
+
+  const size_t LogWriter::CAPACITY;
+  const int LogWriter::POLL_MILLISECONDS;
+
+  static void stopWriter();
+
+  static LogWriter& writer() {
+    // Never destroyed, messages logged by other static destructors are written directly
+    static LogWriter* instance = []() {
+      LogWriter* writer = new LogWriter();
+      atexit(stopWriter);
+      return writer;
+    }();
+
+    return *instance;
   }
 
-  void Log::success(const std::string& msg, const std::string& filename) {
-    if(coloured_output)
-      std::cout << "\033[" << Colour::FG_LIGHT_GREEN << "m";
+  static void stopWriter() {
+    writer().stop();
+  }
 
-    std::cout << currentDateTime() << " [SUCCESS] " << msg << std::endl;
+  void Log::enqueue(Level level, Colour colour, const char* tag, std::string&& text, const std::string& filename) {
+    LogRecord record;
+    clock_gettime(CLOCK_REALTIME_COARSE, &record.time);
+    record.colour = colour;
+    record.tag = tag;
+    record.text = std::move(text);
+    if(!filename.empty())
+      record.filename = filename;
 
-    if(coloured_output)
-      std::cout << "\033[" << FG_DEFAULT << "m";
+    writer().push(std::move(record));
+  }
 
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [SUCCESS] " << msg << std::endl;
-      ofs.close();
-    }
+  void Log::plain(std::string msg, const std::string& filename) {
+    if(isEnabled(LEVEL_INFO))
+      enqueue(LEVEL_INFO, FG_DEFAULT, "", std::move(msg), filename);
   }
 
-  void Log::video(const std::string& msg, const std::string& filename) {
-    if(coloured_output)
-      std::cout << "\033[" << Colour::FG_LIGHT_YELLOW << "m";
+  void Log::debug(std::string msg, const std::string& filename) {
+    if(isEnabled(LEVEL_DEBUG))
+      enqueue(LEVEL_DEBUG, FG_DARK_GRAY, "[DEBUG]", std::move(msg), filename);
+  }
+
+  void Log::info(std::string msg, const std::string& filename) {
+    if(isEnabled(LEVEL_INFO))
+      enqueue(LEVEL_INFO, FG_LIGHT_BLUE, "[INFO]", std::move(msg), filename);
+  }
 
-    std::cout << currentDateTime() << " [VIDEO] " << msg << std::endl;
+  void Log::error(std::string msg, const std::string& filename) {
+    if(isEnabled(LEVEL_ERROR))
+      enqueue(LEVEL_ERROR, FG_LIGHT_RED, "[ERROR]", std::move(msg), filename);
+  }
 
-    if(coloured_output)
-      std::cout << "\033[" << FG_DEFAULT << "m";
+  void Log::success(std::string msg, const std::string& filename) {
+    if(isEnabled(LEVEL_INFO))
+      enqueue(LEVEL_INFO, FG_LIGHT_GREEN, "[SUCCESS]", std::move(msg), filename);
+  }
 
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [VIDEO] " << msg << std::endl;
-      ofs.close();
-    }
+  void Log::video(std::string msg, const std::string& filename) {
+    if(isEnabled(LEVEL_DEBUG))
+      enqueue(LEVEL_DEBUG, FG_LIGHT_YELLOW, "[VIDEO]", std::move(msg), filename);
   }
 
   void Log::function(const std::string& name, const std::vector<std::string>& args, const std::string& filename) {
-    if(coloured_output)
-      std::cout << "\033[" << Colour::FG_LIGHT_MAGENTA << "m";
+    if(!isEnabled(LEVEL_DEBUG))
+      return;
 
-    std::cout << currentDateTime() << " [FUNCTION] " << name << "(";
+    std::string text = name + "(";
     int size = args.size();
     for(int i = 0; i < size; ++i) {
       if(args[i].empty())
-        std::cout << "*";
+        text += "*";
       else
-        std::cout << args[i];
+        text += args[i];
       if(i < size - 1)
-        std::cout << ", ";
-    }
-    std::cout << ")" << std::endl;
-
-    if(coloured_output)
-      std::cout << "\033[" << FG_DEFAULT << "m";
-
-    if(!filename.empty()) {
-      std::ofstream ofs(filename, std::ofstream::app);
-      ofs << currentDateTime() << " [FUNCTION] " << name << "(";
-      int size = args.size();
-      for(int i = 0; i < size; ++i) {
-        if(args[i].empty())
-          ofs << "*";
-        else
-          ofs << args[i];
-        if(i < size - 1)
-          ofs << ", ";
-      }
-      ofs << ")" << std::endl;
-      ofs.close();
+        text += ", ";
     }
+    text += ")";
+
+    enqueue(LEVEL_DEBUG, FG_LIGHT_MAGENTA, "[FUNCTION]", std::move(text), filename);
   }
 
   const std::string Log::currentDateTime() {
@@ -138,7 +284,7 @@ namespace argosClient {
     tm tstruct;
     char buf[80];
 
-    tstruct = *localtime(&now);
+    localtime_r(&now, &tstruct);
     strftime(buf, sizeof(buf), "[%d-%m-%Y %X]", &tstruct);
 
     return buf;
@@ -148,4 +294,40 @@ namespace argosClient {
     coloured_output = coloured;
   }
 
+  void Log::setLevel(Level level) {
+    minLevel.store(level, std::memory_order_relaxed);
+  }
+
+  bool Log::parseLevel(const std::string& name, Level& level) {
+    if(name == "debug")
+      level = LEVEL_DEBUG;
+    else if(name == "info")
+      level = LEVEL_INFO;
+    else if(name == "error")
+      level = LEVEL_ERROR;
+    else if(name == "off")
+      level = LEVEL_OFF;
+    else
+      return false;
+
+    return true;
+  }
+
+  bool Log::allowEvery(std::atomic<int64_t>& last, float seconds) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+    int64_t now = (int64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+    int64_t previous = last.load(std::memory_order_relaxed);
+
+    if(previous != 0 && now - previous < (int64_t) (seconds * 1e9))
+      return false;
+
+    // Only one of the threads racing for the same call site logs
+    return last.compare_exchange_strong(previous, now, std::memory_order_relaxed);
+  }
+
+  void Log::flush() {
+    writer().flush();
+  }
+
 }
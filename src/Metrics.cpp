@@ -0,0 +1,215 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include <boost/asio.hpp>
+
+#include "Log.h"
+#include "TaskPool.h"
+
+using boost::asio::ip::udp;
+
+namespace argosClient {
+
+  const float Metrics::DEFAULT_EXPORT_SECONDS = 10.0f;
+
+  static const size_t MAX_DATAGRAM = 1400; ///< Keeps UDP exports below the usual MTU
+
+  Histogram::Histogram()
+    : _count(0) {
+    _samples.reserve(WINDOW);
+  }
+
+  void Histogram::record(double value) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if(_samples.size() < WINDOW)
+      _samples.push_back(value);
+    else
+      _samples[_count % WINDOW] = value;
+
+    _count++;
+  }
+
+  Histogram::Snapshot Histogram::snapshot() const {
+    std::vector<double> samples;
+    Snapshot snapshot;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      samples = _samples;
+      snapshot.count = _count;
+    }
+
+    if(samples.empty()) {
+      snapshot.p50 = snapshot.p95 = snapshot.p99 = snapshot.max = 0.0;
+      return snapshot;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    size_t last = samples.size() - 1;
+    snapshot.p50 = samples[last * 50 / 100];
+    snapshot.p95 = samples[last * 95 / 100];
+    snapshot.p99 = samples[last * 99 / 100];
+    snapshot.max = samples[last];
+
+    return snapshot;
+  }
+
+  Metrics::Metrics()
+    : _exportSeconds(0.0f), _exporting(false) {
+    char host[64];
+    if(gethostname(host, sizeof(host)) == 0) {
+      host[sizeof(host) - 1] = '\0';
+      _host = host;
+    }
+    else {
+      _host = "unknown";
+    }
+  }
+
+  Counter& Metrics::counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<Counter>& counter = _counters[name];
+    if(!counter)
+      counter.reset(new Counter());
+
+    return *counter;
+  }
+
+  Gauge& Metrics::gauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<Gauge>& gauge = _gauges[name];
+    if(!gauge)
+      gauge.reset(new Gauge());
+
+    return *gauge;
+  }
+
+  Histogram& Metrics::histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<Histogram>& histogram = _histograms[name];
+    if(!histogram)
+      histogram.reset(new Histogram());
+
+    return *histogram;
+  }
+
+  std::string Metrics::toLineProtocol() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    std::string timestamp = std::to_string((uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec);
+    std::string tags = ",host=" + _host + " ";
+    std::string lines;
+    char fields[160];
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for(auto& pair : _counters) {
+      lines += "argos_" + pair.first + tags + "value=" + std::to_string(pair.second->get()) + "i " + timestamp + "\n";
+    }
+
+    for(auto& pair : _gauges) {
+      snprintf(fields, sizeof(fields), "value=%g ", pair.second->get());
+      lines += "argos_" + pair.first + tags + fields + timestamp + "\n";
+    }
+
+    for(auto& pair : _histograms) {
+      Histogram::Snapshot snapshot = pair.second->snapshot();
+      snprintf(fields, sizeof(fields), "count=%llui,p50=%g,p95=%g,p99=%g,max=%g ", (unsigned long long) snapshot.count,
+               snapshot.p50, snapshot.p95, snapshot.p99, snapshot.max);
+      lines += "argos_" + pair.first + tags + fields + timestamp + "\n";
+    }
+
+    return lines;
+  }
+
+  bool Metrics::setExport(const std::string& spec, float seconds) {
+    if(spec.compare(0, 5, "file:") == 0 && spec.size() > 5) {
+      _exportPath = spec.substr(5);
+      Log::info("Exporting metrics to '" + _exportPath + "' every " + std::to_string((int) seconds) + " s.");
+    }
+    else if(spec.compare(0, 4, "udp:") == 0 && spec.rfind(':') > 4) {
+      size_t colon = spec.rfind(':');
+      _exportHost = spec.substr(4, colon - 4);
+      _exportPort = spec.substr(colon + 1);
+      Log::info("Exporting metrics to " + _exportHost + ":" + _exportPort + " over UDP every " +
+                std::to_string((int) seconds) + " s.");
+    }
+    else {
+      Log::error("Unknown metrics export '" + spec + "'. Use file:<path> or udp:<host>:<port>.");
+      return false;
+    }
+
+    _exportSeconds = seconds;
+    _exportTimer.start();
+
+    return true;
+  }
+
+  void Metrics::exportIfDue() {
+    if(_exportSeconds <= 0.0f || _exportTimer.getMicroseconds() < _exportSeconds * 1e6)
+      return;
+
+    _exportTimer.start();
+
+    // A slow file system or resolver must not hold the render loop, nor pile up exports
+    bool idle = false;
+    if(!_exporting.compare_exchange_strong(idle, true))
+      return;
+
+    std::string lines = toLineProtocol();
+    TaskPool::getInstance().post([this, lines]() {
+      write(lines);
+      _exporting = false;
+    });
+  }
+
+  void Metrics::write(const std::string& lines) {
+    if(!_exportPath.empty()) {
+      // Readers never see a half written file
+      std::string temporary = _exportPath + ".tmp";
+      {
+        std::ofstream file(temporary.c_str());
+        file << lines;
+        if(!file) {
+          Log::error("Could not write the metrics to '" + temporary + "'.");
+          return;
+        }
+      }
+
+      if(rename(temporary.c_str(), _exportPath.c_str()) < 0)
+        Log::error("Could not replace the metrics file '" + _exportPath + "'.");
+
+      return;
+    }
+
+    try {
+      boost::asio::io_service ioService;
+      udp::resolver resolver(ioService);
+      udp::endpoint endpoint = *resolver.resolve(udp::resolver::query(udp::v4(), _exportHost, _exportPort));
+      udp::socket socket(ioService);
+      socket.open(udp::v4());
+
+      // Whole lines per datagram
+      size_t begin = 0;
+      while(begin < lines.size()) {
+        size_t end = begin;
+        while(end < lines.size()) {
+          size_t next = lines.find('\n', end) + 1;
+          if(next - begin > MAX_DATAGRAM && end > begin)
+            break;
+          end = next;
+        }
+
+        socket.send_to(boost::asio::buffer(&lines[begin], end - begin), endpoint);
+        begin = end;
+      }
+    }
+    catch(boost::system::system_error const& e) {
+      Log::error("Could not send the metrics to " + _exportHost + ":" + _exportPort + ". " + std::string(e.what()));
+    }
+  }
+
+}
@@ -0,0 +1,74 @@
+#include "MetricsOverlay.h"
+
+#include <cstdio>
+
+#include "TextComponent.h"
+#include "Metrics.h"
+
+namespace argosClient {
+
+  MetricsOverlay::MetricsOverlay(const std::string& fontFile, uint32_t screenWidth, uint32_t screenHeight)
+    : _lastBytesSent(0), _lastBytesReceived(0) {
+    float margin = 10.0f;
+    float lineHeight = FONT_SIZE * 1.4f;
+
+    // Glyphs are laid out in pixels, drawn straight in normalized device coordinates
+    for(int i = 0; i < LINES; ++i) {
+      TextComponent* line = new TextComponent(fontFile, FONT_SIZE);
+      line->setPosition(glm::vec3(-1.0f + 2.0f * margin / screenWidth,
+                                  1.0f - 2.0f * (margin + FONT_SIZE + i * lineHeight) / screenHeight, 0.0f));
+      line->setScale(glm::vec3(2.0f / screenWidth, 2.0f / screenHeight, 1.0f));
+      _lines.push_back(std::unique_ptr<TextComponent>(line));
+    }
+
+    refresh(0.0);
+    _refreshTimer.start();
+  }
+
+  MetricsOverlay::~MetricsOverlay() {
+
+  }
+
+  void MetricsOverlay::render() {
+    double seconds = _refreshTimer.getMicroseconds() / 1e6;
+    if(seconds >= 1.0) {
+      refresh(seconds);
+      _refreshTimer.start();
+    }
+
+    for(auto& line : _lines) {
+      line->render();
+    }
+  }
+
+  void MetricsOverlay::refresh(double seconds) {
+    Metrics& metrics = Metrics::getInstance();
+    Histogram::Snapshot frame = metrics.histogram("frame_time_ms").snapshot();
+    Histogram::Snapshot rtt = metrics.histogram("pose_rtt_ms").snapshot();
+    Histogram::Snapshot encode = metrics.histogram("encode_ms").snapshot();
+    uint64_t bytesSent = metrics.counter("bytes_sent").get();
+    uint64_t bytesReceived = metrics.counter("bytes_received").get();
+
+    double sentRate = (seconds > 0.0) ? (bytesSent - _lastBytesSent) / seconds / 1024.0 : 0.0;
+    double receivedRate = (seconds > 0.0) ? (bytesReceived - _lastBytesReceived) / seconds / 1024.0 : 0.0;
+    _lastBytesSent = bytesSent;
+    _lastBytesReceived = bytesReceived;
+
+    char text[LINES][128];
+    snprintf(text[0], sizeof(text[0]), "%.1f fps   frame %.1f / %.1f / %.1f ms",
+             metrics.gauge("fps").get(), frame.p50, frame.p95, frame.p99);
+    snprintf(text[1], sizeof(text[1]), "pose RTT %.0f / %.0f / %.0f ms   encode %.1f / %.1f / %.1f ms",
+             rtt.p50, rtt.p95, rtt.p99, encode.p50, encode.p95, encode.p99);
+    snprintf(text[2], sizeof(text[2]), "sent %.0f KB/s   received %.1f KB/s   dropped video %llu",
+             sentRate, receivedRate, (unsigned long long) metrics.counter("video_frames_dropped").get());
+    snprintf(text[3], sizeof(text[3]), "GPU %.0f draws   %.0f programs   %.0f textures   %.0f KB uploaded",
+             metrics.gauge("gpu_draw_calls").get(), metrics.gauge("gpu_program_switches").get(),
+             metrics.gauge("gpu_texture_binds").get(), metrics.gauge("gpu_uploaded_bytes").get() / 1024.0);
+
+    for(int i = 0; i < LINES; ++i) {
+      std::string line(text[i]);
+      _lines[i]->setText(std::wstring(line.begin(), line.end()), 1.0f, 1.0f, 0.0f);
+    }
+  }
+
+}
@@ -1,16 +1,19 @@
 #include "PlaySoundDelayedSF.h"
 #include "AudioManager.h"
+#include "SoundScheduler.h"
 
 namespace argosClient {
 
   PlaySoundDelayedSF::PlaySoundDelayedSF()
     : ScriptFunction("SoundDelayed", "PlaySoundDelayedSF"),
-      _audioManager(AudioManager::getInstance()) {
+      _audioManager(AudioManager::getInstance()),
+      _soundScheduler(SoundScheduler::getInstance()) {
 
   }
 
   void PlaySoundDelayedSF::_execute(const std::vector<std::string>& args, int id) {
-    AudioManager::getInstance().play(args[0], getArgAsInt(args[1]));
+    // The second argument is the delay in milliseconds, the sound plays once
+    _soundScheduler.playIn(args[0], getArgAsInt(args[1]));
   }
 
 }
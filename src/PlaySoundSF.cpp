@@ -1,18 +1,20 @@
 #include "PlaySoundSF.h"
 #include "AudioManager.h"
+#include "SoundScheduler.h"
 
 namespace argosClient {
 
   PlaySoundSF::PlaySoundSF()
     : ScriptFunction("Sound", "PlaySoundSF"),
-      _audioManager(AudioManager::getInstance()) {
+      _audioManager(AudioManager::getInstance()),
+      _soundScheduler(SoundScheduler::getInstance()) {
 
   }
 
   void PlaySoundSF::_execute(const std::vector<std::string>& args, int id) {
     Log::info("Playing sound: " + args[0]);
-    _audioManager.stop();
-    _audioManager.play(args[0], getArgAsInt(args[1]));
+    _soundScheduler.stopAll();
+    _soundScheduler.playIn(args[0], 0, getArgAsInt(args[1]));
   }
 
 }
@@ -0,0 +1,45 @@
+#ifdef ARGOS_WITH_RASPICAM
+
+#include "RaspicamFrameSource.h"
+
+namespace argosClient {
+
+  RaspicamFrameSource::RaspicamFrameSource(int width, int height)
+    : FrameSource(width, height) {
+
+  }
+
+  bool RaspicamFrameSource::open() {
+    _camera.set(CV_CAP_PROP_FORMAT, CV_8UC3);
+    _camera.set(CV_CAP_PROP_FRAME_WIDTH, _width);
+    _camera.set(CV_CAP_PROP_FRAME_HEIGHT, _height);
+    //_camera.set(CV_CAP_PROP_CONTRAST, 55);
+    //_camera.set(CV_CAP_PROP_SATURATION, 55);
+    //_camera.set(CV_CAP_PROP_GAIN, 55);
+
+    return _camera.open();
+  }
+
+  bool RaspicamFrameSource::isOpened() const {
+    return _camera.isOpened();
+  }
+
+  bool RaspicamFrameSource::grab() {
+    return _camera.grab();
+  }
+
+  void RaspicamFrameSource::retrieve(cv::Mat& image) {
+    _camera.retrieve(image);
+  }
+
+  void RaspicamFrameSource::release() {
+    _camera.release();
+  }
+
+  std::string RaspicamFrameSource::getName() const {
+    return "raspicam " + std::to_string(_width) + "x" + std::to_string(_height);
+  }
+
+}
+
+#endif
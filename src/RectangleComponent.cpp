@@ -3,6 +3,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "GpuCounters.h"
+
 namespace argosClient {
 
   RectangleComponent::RectangleComponent(GLfloat width, GLfloat height)
@@ -47,7 +49,7 @@ namespace argosClient {
 
     glUniformMatrix4fv(_mvpHandler, 1, GL_FALSE, glm::value_ptr(_projectionMatrix * _modelViewMatrix * _model));
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
+    GpuCounters::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
   }
 
 }
@@ -9,6 +9,8 @@
 
 #include "RenderToTextureComponent.h"
 #include "GLContext.h"
+#include "GpuCounters.h"
+#include "GpuMemoryTracker.h"
 
 namespace argosClient {
 
@@ -41,9 +43,9 @@ namespace argosClient {
   }
 
   RenderToTextureComponent::~RenderToTextureComponent() {
-    glDeleteFramebuffers(1, &_framebufferObject);
-    glDeleteTextures(1, &_texture);
-    glDeleteRenderbuffers(1, &_depthRenderbuffer);
+    GpuMemoryTracker::deleteFramebuffers(1, &_framebufferObject);
+    GpuMemoryTracker::deleteTextures(1, &_texture);
+    GpuMemoryTracker::deleteRenderbuffers(1, &_depthRenderbuffer);
 
     delete [] _indices;
     delete [] _vertexData;
@@ -66,19 +68,20 @@ namespace argosClient {
     assert(maxRenderbufferSize >= _texHeight);
 
     // Generate the framebuffer, renderbuffer and texture object names
-    glGenFramebuffers(1, &_framebufferObject);
-    glGenRenderbuffers(1, &_depthRenderbuffer);
-    glGenTextures(1, &_texture);
+    GpuMemoryTracker::genFramebuffers(1, &_framebufferObject);
+    GpuMemoryTracker::genRenderbuffers(1, &_depthRenderbuffer);
+    GpuMemoryTracker::genTextures(1, &_texture);
 
     // Bind texture and load the texture mip-level 0
     // Texels are RGB565
     // No texels need to be specified as we are going to draw into the texture
-    glBindTexture(GL_TEXTURE_2D, _texture);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, _texture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _texWidth, _texHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    GpuCounters::texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _texWidth, _texHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    GpuMemoryTracker::textureStorage(_texture, _texWidth, _texHeight, GL_RGBA, GL_UNSIGNED_BYTE);
 
     // Bind the framebuffer object and specify texture as color attachment
     glBindFramebuffer(GL_FRAMEBUFFER, _framebufferObject);
@@ -87,14 +90,14 @@ namespace argosClient {
     // Bind renderbuffer, create a 16-bit depth buffer and specify depth_renderbufer as depth attachment
     // Width and Height of renderbuffer = Width and Height of the texture
     glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, _texWidth, _texHeight);
+    GpuMemoryTracker::renderbufferStorage(_depthRenderbuffer, GL_DEPTH_COMPONENT16, _texWidth, _texHeight);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRenderbuffer);
 
     // All went ok?
     assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
 
     // Unbind
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, 0);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -107,6 +110,7 @@ namespace argosClient {
   void RenderToTextureComponent::renderToTexture() {
     // Bind the framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, _framebufferObject);
+    GpuCounters::countFboPass();
 
     // Set viewport to size of texture map and erase previous image
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -136,13 +140,13 @@ namespace argosClient {
 
     // Bind the texture
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _texture);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, _texture);
 
     // Set the sampler texture unit to 0
     glUniform1i(_samplerHandler, 0);
 
     // Draw it
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
+    GpuCounters::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
   }
 
   void RenderToTextureComponent::setUpShader() {
@@ -0,0 +1,250 @@
+#include "SoundScheduler.h"
+
+#include <atomic>
+#include <climits>
+#include <SDL/SDL_mixer.h>
+
+#include "AudioManager.h"
+#include "TtsCache.h"
+#include "Log.h"
+
+namespace argosClient {
+
+  // The channels finished since the last tick(), one bit each, set by the audio thread
+  static const int MAX_TRACKED_CHANNELS = 32;
+  static std::atomic<uint32_t> finishedChannels(0);
+
+  SoundScheduler::SoundScheduler()
+    : _audioManager(AudioManager::getInstance()), _current(0), _wheelTime(nowMilliseconds()), _pending(0) {
+    // The mixer is opened by the AudioManager above, before the hook is set
+    Mix_ChannelFinished(SoundScheduler::channelFinished);
+  }
+
+  SoundScheduler::~SoundScheduler() {
+    Mix_ChannelFinished(nullptr);
+  }
+
+  void SoundScheduler::channelFinished(int channel) {
+    if(channel >= 0 && channel < MAX_TRACKED_CHANNELS)
+      finishedChannels.fetch_or(1u << channel);
+  }
+
+  int64_t SoundScheduler::nowMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+  }
+
+  void SoundScheduler::playAt(const std::string& file_name, Clock::time_point time, int loops) {
+    int64_t target = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+
+    // An idle wheel is not moved by tick(), it catches up with the clock here
+    if(_pending == 0) {
+      int64_t now = nowMilliseconds();
+      _wheelTime += (now - _wheelTime) / SLOT_MS * SLOT_MS;
+    }
+
+    int64_t slots = (target - _wheelTime + SLOT_MS - 1) / SLOT_MS;
+    if(slots <= 0 || target <= nowMilliseconds()) {
+      playSound(file_name, loops);
+      return;
+    }
+
+    Sound sound;
+    sound.fileName = file_name;
+    sound.loops = loops;
+    sound.rounds = (slots - 1) / SLOT_COUNT;
+    _slots[(_current + slots) % SLOT_COUNT].push_back(sound);
+    _pending++;
+  }
+
+  void SoundScheduler::playIn(const std::string& file_name, int delayMs, int loops) {
+    playAt(file_name, Clock::now() + std::chrono::milliseconds(delayMs), loops);
+  }
+
+  void SoundScheduler::playSequence(const std::vector<std::string>& file_names) {
+    Sequence sequence;
+    sequence.fileNames = file_names;
+    sequence.next = 0;
+    playNext(sequence);
+  }
+
+  void SoundScheduler::playNext(Sequence sequence) {
+    if(sequence.next >= sequence.fileNames.size())
+      return;
+
+    const std::string& file_name = sequence.fileNames[sequence.next];
+    int channel = start(file_name, 0);
+    if(channel == TtsCache::PENDING) {
+      // Still this sound, tick() plays it once synthesised
+      _waitingSequences.push_back(sequence);
+      return;
+    }
+
+    sequence.next++;
+    bool stream = channel == AudioManager::STREAM_CHANNEL;
+    if(channel < 0 || (!stream && channel >= MAX_TRACKED_CHANNELS)) {
+      Log::error("Could not play the sound '" + file_name + "', the rest of its sequence is dropped.");
+      return;
+    }
+
+    // A flag left by an earlier sound of the channel must not end this one, the end of a stream is polled instead
+    if(!stream)
+      finishedChannels.fetch_and(~(1u << channel));
+
+    // The mixer only reuses a free channel and a stream replaces the previous one,
+    // so a sequence still kept on the channel finished before tick() noticed
+    auto previous = _sequences.find(channel);
+    if(previous != _sequences.end()) {
+      Sequence finished = previous->second;
+      _sequences.erase(previous);
+      playNext(finished);
+    }
+
+    if(sequence.next < sequence.fileNames.size())
+      _sequences[channel] = sequence;
+  }
+
+  int SoundScheduler::start(const std::string& file_name, int loops) {
+    std::string lang, text;
+    if(TtsCache::parse(file_name, lang, text))
+      return TtsCache::getInstance().play(lang, text, loops);
+
+    return _audioManager.play(file_name, loops);
+  }
+
+  void SoundScheduler::playSound(const std::string& file_name, int loops) {
+    if(start(file_name, loops) != TtsCache::PENDING)
+      return;
+
+    Sound sound;
+    sound.fileName = file_name;
+    sound.loops = loops;
+    sound.rounds = 0;
+    _waitingSounds.push_back(sound);
+  }
+
+  bool SoundScheduler::isWaiting(const std::string& file_name, bool& ready) {
+    std::string lang, text;
+    ready = false;
+    if(!TtsCache::parse(file_name, lang, text))
+      return false;
+
+    TtsCache& ttsCache = TtsCache::getInstance();
+    ready = ttsCache.isReady(lang, text);
+    return ttsCache.isPending(lang, text);
+  }
+
+  void SoundScheduler::resumeWaiting() {
+    bool ready;
+
+    // Both lists may grow again while they are gone through, they are taken out first
+    std::vector<Sound> sounds;
+    sounds.swap(_waitingSounds);
+    for(const Sound& sound : sounds) {
+      if(isWaiting(sound.fileName, ready))
+        _waitingSounds.push_back(sound);
+      else if(ready)
+        start(sound.fileName, sound.loops);
+      else
+        Log::error("Could not synthesise the sound '" + sound.fileName + "'.");
+    }
+
+    std::vector<Sequence> sequences;
+    sequences.swap(_waitingSequences);
+    for(const Sequence& sequence : sequences) {
+      const std::string& file_name = sequence.fileNames[sequence.next];
+      if(isWaiting(file_name, ready))
+        _waitingSequences.push_back(sequence);
+      else if(ready)
+        playNext(sequence);
+      else
+        Log::error("Could not synthesise the sound '" + file_name + "', the rest of its sequence is dropped.");
+    }
+  }
+
+  void SoundScheduler::stopAll() {
+    for(std::vector<Sound>& slot : _slots)
+      slot.clear();
+    _pending = 0;
+    _sequences.clear();
+    _waitingSounds.clear();
+    _waitingSequences.clear();
+
+    _audioManager.stop();
+  }
+
+  void SoundScheduler::advance() {
+    _current = (_current + 1) % SLOT_COUNT;
+    _wheelTime += SLOT_MS;
+
+    std::vector<Sound>& slot = _slots[_current];
+    if(slot.empty())
+      return;
+
+    // Playing does not touch the wheel, the due sounds are taken out first anyway
+    std::vector<Sound> due;
+    size_t kept = 0;
+    for(Sound& sound : slot) {
+      if(sound.rounds == 0)
+        due.push_back(sound);
+      else {
+        sound.rounds--;
+        slot[kept++] = sound;
+      }
+    }
+    slot.resize(kept);
+    _pending -= due.size();
+
+    for(const Sound& sound : due)
+      playSound(sound.fileName, sound.loops);
+  }
+
+  void SoundScheduler::tick() {
+    if(_pending > 0) {
+      int64_t now = nowMilliseconds();
+      while(_wheelTime + SLOT_MS <= now && _pending > 0)
+        advance();
+    }
+
+    uint32_t finished = finishedChannels.exchange(0);
+    for(int channel = 0; finished != 0 && channel < MAX_TRACKED_CHANNELS; ++channel) {
+      if(!(finished & (1u << channel)))
+        continue;
+      finished &= ~(1u << channel);
+
+      auto it = _sequences.find(channel);
+      if(it == _sequences.end())
+        continue;
+
+      Sequence sequence = it->second;
+      _sequences.erase(it);
+      playNext(sequence);
+    }
+
+    // A streamed sound has no channel of the mixer, its end is polled
+    auto stream = _sequences.find(AudioManager::STREAM_CHANNEL);
+    if(stream != _sequences.end() && !_audioManager.isStreaming()) {
+      Sequence sequence = stream->second;
+      _sequences.erase(stream);
+      playNext(sequence);
+    }
+
+    if(!_waitingSounds.empty() || !_waitingSequences.empty())
+      resumeWaiting();
+  }
+
+  long SoundScheduler::getTimeToNextTick() const {
+    if(_pending > 0) {
+      int64_t left = _wheelTime + SLOT_MS - nowMilliseconds();
+      return left > 0 ? left * 1000 : 0;
+    }
+
+    // Finished channels and synthesised speech are only noticed when polled
+    bool polled = !_sequences.empty() || !_waitingSounds.empty() || !_waitingSequences.empty();
+    return polled ? SLOT_MS * 1000 : LONG_MAX;
+  }
+
+  bool SoundScheduler::isIdle() const {
+    return _pending == 0 && _sequences.empty() && _waitingSounds.empty() && _waitingSequences.empty();
+  }
+
+}
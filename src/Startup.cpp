@@ -0,0 +1,108 @@
+#include "Startup.h"
+
+#include <vector>
+#include <cstdio>
+#include <memory>
+#include <algorithm>
+
+#include "Log.h"
+#include "Metrics.h"
+
+namespace argosClient {
+
+  Startup::Startup()
+    : _assetsMs(-1.0), _firstFrameMs(-1.0) {
+    _clock.start();
+  }
+
+  double Startup::now() const {
+    return _clock.getMicroseconds() / 1000.0;
+  }
+
+  bool Startup::run(const std::string& name, const Step& step) {
+    StepTimes& times = _steps[name];
+    times.startMs = now();
+    bool result = step();
+    times.endMs = now();
+
+    return result;
+  }
+
+  void Startup::start(const std::string& name, const Step& step) {
+    StepTimes& times = _steps[name];
+    times.startMs = now();
+    times.endMs = -1.0;
+
+    // Stamped by the thread, read once wait() synchronized with it
+    std::shared_ptr<double> endMs = std::make_shared<double>(-1.0);
+    times.threadEndMs = endMs;
+    times.result = std::async(std::launch::async, [this, step, endMs]() {
+      bool succeeded = step();
+      *endMs = now();
+      return succeeded;
+    }).share();
+  }
+
+  bool Startup::wait(const std::string& name) {
+    auto it = _steps.find(name);
+    if(it == _steps.end() || !it->second.result.valid()) {
+      Log::error("No startup step named '" + name + "' was started.");
+      return false;
+    }
+
+    bool succeeded = it->second.result.get();
+    it->second.endMs = *it->second.threadEndMs;
+
+    return succeeded;
+  }
+
+  bool Startup::isDone(const std::string& name) const {
+    auto it = _steps.find(name);
+    if(it == _steps.end() || !it->second.result.valid())
+      return true;
+
+    return it->second.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  void Startup::assetsLoaded() {
+    if(_assetsMs < 0.0) {
+      _assetsMs = now();
+      Log::info("Assets loaded after " + std::to_string((int) _assetsMs) + " ms.");
+    }
+  }
+
+  bool Startup::areAssetsLoaded() const {
+    return _assetsMs >= 0.0;
+  }
+
+  void Startup::firstFrame() {
+    if(_firstFrameMs >= 0.0)
+      return;
+
+    _firstFrameMs = now();
+    Metrics::getInstance().gauge("startup_first_frame_ms").set(_firstFrameMs);
+
+    std::vector<std::pair<std::string, StepTimes>> steps(_steps.begin(), _steps.end());
+    std::sort(steps.begin(), steps.end(),
+              [](const std::pair<std::string, StepTimes>& a, const std::pair<std::string, StepTimes>& b) {
+                return a.second.startMs < b.second.startMs;
+              });
+
+    Log::success("First frame after " + std::to_string((int) _firstFrameMs) + " ms" +
+                 (_assetsMs >= 0.0 ? ", assets loaded after " + std::to_string((int) _assetsMs) + " ms." : ", assets still loading."));
+    for(auto& step : steps) {
+      char line[128];
+      if(step.second.endMs < 0.0)
+        snprintf(line, sizeof(line), "  %-12s %6.0f ms -> still running", step.first.c_str(), step.second.startMs);
+      else
+        snprintf(line, sizeof(line), "  %-12s %6.0f ms -> %6.0f ms (%.0f ms)", step.first.c_str(), step.second.startMs,
+                 step.second.endMs, step.second.endMs - step.second.startMs);
+      Log::info(line);
+    }
+  }
+
+  bool Startup::isFirstFrameDone() const {
+    return _firstFrameMs >= 0.0;
+  }
+
+}
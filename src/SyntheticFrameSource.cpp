@@ -0,0 +1,71 @@
+#include "SyntheticFrameSource.h"
+
+#include <thread>
+
+namespace argosClient {
+
+  const float SyntheticFrameSource::DEFAULT_FPS = 30.0f;
+
+  SyntheticFrameSource::SyntheticFrameSource(float fps, int width, int height)
+    : FrameSource(width, height), _fps(fps), _opened(false), _frameCount(0) {
+
+  }
+
+  bool SyntheticFrameSource::open() {
+    // Colour bars, built once
+    const cv::Scalar bars[] = {
+      cv::Scalar(255, 255, 255), cv::Scalar(0, 255, 255), cv::Scalar(255, 255, 0), cv::Scalar(0, 255, 0),
+      cv::Scalar(255, 0, 255), cv::Scalar(0, 0, 255), cv::Scalar(255, 0, 0), cv::Scalar(0, 0, 0)
+    };
+
+    _background.create(_height, _width, CV_8UC3);
+    for(int i = 0; i < 8; ++i) {
+      cv::rectangle(_background, cv::Rect(i * _width / 8, 0, _width / 8 + 1, _height), bars[i], -1);
+    }
+
+    _frameCount = 0;
+    _nextFrame = Clock::now();
+    _opened = true;
+
+    return true;
+  }
+
+  bool SyntheticFrameSource::isOpened() const {
+    return _opened;
+  }
+
+  bool SyntheticFrameSource::grab() {
+    if(!_opened)
+      return false;
+
+    if(_fps > 0.0f) {
+      std::this_thread::sleep_until(_nextFrame);
+      _nextFrame = std::max(_nextFrame + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _fps)),
+                            Clock::now());
+    }
+
+    _frameCount++;
+
+    return true;
+  }
+
+  void SyntheticFrameSource::retrieve(cv::Mat& image) {
+    _background.copyTo(image);
+
+    // A bar sweeping the frame and the frame number, so consecutive frames differ
+    int bar = (int) (_frameCount * 4 % _height);
+    cv::rectangle(image, cv::Rect(0, bar, _width, _height / 20), cv::Scalar(128, 128, 128), -1);
+    cv::putText(image, std::to_string(_frameCount), cv::Point(20, _height - 20),
+                cv::FONT_HERSHEY_SIMPLEX, 2.0, cv::Scalar(0, 0, 0), 3);
+  }
+
+  void SyntheticFrameSource::release() {
+    _opened = false;
+    _background.release();
+  }
+
+  std::string SyntheticFrameSource::getName() const {
+    return "synthetic " + std::to_string(_width) + "x" + std::to_string(_height) + " at " + std::to_string((int) _fps) + " fps";
+  }
+
+}
@@ -3,13 +3,19 @@
 #include <vector>
 #include <opencv2/highgui/highgui.hpp>
 #include <iomanip>
+#include <algorithm>
 
 #include "EventManager.h"
 #include "Log.h"
+#include "ThreadManager.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "Timer.h"
 
 namespace argosClient {
 
-  TaskDelegation::TaskDelegation() : _ip("-1"), _port("-1"), _error(0), _offset(0), _state(State::NORMAL) {
+  TaskDelegation::TaskDelegation() : _ip("-1"), _port("-1"), _error(0), _offset(0), _frameId(0),
+                                     _capture(nullptr), _latencySum(0.0f), _latencyMax(0.0f), _latencyCount(0), _state(State::NORMAL) {
     _tcpSocket = new tcp::socket(_ioService);
     _tcpResolver = new tcp::resolver(_ioService);
   }
@@ -103,6 +109,8 @@ namespace argosClient {
   }
 
   void TaskDelegation::runThread() {
+    ThreadManager::getInstance().registerCurrentThread("delegation");
+
     std::mutex synchronousMutex;
     std::mutex injectedMutex;
     std::mutex preparedMutex;
@@ -113,44 +121,102 @@ namespace argosClient {
     _conditionVariables["ThreadFinished"].second = std::unique_ptr<std::condition_variable>(new std::condition_variable());;
 
     while(*_g_loop) {
-      // Thread ready
-      EventManager::getInstance().addEvent(EventManager::EventType::TD_THREAD_READY);
-      std::unique_lock<std::mutex> lock1(injectedMutex);
-      _conditionVariables["ThreadReady"].second->wait(lock1, [this]{ return _conditionVariables["ThreadReady"].first; });
-      _conditionVariables["ThreadReady"].first = false;
+      CameraCapture::Clock::time_point captureTime;
 
-      if(!(*_g_loop)) {
-        break;
+      if(_capture) {
+        // Take the newest frame straight from the capture thread
+        const CameraCapture::Frame* frame = nullptr;
+        while(!frame && *_g_loop) {
+          frame = _capture->acquireLatest(100);
+        }
+
+        if(!frame) {
+          break;
+        }
+
+        _receivedMat = frame->image;
+        _frameId = frame->sequence;
+        captureTime = frame->timestamp;
+      }
+      else {
+        // Thread ready, the main thread injects the frame
+        ++_frameId;
+        EventManager::getInstance().addEvent(EventManager::Event(EventManager::EventType::TD_THREAD_READY, _frameId));
+        std::unique_lock<std::mutex> lock1(injectedMutex);
+        _conditionVariables["ThreadReady"].second->wait(lock1, [this]{ return _conditionVariables["ThreadReady"].first; });
+        _conditionVariables["ThreadReady"].first = false;
+
+        if(!(*_g_loop)) {
+          break;
+        }
       }
 
+      ARGOS_TRACE_FRAME(_frameId);
+
       {
         std::lock_guard<std::mutex> guard(synchronousMutex);
         // Prepare data
         addCvMat(_receivedMat, 80);
         // Send data
+        CameraCapture::Clock::time_point sendTime = CameraCapture::Clock::now();
         send();
         // Receive results
         receive(_receivedPaper);
+
+        static Histogram& poseRtt = Metrics::getInstance().histogram("pose_rtt_ms");
+        poseRtt.record(std::chrono::duration<double, std::milli>(CameraCapture::Clock::now() - sendTime).count());
+      }
+
+      if(_capture) {
+        accountLatency(CameraCapture::Clock::now() - captureTime);
       }
 
-      // Thread finished
-      EventManager::getInstance().addEvent(EventManager::EventType::TD_THREAD_FINISHED);
+      // Thread finished, the paper travels with the event so the main thread does not read it back from us
+      EventManager::getInstance().addEvent(EventManager::Event(EventManager::EventType::TD_THREAD_FINISHED, _frameId,
+                                                               std::make_shared<paper_t>(_receivedPaper)));
       std::unique_lock<std::mutex> lock2(preparedMutex);
       _conditionVariables["ThreadFinished"].second->wait(lock2, [this]{ return _conditionVariables["ThreadFinished"].first; });
       _conditionVariables["ThreadFinished"].first = false;
     }
+
+    ThreadManager::getInstance().unregisterCurrentThread();
+  }
+
+  void TaskDelegation::setCameraCapture(CameraCapture* capture) {
+    _capture = capture;
+  }
+
+  void TaskDelegation::accountLatency(CameraCapture::Clock::duration latency) {
+    float milliseconds = std::chrono::duration<float, std::milli>(latency).count();
+
+    _latencySum += milliseconds;
+    _latencyMax = std::max(_latencyMax, milliseconds);
+    _latencyCount++;
+
+    if(_latencyCount == LATENCY_REPORT_FRAMES) {
+      Log::info("Capture to pose latency: " + std::to_string((int) (_latencySum / _latencyCount)) + " ms avg, " +
+                std::to_string((int) _latencyMax) + " ms max. " + std::to_string(_capture->getDroppedCount()) +
+                " camera frames unused so far.");
+      _latencySum = _latencyMax = 0.0f;
+      _latencyCount = 0;
+    }
   }
 
   int TaskDelegation::send() {
+    ARGOS_TRACE_SPAN("send");
+
     try {
       _error = 0;
 
       int buff_size = _buff.size();
-      Log::info("Sending " + std::to_string(buff_size) + " bytes...");
+      ARGOS_LOG_DEBUG("Sending " + std::to_string(buff_size) + " bytes...");
       int bytes = boost::asio::write(*_tcpSocket, boost::asio::buffer(_buff, buff_size));
-      Log::success(std::to_string(bytes) + " bytes sent.");
+      ARGOS_LOG_DEBUG(std::to_string(bytes) + " bytes sent.");
       _buff.clear();
 
+      static Counter& bytesSent = Metrics::getInstance().counter("bytes_sent");
+      bytesSent.add(bytes);
+
       return bytes;
     }
     catch(boost::system::system_error const& e) {
@@ -197,6 +263,10 @@ namespace argosClient {
   }
 
   void TaskDelegation::addCvMat(cv::Mat& mat, int quality) {
+    ARGOS_TRACE_SPAN("encode");
+    Timer timer;
+    timer.start();
+
     std::vector<unsigned char> mat_buff;
     std::vector<int> params;
     int type = Type::CV_MAT;
@@ -215,6 +285,13 @@ namespace argosClient {
     _buff.insert(_buff.end(), &packet_type[0], &packet_type[sizeof(int)]); // Tipo
     _buff.insert(_buff.end(), &packet_size[0], &packet_size[sizeof(int)]); // Tamaño
     _buff.insert(_buff.end(), mat_buff.begin(), mat_buff.end());           // Datos
+
+    static Histogram& encodeTimes = Metrics::getInstance().histogram("encode_ms");
+    encodeTimes.record(timer.getMicroseconds() / 1000.0);
+  }
+
+  void TaskDelegation::clearBuffer() {
+    _buff.clear();
   }
 
   int TaskDelegation::error() const {
@@ -228,8 +305,12 @@ namespace argosClient {
     unsigned char size_buf[sizeof(int)];
     unsigned char* data_buf;
 
-    Log::info("Waiting for paper...");
-    bytes += boost::asio::read(socket, boost::asio::buffer(&type_buf, sizeof(int)));  // Type
+    ARGOS_LOG_DEBUG("Waiting for paper...");
+    {
+      // Most of the round trip is the server tracking the frame
+      ARGOS_TRACE_SPAN("server wait");
+      bytes += boost::asio::read(socket, boost::asio::buffer(&type_buf, sizeof(int)));  // Type
+    }
     memcpy(&st.type, &type_buf, sizeof(int));
 
     if(st.type != Type::SKIP) {
@@ -240,16 +321,17 @@ namespace argosClient {
       st.data.insert(st.data.end(), &data_buf[0], &data_buf[st.size]);
       delete [] data_buf;
 
-      Log::info("PAPER received. " + std::to_string(st.size) + "/" + std::to_string(bytes) + " bytes received.");
+      ARGOS_LOG_DEBUG("PAPER received. " + std::to_string(st.size) + "/" + std::to_string(bytes) + " bytes received.");
     }
     else {
-      Log::info("SKIP received.");
+      ARGOS_LOG_DEBUG("SKIP received.");
     }
 
     return bytes;
   }
 
   int TaskDelegation::receive(paper_t& paper) {
+    ARGOS_TRACE_SPAN("receive");
     int bytes = 0;
 
     try {
@@ -275,6 +357,9 @@ namespace argosClient {
       _error = -1;
     }
 
+    static Counter& bytesReceived = Metrics::getInstance().counter("bytes_received");
+    bytesReceived.add(bytes);
+
     return bytes;
   }
 
@@ -284,6 +369,8 @@ namespace argosClient {
   }
 
   void TaskDelegation::processPaper(StreamType& st, paper_t& paper) {
+    ARGOS_TRACE_SPAN("processPaper");
+
     if(st.type == Type::SKIP) {
       paper.id = 0;
       std::fill(paper.modelview_matrix, paper.modelview_matrix + 16, 0.0f);
@@ -297,10 +384,14 @@ namespace argosClient {
       nextInt(st, paper.num_calling_functions);
       nextCallingFunctionData(st, paper);
 
-      Log::success("Id: " + std::to_string(paper.id) +
-                   ". Num. functions: " + std::to_string(paper.cfds.size()) + "/" + std::to_string(paper.num_calling_functions) +
-                   ". FingerPoint: (" + std::to_string(paper.x) + ", " + std::to_string(paper.y) + ")");
-      Log::matrix(paper.modelview_matrix, Log::Colour::FG_DARK_GRAY);
+      ARGOS_LOG_SUCCESS_EVERY(1.0f, "Id: " + std::to_string(paper.id) +
+                              ". Num. functions: " + std::to_string(paper.cfds.size()) + "/" + std::to_string(paper.num_calling_functions) +
+                              ". FingerPoint: (" + std::to_string(paper.x) + ", " + std::to_string(paper.y) + ")");
+
+      // Formatted like the line above, at most once per second
+      static std::atomic<int64_t> matrixLast(0);
+      if(Log::isEnabled(Log::LEVEL_INFO) && Log::allowEvery(matrixLast, 1.0f))
+        Log::matrix(paper.modelview_matrix, Log::Colour::FG_DARK_GRAY);
     }
   }
 
@@ -0,0 +1,126 @@
+#include "TaskPool.h"
+
+#include <algorithm>
+
+#include "Log.h"
+#include "ThreadManager.h"
+
+namespace argosClient {
+
+  thread_local int TaskPool::workerIndex = -1;
+
+  TaskPool::TaskPool()
+    : _nextQueue(0), _pending(0), _running(true) {
+    int workers = std::max(1, (int) std::thread::hardware_concurrency() - 1);
+
+    for(int i = 0; i < workers; ++i) {
+      _queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+
+    for(int i = 0; i < workers; ++i) {
+      _workers.push_back(std::thread(&TaskPool::runWorker, this, i));
+    }
+
+    Log::info("Task pool running with " + std::to_string(workers) + " workers.");
+  }
+
+  TaskPool::~TaskPool() {
+    {
+      std::lock_guard<std::mutex> lock(_sleepMutex);
+      _running = false;
+    }
+    _taskAdded.notify_all();
+
+    for(auto& worker : _workers) {
+      worker.join();
+    }
+  }
+
+  void TaskPool::post(const Task& task) {
+    // Workers keep their own tasks, other threads spread them
+    int index = (workerIndex >= 0) ? workerIndex : (int) (_nextQueue++ % _queues.size());
+
+    {
+      std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+      _queues[index]->tasks.push_back(task);
+    }
+
+    _pending++;
+
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    _taskAdded.notify_one();
+  }
+
+  void TaskPool::postToMain(const Task& task) {
+    std::lock_guard<std::mutex> lock(_mainMutex);
+    _mainTasks.push_back(task);
+  }
+
+  int TaskPool::drainMainQueue() {
+    std::deque<Task> tasks;
+    {
+      std::lock_guard<std::mutex> lock(_mainMutex);
+      tasks.swap(_mainTasks);
+    }
+
+    for(Task& task : tasks) {
+      task();
+    }
+
+    return tasks.size();
+  }
+
+  int TaskPool::getWorkerCount() const {
+    return _workers.size();
+  }
+
+  bool TaskPool::takeTask(int index, Task& task) {
+    // Our own newest task first, it is the most likely to be in cache
+    {
+      WorkerQueue& own = *_queues[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if(!own.tasks.empty()) {
+        task = own.tasks.back();
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+
+    // Then the oldest task of any other worker
+    for(size_t i = 1; i < _queues.size(); ++i) {
+      WorkerQueue& victim = *_queues[(index + i) % _queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if(!victim.tasks.empty()) {
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void TaskPool::runWorker(int index) {
+    workerIndex = index;
+    ThreadManager::getInstance().registerCurrentThread("worker", index);
+
+    while(true) {
+      Task task;
+
+      if(takeTask(index, task)) {
+        _pending--;
+        task();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(_sleepMutex);
+      _taskAdded.wait(lock, [this]{ return !_running || _pending > 0; });
+
+      if(!_running && _pending == 0)
+        break;
+    }
+
+    ThreadManager::getInstance().unregisterCurrentThread();
+  }
+
+}
@@ -6,6 +6,8 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "TextComponent.h"
+#include "GpuCounters.h"
+#include "GpuMemoryTracker.h"
 
 namespace argosClient {
 
@@ -31,6 +33,7 @@ namespace argosClient {
       texture_font_delete(_font);
     }
     if(_atlas) {
+      GpuMemoryTracker::textureDeleted(_atlas->id);
       texture_atlas_delete(_atlas);
     }
     if(_vector) {
@@ -52,6 +55,7 @@ namespace argosClient {
     _mvpHandler = glGetUniformLocation(id, "u_mvp");
 
     texture_atlas_upload(_atlas);
+    GpuMemoryTracker::textureStorage(_atlas->id, _atlas->width, _atlas->height, GL_ALPHA, GL_UNSIGNED_BYTE);
   }
 
   void TextComponent::translate(glm::vec3 const & translation) {
@@ -153,19 +157,19 @@ namespace argosClient {
     glUniformMatrix4fv(_mvpHandler, 1, GL_FALSE, glm::value_ptr(_projectionMatrix * _modelViewMatrix * _model));
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _atlas->id);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, _atlas->id);
 
     glUniform1i(_samplerHandler, 0);
 
-    glEnable(GL_BLEND);
+    GpuCounters::setBlend(true);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     //glDisable(GL_CULL_FACE);
     glCullFace(GL_FRONT);
 
-    glDrawArrays(GL_TRIANGLES, 0, _vector->size/9);
+    GpuCounters::drawArrays(GL_TRIANGLES, 0, _vector->size/9);
 
     glCullFace(GL_BACK);
-    glDisable(GL_BLEND);
+    GpuCounters::setBlend(false);
   }
 
 }
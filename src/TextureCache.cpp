@@ -0,0 +1,125 @@
+#include "TextureCache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SOIL/SOIL.h>
+
+#include "Log.h"
+#include "AssetBundle.h"
+
+namespace argosClient {
+
+  TextureCache::TextureCache()
+    : _cachePath("data/images/cache/"), _enabled(true) {
+
+  }
+
+  void TextureCache::setCachePath(const std::string& path) {
+    _cachePath = path;
+  }
+
+  void TextureCache::setEnabled(bool enabled) {
+    _enabled = enabled;
+  }
+
+  bool TextureCache::isEnabled() const {
+    return _enabled;
+  }
+
+  bool TextureCache::get(const std::string& imageFile, const TextureFit& fit, Etc1Texture& color, Etc1Texture& alpha) const {
+    if(!build(imageFile, fit))
+      return false;
+
+    if(!color.load(pkmFileFor(imageFile, fit, Etc1Texture::COLOR)))
+      return false;
+
+    // Opaque images have no alpha plane
+    std::string alphaFile = pkmFileFor(imageFile, fit, Etc1Texture::ALPHA);
+    return access(alphaFile.c_str(), F_OK) != 0 || alpha.load(alphaFile);
+  }
+
+  bool TextureCache::build(const std::string& imageFile, const TextureFit& fit) const {
+    AssetBundle& bundle = AssetBundle::getInstance();
+    const AssetBundle::Entry* entry = bundle.find(imageFile, AssetBundle::TEXTURE);
+
+    struct stat imageStat, pkmStat;
+    time_t imageTime;
+    if(stat(imageFile.c_str(), &imageStat) == 0)
+      imageTime = imageStat.st_mtime;
+    else if(entry != nullptr)
+      imageTime = entry->mtime;
+    else {
+      Log::error("Image file '" + imageFile + "' does not exist.");
+      return false;
+    }
+
+    // The colour plane is written last, it tells whether both planes are up to date
+    std::string colorFile = pkmFileFor(imageFile, fit, Etc1Texture::COLOR);
+    std::string alphaFile = pkmFileFor(imageFile, fit, Etc1Texture::ALPHA);
+    if(stat(colorFile.c_str(), &pkmStat) == 0 && pkmStat.st_mtime >= imageTime) {
+      return true;
+    }
+
+    mkdir(_cachePath.c_str(), 0755);
+
+    Log::info("Compressing image '" + imageFile + "' to ETC1...");
+
+    int width, height, channels;
+    const unsigned char* pixels;
+    unsigned char* decoded = nullptr;
+    if(entry != nullptr) {
+      channels = AssetBundle::getChannels(*entry);
+      width = entry->width;
+      height = entry->height;
+      pixels = bundle.data(*entry);
+    }
+    else {
+      decoded = SOIL_load_image(imageFile.c_str(), &width, &height, &channels, SOIL_LOAD_AUTO);
+      pixels = decoded;
+    }
+
+    if(pixels == nullptr || channels == 0) {
+      Log::error("Could not decode the image '" + imageFile + "' to compress it.");
+      return false;
+    }
+
+    cv::Mat level = fit.apply(pixels, width, height, channels);
+    std::vector<cv::Mat> mipmaps;
+    if(fit.hasMipmaps())
+      mipmaps = TextureFit::mipmaps(level);
+
+    bool ok = true;
+    if(Etc1Texture::hasAlpha(pixels, width, height, channels))
+      ok = compress(level, mipmaps, Etc1Texture::ALPHA, alphaFile);
+    else
+      unlink(alphaFile.c_str());
+
+    ok = ok && compress(level, mipmaps, Etc1Texture::COLOR, colorFile);
+
+    if(decoded)
+      SOIL_free_image_data(decoded);
+
+    return ok;
+  }
+
+  bool TextureCache::compress(const cv::Mat& level, const std::vector<cv::Mat>& mipmaps, Etc1Texture::Plane plane, const std::string& pkmFile) {
+    Etc1Texture texture;
+    texture.encode(level.data, level.cols, level.rows, level.channels(), plane);
+    for(const cv::Mat& mipmap : mipmaps)
+      texture.encode(mipmap.data, mipmap.cols, mipmap.rows, mipmap.channels(), plane);
+
+    return texture.save(pkmFile);
+  }
+
+  std::string TextureCache::pkmFileFor(const std::string& imageFile, const TextureFit& fit, Etc1Texture::Plane plane) const {
+    std::string name = imageFile;
+
+    size_t slash = name.find_last_of('/');
+    if(slash != std::string::npos)
+      name = name.substr(slash + 1);
+
+    return _cachePath + name + fit.getKey() + (plane == Etc1Texture::ALPHA ? "_alpha.pkm" : ".pkm");
+  }
+
+}
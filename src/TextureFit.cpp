@@ -0,0 +1,88 @@
+#include "TextureFit.h"
+
+#include <cmath>
+#include <algorithm>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace argosClient {
+
+  /**
+   * Rounds a size to the nearest power of two
+   */
+  static int nearestPowerOfTwo(int size) {
+    int lower = 1;
+    while(lower * 2 <= size)
+      lower *= 2;
+
+    // Nearest on a logarithmic scale, so a texture is never scaled by more than sqrt(2)
+    return size * size > lower * lower * 2 ? lower * 2 : lower;
+  }
+
+  TextureFit::TextureFit()
+    : _maxWidth(0), _maxHeight(0), _mipmaps(false) {
+
+  }
+
+  TextureFit::TextureFit(int maxWidth, int maxHeight, bool mipmaps)
+    : _maxWidth(maxWidth), _maxHeight(maxHeight), _mipmaps(mipmaps) {
+
+  }
+
+  void TextureFit::getSize(int width, int height, int& fitWidth, int& fitHeight) const {
+    double scale = 1.0;
+    if(_maxWidth > 0 && width > _maxWidth)
+      scale = std::min(scale, (double) _maxWidth / width);
+    if(_maxHeight > 0 && height > _maxHeight)
+      scale = std::min(scale, (double) _maxHeight / height);
+
+    fitWidth = std::max(1, (int) std::lround(width * scale));
+    fitHeight = std::max(1, (int) std::lround(height * scale));
+
+    if(_mipmaps) {
+      fitWidth = nearestPowerOfTwo(fitWidth);
+      fitHeight = nearestPowerOfTwo(fitHeight);
+    }
+  }
+
+  bool TextureFit::hasMipmaps() const {
+    return _mipmaps;
+  }
+
+  std::string TextureFit::getKey() const {
+    if(_maxWidth <= 0 && _maxHeight <= 0 && !_mipmaps)
+      return "";
+
+    return "_" + std::to_string(_maxWidth) + "x" + std::to_string(_maxHeight) + (_mipmaps ? "m" : "");
+  }
+
+  cv::Mat TextureFit::apply(const unsigned char* pixels, int width, int height, int channels) const {
+    cv::Mat image(height, width, CV_8UC(channels), const_cast<unsigned char*>(pixels));
+
+    int fitWidth, fitHeight;
+    getSize(width, height, fitWidth, fitHeight);
+    if(fitWidth == width && fitHeight == height)
+      return image;
+
+    // Area averaging does not alias when shrinking, rounding up to a power of two may enlarge a bit
+    cv::Mat resized;
+    int interpolation = fitWidth <= width && fitHeight <= height ? cv::INTER_AREA : cv::INTER_LINEAR;
+    cv::resize(image, resized, cv::Size(fitWidth, fitHeight), 0, 0, interpolation);
+
+    return resized;
+  }
+
+  std::vector<cv::Mat> TextureFit::mipmaps(const cv::Mat& level) {
+    std::vector<cv::Mat> levels;
+    cv::Mat previous = level;
+
+    while(previous.cols > 1 || previous.rows > 1) {
+      cv::Mat next;
+      cv::resize(previous, next, cv::Size(std::max(1, previous.cols / 2), std::max(1, previous.rows / 2)), 0, 0, cv::INTER_AREA);
+      levels.push_back(next);
+      previous = next;
+    }
+
+    return levels;
+  }
+
+}
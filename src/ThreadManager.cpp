@@ -0,0 +1,183 @@
+#include "ThreadManager.h"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <opencv2/opencv.hpp>
+
+#include "Log.h"
+#include "Trace.h"
+
+namespace argosClient {
+
+  const float ThreadManager::REPORT_SECONDS = 30.0f;
+
+  static double clockSeconds(clockid_t clock) {
+    struct timespec time;
+    if(clock_gettime(clock, &time) < 0)
+      return 0.0;
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+  }
+
+  ThreadManager::ThreadManager()
+    : _permissionWarned(false) {
+    _reportTimer.start();
+
+    // Created before any thread registers, these are the settings of the process
+    CPU_ZERO(&_defaultCores);
+    if(sched_getaffinity(0, sizeof(_defaultCores), &_defaultCores) < 0) {
+      for(int core = 0; core < CPU_SETSIZE; ++core)
+        CPU_SET(core, &_defaultCores);
+    }
+
+    errno = 0;
+    _defaultNice = getpriority(PRIO_PROCESS, 0);
+    if(errno != 0)
+      _defaultNice = 0;
+  }
+
+  bool ThreadManager::load(const std::string& fileName) {
+    cv::FileStorage fs(fileName, cv::FileStorage::READ);
+    if(!fs.isOpened()) {
+      Log::info("No thread settings in '" + fileName + "'. Threads keep the default scheduling.");
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    cv::FileNode root = fs.root();
+    for(cv::FileNode node : root) {
+      ThreadConfig config;
+      config.fifo = ((std::string) node["policy"] == "fifo");
+      config.priority = node["priority"].empty() ? 1 : (int) node["priority"];
+      config.hasNice = !node["nice"].empty();
+      config.nice = config.hasNice ? (int) node["nice"] : 0;
+
+      for(cv::FileNode core : node["cores"]) {
+        config.cores.push_back((int) core);
+      }
+
+      _configs[node.name()] = config;
+    }
+
+    Log::success("Thread settings loaded for " + std::to_string(_configs.size()) + " roles.");
+
+    return true;
+  }
+
+  void ThreadManager::registerCurrentThread(const std::string& role, int index) {
+    std::string name = (index < 0) ? role : role + std::to_string(index);
+
+    // Visible in top -H, ps -L and gdb. Names are limited to 15 characters
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#ifdef ARGOS_TRACE
+    Trace::setThreadName(name);
+#endif
+
+    ThreadInfo info;
+    info.name = name;
+    if(pthread_getcpuclockid(pthread_self(), &info.clock) != 0)
+      info.clock = CLOCK_THREAD_CPUTIME_ID;
+    info.lastCpu = clockSeconds(info.clock);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _threads[pthread_self()] = info;
+
+    // A role without settings still drops those inherited from its creator
+    ThreadConfig none;
+    none.fifo = false;
+    none.priority = 0;
+    none.nice = 0;
+    none.hasNice = false;
+
+    auto it = _configs.find(role);
+    apply(name, it != _configs.end() ? it->second : none);
+  }
+
+  void ThreadManager::unregisterCurrentThread() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _threads.erase(pthread_self());
+  }
+
+  void ThreadManager::releaseChild(pid_t pid) {
+    // Raising the nice value back never needs privileges, failures only mean the child already exited
+    sched_setaffinity(pid, sizeof(_defaultCores), &_defaultCores);
+    setpriority(PRIO_PROCESS, pid, _defaultNice);
+  }
+
+  void ThreadManager::apply(const std::string& name, const ThreadConfig& config) {
+    pid_t tid = syscall(SYS_gettid);
+
+    cpu_set_t set = _defaultCores;
+    if(!config.cores.empty()) {
+      CPU_ZERO(&set);
+      for(int core : config.cores) {
+        CPU_SET(core, &set);
+      }
+    }
+
+    if(sched_setaffinity(tid, sizeof(set), &set) < 0)
+      Log::error("Could not pin thread '" + name + "': " + strerror(errno) + ".");
+
+    if(config.fifo) {
+      struct sched_param param;
+      param.sched_priority = config.priority;
+
+      int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if(error == EPERM) {
+        if(!_permissionWarned) {
+          Log::error("Not allowed to use SCHED_FIFO, run with CAP_SYS_NICE or as root. Using normal scheduling.");
+          _permissionWarned = true;
+        }
+      }
+      else if(error != 0) {
+        Log::error("Could not set SCHED_FIFO for thread '" + name + "': " + strerror(error) + ".");
+      }
+    }
+
+    int nice = config.hasNice ? config.nice : _defaultNice;
+    if(setpriority(PRIO_PROCESS, tid, nice) < 0) {
+      if(errno != EACCES && errno != EPERM)
+        Log::error("Could not set the nice value of thread '" + name + "': " + strerror(errno) + ".");
+      else if(!_permissionWarned) {
+        Log::error("Not allowed to raise thread priorities, run with CAP_SYS_NICE or as root.");
+        _permissionWarned = true;
+      }
+    }
+  }
+
+  void ThreadManager::report() {
+    double elapsed = _reportTimer.getMicroseconds() / 1e6;
+    _reportTimer.start();
+
+    if(elapsed <= 0.0)
+      return;
+
+    std::string line = "Thread CPU usage:";
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(auto& pair : _threads) {
+      ThreadInfo& info = pair.second;
+      double cpu = clockSeconds(info.clock);
+
+      char usage[64];
+      snprintf(usage, sizeof(usage), " %s %.0f%%", info.name.c_str(), 100.0 * (cpu - info.lastCpu) / elapsed);
+      line += usage;
+
+      info.lastCpu = cpu;
+    }
+
+    Log::info(line + ".");
+  }
+
+  void ThreadManager::reportIfDue() {
+    if(_reportTimer.getSeconds() >= REPORT_SECONDS)
+      report();
+  }
+
+}
@@ -0,0 +1,135 @@
+#include "Trace.h"
+
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <iomanip>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "Log.h"
+
+namespace argosClient {
+
+  Trace::Span Trace::spans[Trace::CAPACITY];
+  std::atomic<uint64_t> Trace::head(0);
+  std::atomic<bool> Trace::dumpRequested(false);
+  thread_local unsigned long Trace::currentFrame = 0;
+  thread_local int Trace::currentTid = 0;
+
+  static std::mutex threadNamesMutex;
+  static std::map<int, std::string> threadNames;
+
+  uint64_t Trace::now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ull + time.tv_nsec;
+  }
+
+  void Trace::record(const char* name, uint64_t startNs, uint64_t endNs) {
+    if(!currentTid)
+      currentTid = syscall(SYS_gettid);
+
+    uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+    Span& span = spans[index % CAPACITY];
+
+    // Odd while writing, so the dump skips torn slots
+    span.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    span.name = name;
+    span.frameId = currentFrame;
+    span.startNs = startNs;
+    span.durationNs = endNs - startNs;
+    span.tid = currentTid;
+
+    span.sequence.store(index * 2 + 2, std::memory_order_release);
+  }
+
+  void Trace::setCurrentFrame(unsigned long frameId) {
+    currentFrame = frameId;
+  }
+
+  unsigned long Trace::getCurrentFrame() {
+    return currentFrame;
+  }
+
+  void Trace::setThreadName(const std::string& name) {
+    if(!currentTid)
+      currentTid = syscall(SYS_gettid);
+
+    std::lock_guard<std::mutex> lock(threadNamesMutex);
+    threadNames[currentTid] = name;
+  }
+
+  bool Trace::dump(const std::string& fileName) {
+    std::ofstream file(fileName.c_str());
+    if(!file) {
+      Log::error("Could not write the trace to '" + fileName + "'.");
+      return false;
+    }
+
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = (end > CAPACITY) ? end - CAPACITY : 0;
+    int pid = getpid();
+    bool first = true;
+    int written = 0;
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    {
+      std::lock_guard<std::mutex> lock(threadNamesMutex);
+      for(auto& pair : threadNames) {
+        file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+             << ",\"tid\":" << pair.first << ",\"args\":{\"name\":\"" << pair.second << "\"}}";
+        first = false;
+      }
+    }
+
+    // Microseconds since boot need more than the default 6 significant digits
+    file << std::fixed << std::setprecision(3);
+
+    for(uint64_t index = begin; index < end; ++index) {
+      Span& span = spans[index % CAPACITY];
+
+      if(span.sequence.load(std::memory_order_acquire) != index * 2 + 2)
+        continue;
+
+      const char* name = span.name;
+      unsigned long frameId = span.frameId;
+      uint64_t start = span.startNs;
+      uint64_t duration = span.durationNs;
+      int tid = span.tid;
+
+      // Overwritten while copying
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(span.sequence.load(std::memory_order_relaxed) != index * 2 + 2)
+        continue;
+
+      file << (first ? "" : ",") << "\n{\"name\":\"" << name << "\",\"cat\":\"argos\",\"ph\":\"X\",\"pid\":" << pid
+           << ",\"tid\":" << tid << ",\"ts\":" << start / 1000.0 << ",\"dur\":" << duration / 1000.0
+           << ",\"args\":{\"frame\":" << frameId << "}}";
+      first = false;
+      written++;
+    }
+
+    file << "\n]}\n";
+
+    Log::success("Trace with " + std::to_string(written) + " spans written to '" + fileName + "'.");
+
+    return true;
+  }
+
+  void Trace::requestDump() {
+    dumpRequested.store(true);
+  }
+
+  void Trace::dumpIfRequested() {
+    if(!dumpRequested.exchange(false))
+      return;
+
+    dump("argos_trace_" + std::to_string(time(nullptr)) + ".json");
+  }
+
+}
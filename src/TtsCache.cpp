@@ -0,0 +1,247 @@
+#include "TtsCache.h"
+
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <csignal>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "AudioManager.h"
+#include "ThreadManager.h"
+#include "Log.h"
+
+extern char** environ;
+
+namespace argosClient {
+
+  const char* const TtsCache::DEFAULT_COMMAND = "data/tts.sh";
+  const char* const TtsCache::DIRECTORY = "tts/";
+
+  static const char* const PREFIX = "tts:";
+
+  std::string TtsCache::command = DEFAULT_COMMAND;
+
+  TtsCache::TtsCache()
+    : _audioManager(AudioManager::getInstance()), _running(0) {
+
+  }
+
+  TtsCache::~TtsCache() {
+    for(auto& pair : _requests) {
+      if(pair.second.state == SYNTHESISING) {
+        kill(pair.second.pid, SIGTERM);
+        waitpid(pair.second.pid, nullptr, 0);
+        unlink(temporaryPath(pair.first).c_str());
+      }
+    }
+  }
+
+  void TtsCache::setCommand(const std::string& ttsCommand) {
+    command = ttsCommand;
+  }
+
+  bool TtsCache::parse(const std::string& name, std::string& lang, std::string& text) {
+    size_t prefix = strlen(PREFIX);
+    if(name.compare(0, prefix, PREFIX) != 0)
+      return false;
+
+    size_t colon = name.find(':', prefix);
+    if(colon == std::string::npos || colon == prefix || colon + 1 == name.size())
+      return false;
+
+    lang = name.substr(prefix, colon - prefix);
+    text = name.substr(colon + 1);
+
+    return true;
+  }
+
+  uint64_t TtsCache::hash(const std::string& lang, const std::string& text) {
+    uint64_t value = 14695981039346656037ULL;
+    auto add = [&value](unsigned char byte) {
+      value ^= byte;
+      value *= 1099511628211ULL;
+    };
+
+    // The separator keeps ("es", "x") and ("esx", "") apart
+    for(unsigned char c : lang)
+      add(c);
+    add(0);
+    for(unsigned char c : text)
+      add(c);
+
+    return value;
+  }
+
+  std::string TtsCache::getSoundName(const std::string& lang, const std::string& text) const {
+    // The language comes from the server, it must not reach outside the directory
+    std::string safeLang = lang;
+    for(char& c : safeLang) {
+      if(!isalnum((unsigned char) c) && c != '-' && c != '_')
+        c = '_';
+    }
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) hash(lang, text));
+
+    return std::string(DIRECTORY) + safeLang + "-" + hex + ".wav";
+  }
+
+  std::string TtsCache::temporaryPath(const std::string& name) const {
+    // Still a .wav, tts.sh writes there instead of its own sounds/ directory
+    return _audioManager.getSoundsPath() + name.substr(0, name.size() - 4) + ".part.wav";
+  }
+
+  void TtsCache::prefetch(const std::string& lang, const std::string& text) {
+    std::string name = getSoundName(lang, text);
+    if(_requests.find(name) != _requests.end())
+      return;
+
+    Request request;
+    request.lang = lang;
+    request.text = text;
+    request.state = QUEUED;
+    request.pid = -1;
+    _requests[name] = request;
+
+    // Synthesised by an earlier run, it only has to be loaded
+    if(access((_audioManager.getSoundsPath() + name).c_str(), R_OK) == 0) {
+      load(name);
+      return;
+    }
+
+    _queue.push_back(name);
+    update();
+  }
+
+  void TtsCache::prefetch(const std::string& lang, const std::vector<std::string>& texts) {
+    for(const std::string& text : texts)
+      prefetch(lang, text);
+  }
+
+  void TtsCache::prefetch(const std::string& name) {
+    std::string lang, text;
+    if(parse(name, lang, text))
+      prefetch(lang, text);
+  }
+
+  int TtsCache::play(const std::string& lang, const std::string& text, int loops) {
+    prefetch(lang, text);
+
+    std::string name = getSoundName(lang, text);
+    auto it = _requests.find(name);
+    if(it == _requests.end())
+      return -1;
+
+    if(it->second.state == READY)
+      return _audioManager.play(name, loops);
+
+    return PENDING;
+  }
+
+  bool TtsCache::isReady(const std::string& lang, const std::string& text) const {
+    auto it = _requests.find(getSoundName(lang, text));
+    return it != _requests.end() && it->second.state == READY;
+  }
+
+  bool TtsCache::isPending(const std::string& lang, const std::string& text) const {
+    auto it = _requests.find(getSoundName(lang, text));
+    return it != _requests.end() && it->second.state != READY;
+  }
+
+  bool TtsCache::spawn(const std::string& name) {
+    Request& request = _requests[name];
+    std::string output = temporaryPath(name);
+    mkdir((_audioManager.getSoundsPath() + DIRECTORY).c_str(), 0755);
+
+    // No shell in between, the text is a single argument whatever it contains
+    std::vector<char*> argv = {
+      const_cast<char*>(command.c_str()),
+      const_cast<char*>(request.lang.c_str()),
+      const_cast<char*>(request.text.c_str()),
+      const_cast<char*>(output.c_str()),
+      nullptr
+    };
+
+    pid_t pid;
+    int error = posix_spawnp(&pid, command.c_str(), nullptr, nullptr, argv.data(), environ);
+    if(error != 0) {
+      Log::error("Could not run the TTS command '" + command + "': " + strerror(error) + ".");
+      return false;
+    }
+
+    // Spawned by the render thread, the synthesis must not run on its core at its priority
+    ThreadManager::getInstance().releaseChild(pid);
+
+    Log::info("Synthesising '" + request.text + "' (" + request.lang + ")...");
+    request.pid = pid;
+    request.state = SYNTHESISING;
+    _running++;
+
+    return true;
+  }
+
+  void TtsCache::load(const std::string& name) {
+    _requests[name].state = LOADING;
+
+    _audioManager.preloadAsync(name, [this, name](bool loaded) {
+      auto it = _requests.find(name);
+      if(it == _requests.end())
+        return;
+
+      // A broken file is synthesised again by the next request
+      if(!loaded) {
+        unlink((_audioManager.getSoundsPath() + name).c_str());
+        _requests.erase(it);
+        return;
+      }
+
+      it->second.state = READY;
+    });
+  }
+
+  void TtsCache::update() {
+    std::vector<std::string> synthesised;
+    for(auto it = _requests.begin(); it != _requests.end();) {
+      Request& request = it->second;
+      int status = 0;
+      pid_t done = request.state == SYNTHESISING ? waitpid(request.pid, &status, WNOHANG) : 0;
+      if(done == 0) {
+        ++it;
+        continue;
+      }
+
+      _running--;
+
+      // The file is renamed once complete, a file in the cache is always a whole one
+      std::string temporary = temporaryPath(it->first);
+      std::string path = _audioManager.getSoundsPath() + it->first;
+      struct stat st;
+      if(done == request.pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && stat(temporary.c_str(), &st) == 0 && st.st_size > 0 &&
+         rename(temporary.c_str(), path.c_str()) == 0) {
+        synthesised.push_back(it->first);
+        ++it;
+      }
+      else {
+        Log::error("The TTS command failed to synthesise '" + request.text + "' (" + request.lang + ").");
+        unlink(temporary.c_str());
+        it = _requests.erase(it);
+      }
+    }
+
+    for(const std::string& name : synthesised)
+      load(name);
+
+    while(_running < MAX_RUNNING && !_queue.empty()) {
+      std::string name = _queue.front();
+      _queue.pop_front();
+
+      auto it = _requests.find(name);
+      if(it != _requests.end() && it->second.state == QUEUED && !spawn(name))
+        _requests.erase(it);
+    }
+  }
+
+}
@@ -0,0 +1,206 @@
+#include "V4L2FrameSource.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+#include "Log.h"
+
+namespace argosClient {
+
+  V4L2FrameSource::V4L2FrameSource(const std::string& device, int width, int height)
+    : FrameSource(width, height), _device(device), _fd(-1), _pixelFormat(0), _bytesPerLine(0),
+      _dequeued(-1), _dequeuedBytes(0) {
+
+  }
+
+  V4L2FrameSource::~V4L2FrameSource() {
+    release();
+  }
+
+  int V4L2FrameSource::xioctl(unsigned long request, void* argument) {
+    int result;
+    do {
+      result = ioctl(_fd, request, argument);
+    } while(result < 0 && errno == EINTR);
+
+    return result;
+  }
+
+  bool V4L2FrameSource::open() {
+    _fd = ::open(_device.c_str(), O_RDWR);
+    if(_fd < 0) {
+      Log::error("Could not open '" + _device + "': " + strerror(errno) + ".");
+      return false;
+    }
+
+    struct v4l2_capability capability;
+    memset(&capability, 0, sizeof(capability));
+    if(xioctl(VIDIOC_QUERYCAP, &capability) < 0 ||
+       !(capability.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(capability.capabilities & V4L2_CAP_STREAMING)) {
+      Log::error("'" + _device + "' is not a streaming capture device.");
+      release();
+      return false;
+    }
+
+    if(!setFormat() || !startStreaming()) {
+      release();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool V4L2FrameSource::setFormat() {
+    // Formats converted without any intermediate copy, best first
+    const unsigned int formats[] = { V4L2_PIX_FMT_BGR24, V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_UYVY };
+
+    for(unsigned int pixelFormat : formats) {
+      struct v4l2_format format;
+      memset(&format, 0, sizeof(format));
+      format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      format.fmt.pix.width = _width;
+      format.fmt.pix.height = _height;
+      format.fmt.pix.pixelformat = pixelFormat;
+      format.fmt.pix.field = V4L2_FIELD_NONE;
+
+      if(xioctl(VIDIOC_S_FMT, &format) < 0 || format.fmt.pix.pixelformat != pixelFormat)
+        continue;
+
+      // The driver may pick the closest size it supports
+      _width = format.fmt.pix.width;
+      _height = format.fmt.pix.height;
+      _bytesPerLine = format.fmt.pix.bytesperline;
+      _pixelFormat = pixelFormat;
+
+      return true;
+    }
+
+    Log::error("'" + _device + "' supports neither BGR24 nor YUYV/UYVY.");
+    return false;
+  }
+
+  bool V4L2FrameSource::startStreaming() {
+    struct v4l2_requestbuffers request;
+    memset(&request, 0, sizeof(request));
+    request.count = BUFFER_COUNT;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+
+    if(xioctl(VIDIOC_REQBUFS, &request) < 0 || request.count < 2) {
+      Log::error("'" + _device + "' could not allocate its buffers.");
+      return false;
+    }
+
+    for(unsigned int i = 0; i < request.count; ++i) {
+      struct v4l2_buffer buffer;
+      memset(&buffer, 0, sizeof(buffer));
+      buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      buffer.memory = V4L2_MEMORY_MMAP;
+      buffer.index = i;
+
+      if(xioctl(VIDIOC_QUERYBUF, &buffer) < 0)
+        return false;
+
+      Buffer mapped;
+      mapped.length = buffer.length;
+      mapped.start = mmap(nullptr, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, buffer.m.offset);
+      if(mapped.start == MAP_FAILED) {
+        Log::error("Could not map the buffers of '" + _device + "'.");
+        return false;
+      }
+      _buffers.push_back(mapped);
+
+      if(xioctl(VIDIOC_QBUF, &buffer) < 0)
+        return false;
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if(xioctl(VIDIOC_STREAMON, &type) < 0) {
+      Log::error("'" + _device + "' could not start streaming.");
+      return false;
+    }
+
+    return true;
+  }
+
+  bool V4L2FrameSource::isOpened() const {
+    return _fd >= 0;
+  }
+
+  bool V4L2FrameSource::grab() {
+    if(_fd < 0)
+      return false;
+
+    // Give the previous buffer back to the driver
+    if(_dequeued >= 0) {
+      struct v4l2_buffer buffer;
+      memset(&buffer, 0, sizeof(buffer));
+      buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      buffer.memory = V4L2_MEMORY_MMAP;
+      buffer.index = _dequeued;
+      xioctl(VIDIOC_QBUF, &buffer);
+      _dequeued = -1;
+    }
+
+    struct v4l2_buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buffer.memory = V4L2_MEMORY_MMAP;
+
+    // Blocks until the driver fills a buffer
+    if(xioctl(VIDIOC_DQBUF, &buffer) < 0)
+      return false;
+
+    _dequeued = buffer.index;
+    _dequeuedBytes = buffer.bytesused;
+
+    return true;
+  }
+
+  void V4L2FrameSource::retrieve(cv::Mat& image) {
+    if(_dequeued < 0)
+      return;
+
+    // A header over the mapped buffer, nothing is copied until the conversion
+    void* data = _buffers[_dequeued].start;
+
+    switch(_pixelFormat) {
+    case V4L2_PIX_FMT_BGR24:
+      cv::Mat(_height, _width, CV_8UC3, data, _bytesPerLine).copyTo(image);
+      break;
+    case V4L2_PIX_FMT_YUYV:
+      cv::cvtColor(cv::Mat(_height, _width, CV_8UC2, data, _bytesPerLine), image, CV_YUV2BGR_YUYV);
+      break;
+    case V4L2_PIX_FMT_UYVY:
+      cv::cvtColor(cv::Mat(_height, _width, CV_8UC2, data, _bytesPerLine), image, CV_YUV2BGR_UYVY);
+      break;
+    }
+  }
+
+  void V4L2FrameSource::release() {
+    if(_fd < 0)
+      return;
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    xioctl(VIDIOC_STREAMOFF, &type);
+
+    for(Buffer& buffer : _buffers) {
+      munmap(buffer.start, buffer.length);
+    }
+    _buffers.clear();
+    _dequeued = -1;
+
+    ::close(_fd);
+    _fd = -1;
+  }
+
+  std::string V4L2FrameSource::getName() const {
+    return "V4L2 " + _device + " " + std::to_string(_width) + "x" + std::to_string(_height);
+  }
+
+}
@@ -0,0 +1,188 @@
+#include "VideoClip.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "Log.h"
+
+namespace argosClient {
+
+  static const char CLIP_MAGIC[8] = { 'A', 'R', 'G', 'O', 'S', 'C', 'L', 'P' };
+  static const uint32_t CLIP_VERSION = 1;
+
+  VideoClip::VideoClip()
+    : _mapping(nullptr), _mappingSize(0), _header(nullptr), _frames(nullptr) {
+
+  }
+
+  VideoClip::~VideoClip() {
+    close();
+  }
+
+  bool VideoClip::convert(const std::string& videoFile, const std::string& clipFile, size_t maxBytes) {
+    cv::VideoCapture reader(videoFile);
+    if(!reader.isOpened()) {
+      Log::error("Could not open video file '" + videoFile + "' to build a clip.");
+      return false;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, CLIP_MAGIC, sizeof(CLIP_MAGIC));
+    header.version = CLIP_VERSION;
+    header.width = (uint32_t) reader.get(CV_CAP_PROP_FRAME_WIDTH);
+    header.height = (uint32_t) reader.get(CV_CAP_PROP_FRAME_HEIGHT);
+    header.channels = 3;
+    header.frameSize = header.width * header.height * header.channels;
+    header.fps = (float) reader.get(CV_CAP_PROP_FPS);
+
+    // The frame count reported by the container is only an estimation, but it is
+    // good enough to reject long videos before decoding them
+    size_t estimated = sizeof(Header) + (size_t) reader.get(CV_CAP_PROP_FRAME_COUNT) * header.frameSize;
+    if(maxBytes > 0 && estimated > maxBytes) {
+      Log::info("Video file '" + videoFile + "' is too long to be cached as a clip (" +
+                std::to_string(estimated / 1024) + " KB).");
+      return false;
+    }
+
+    // Write to a temporary file first so a half-written clip is never mapped
+    std::string tmpFile = clipFile + ".tmp";
+    FILE* f = fopen(tmpFile.c_str(), "wb");
+    if(!f) {
+      Log::error("Could not create the clip file '" + tmpFile + "'.");
+      return false;
+    }
+
+    fwrite(&header, sizeof(Header), 1, f);
+
+    cv::Mat frame, rgb;
+    size_t written = sizeof(Header);
+    bool ok = true;
+    while(reader.read(frame) && !frame.empty()) {
+      if(frame.cols != (int) header.width || frame.rows != (int) header.height) {
+        Log::error("Video file '" + videoFile + "' changes its resolution. It can not be cached.");
+        ok = false;
+        break;
+      }
+
+      cv::cvtColor(frame, rgb, CV_BGR2RGB);
+      for(int row = 0; row < rgb.rows; ++row) {
+        fwrite(rgb.ptr(row), 1, rgb.cols * header.channels, f);
+      }
+
+      written += header.frameSize;
+      if(maxBytes > 0 && written > maxBytes) {
+        Log::info("Video file '" + videoFile + "' is too long to be cached as a clip.");
+        ok = false;
+        break;
+      }
+
+      ++header.frameCount;
+    }
+
+    // Rewrite the header with the real number of frames
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(Header), 1, f);
+    ok = ok && !ferror(f) && header.frameCount > 0;
+    fclose(f);
+
+    if(!ok || rename(tmpFile.c_str(), clipFile.c_str()) != 0) {
+      unlink(tmpFile.c_str());
+      return false;
+    }
+
+    Log::success("Clip '" + clipFile + "' built: " + std::to_string(header.width) + "x" + std::to_string(header.height) +
+                 ", " + std::to_string(header.frameCount) + " frames, " + std::to_string(written / 1024) + " KB.");
+
+    return true;
+  }
+
+  bool VideoClip::open(const std::string& clipFile) {
+    close();
+
+    int fd = ::open(clipFile.c_str(), O_RDONLY);
+    if(fd < 0) {
+      return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(Header)) {
+      ::close(fd);
+      return false;
+    }
+
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED) {
+      Log::error("Could not map the clip file '" + clipFile + "'.");
+      return false;
+    }
+
+    const Header* header = static_cast<const Header*>(mapping);
+    size_t expected = sizeof(Header) + (size_t) header->frameCount * header->frameSize;
+    if(memcmp(header->magic, CLIP_MAGIC, sizeof(CLIP_MAGIC)) != 0 || header->version != CLIP_VERSION ||
+       header->frameSize != header->width * header->height * header->channels || (size_t) st.st_size < expected) {
+      Log::error("Clip file '" + clipFile + "' is not valid.");
+      munmap(mapping, st.st_size);
+      return false;
+    }
+
+    // Clips are played sequentially, so let the kernel read ahead
+    madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+    madvise(mapping, st.st_size, MADV_WILLNEED);
+
+    _mapping = mapping;
+    _mappingSize = st.st_size;
+    _header = header;
+    _frames = static_cast<const unsigned char*>(mapping) + sizeof(Header);
+
+    return true;
+  }
+
+  void VideoClip::close() {
+    if(_mapping) {
+      munmap(_mapping, _mappingSize);
+    }
+
+    _mapping = nullptr;
+    _mappingSize = 0;
+    _header = nullptr;
+    _frames = nullptr;
+  }
+
+  bool VideoClip::isOpened() const {
+    return _mapping != nullptr;
+  }
+
+  const unsigned char* VideoClip::frame(int index) const {
+    if(!_header || index < 0 || index >= (int) _header->frameCount)
+      return nullptr;
+
+    return _frames + (size_t) index * _header->frameSize;
+  }
+
+  int VideoClip::getWidth() const {
+    return _header ? _header->width : 0;
+  }
+
+  int VideoClip::getHeight() const {
+    return _header ? _header->height : 0;
+  }
+
+  int VideoClip::getFrameCount() const {
+    return _header ? _header->frameCount : 0;
+  }
+
+  float VideoClip::getFps() const {
+    return _header ? _header->fps : 0.0f;
+  }
+
+}
@@ -1,5 +1,7 @@
 #include "VideoComponent.h"
 #include "GLContext.h"
+#include "ClipCache.h"
+#include "AVDecoder.h"
 
 #include <iostream>
 
@@ -11,11 +13,23 @@
 #include <opencv2/highgui/highgui.hpp>
 
 #include "Log.h"
+#include "Metrics.h"
+#include "GpuCounters.h"
+#include "GpuMemoryTracker.h"
 
 namespace argosClient {
 
+  const float VideoComponent::DEFAULT_FPS = 25.0f;
+
   VideoComponent::VideoComponent(GLfloat width, GLfloat height)
-    : _width(width), _height(height), _textureId(-1), _loop(false) {
+    : _width(width), _height(height), _textureId(-1),
+      _yuvVertexHandler(-1), _yuvTexHandler(-1), _yuvMvpHandler(-1), _yuvRangeHandler(-1), _yuvWidth(0), _yuvHeight(0),
+      _shownFrame(-1), _decodedFrame(-1), _textureWidth(0), _textureHeight(0), _fps(DEFAULT_FPS), _playing(false), _finished(false), _loop(false) {
+    for(int i = 0; i < 3; ++i) {
+      _yuvTextures[i] = 0;
+      _yuvSamplerHandlers[i] = -1;
+    }
+
     /**
      *    0__1
      *    | /|
@@ -42,59 +56,135 @@ namespace argosClient {
   }
 
   VideoComponent::~VideoComponent() {
+    // The decoder must stop before the textures go away
+    _decoder.reset();
+
     delete [] _indices;
     delete [] _vertexData;
-    glDeleteTextures(1, &_textureId);
+    GpuMemoryTracker::deleteTextures(1, &_textureId);
+
+    if(_yuvTextures[0]) {
+      GpuMemoryTracker::deleteTextures(3, _yuvTextures);
+    }
   }
 
   void VideoComponent::setLoop(bool loop) {
     _loop = loop;
+
+    if(_decoder)
+      _decoder->setLoop(loop);
   }
 
   void VideoComponent::loadVideoFromFile(const std::string& fileName) {
-    // Load the video file
     _fileName = fileName;
-    _videoReader.open(_fileName);
-    if(!_videoReader.isOpened()) {
-      Log::error("Could not open video file '" + _fileName + "'.");
-      exit(1);
+    _shownFrame = -1;
+    _decodedFrame = -1;
+    _playing = false;
+    _finished = false;
+    _decoder.reset();
+
+    // Short videos are played straight from their pre-decoded clip
+    _clip = ClipCache::getInstance().get(_fileName);
+    if(_clip) {
+      _fps = _clip->getFps();
+      Log::success("Video file '" + _fileName + "' loaded from its clip.");
+      Log::success("Video information: " + std::to_string(_clip->getWidth()) + "x" + std::to_string(_clip->getHeight()) + ". " +
+                   std::to_string(_clip->getFrameCount()) + " frames.");
+    }
+    else {
+      _decoder.reset(new AVDecoder());
+      _decoder->setLoop(_loop);
+      if(!_decoder->open(_fileName))
+        _decoder.reset();
     }
 
-    cv::Size info = cv::Size((int) _videoReader.get(CV_CAP_PROP_FRAME_WIDTH),
-                             (int) _videoReader.get(CV_CAP_PROP_FRAME_HEIGHT));
+    if(_decoder) {
+      _fps = _decoder->getFps();
+      loadYUVProgram();
+      Log::success("Video information: " + std::to_string(_decoder->getWidth()) + "x" + std::to_string(_decoder->getHeight()) + ".");
+    }
+    else if(!_clip) {
+      // Load the video file
+      _videoReader.open(_fileName);
+      if(!_videoReader.isOpened()) {
+        Log::error("Could not open video file '" + _fileName + "'.");
+        exit(1);
+      }
+
+      cv::Size info = cv::Size((int) _videoReader.get(CV_CAP_PROP_FRAME_WIDTH),
+                               (int) _videoReader.get(CV_CAP_PROP_FRAME_HEIGHT));
+      _fps = (float) _videoReader.get(CV_CAP_PROP_FPS);
 
-    Log::success("Video file '" + _fileName + "' loaded.");
-    Log::success("Video information: " + std::to_string(info.width) + "x" + std::to_string(info.height) + ". " +
-                 std::to_string(_videoReader.get(CV_CAP_PROP_FRAME_COUNT)) + " frames.");
+      Log::success("Video file '" + _fileName + "' loaded.");
+      Log::success("Video information: " + std::to_string(info.width) + "x" + std::to_string(info.height) + ". " +
+                   std::to_string(_videoReader.get(CV_CAP_PROP_FRAME_COUNT)) + " frames.");
+    }
 
-    readVideoFrame(_videoFrame);
+    // Some containers do not report their frame rate
+    if(!(_fps > 0.0f) || _fps > 120.0f) {
+      Log::info("Unknown frame rate for '" + _fileName + "'. Assuming " + std::to_string((int) DEFAULT_FPS) + " fps.");
+      _fps = DEFAULT_FPS;
+    }
   }
 
   void VideoComponent::readVideoFrame(cv::Mat& videoFrame) {
     _videoReader >> videoFrame;
-    cvtColor(videoFrame, videoFrame, CV_BGR2RGB);
+    if(!videoFrame.empty())
+      cvtColor(videoFrame, videoFrame, CV_BGR2RGB);
+  }
+
+  void VideoComponent::loadYUVProgram() {
+    if(_yuvVertexHandler != -1)
+      return;
+
+    _yuvShader.loadShaders("shaders/video.glvs", "shaders/videoyuv.glfs");
+
+    GLint id = _yuvShader.getId();
+
+    _yuvVertexHandler = glGetAttribLocation(id, "a_position");
+    _yuvTexHandler = glGetAttribLocation(id, "a_texCoord");
+    _yuvMvpHandler = glGetUniformLocation(id, "u_mvp");
+    _yuvSamplerHandlers[0] = glGetUniformLocation(id, "s_textureY");
+    _yuvSamplerHandlers[1] = glGetUniformLocation(id, "s_textureU");
+    _yuvSamplerHandlers[2] = glGetUniformLocation(id, "s_textureV");
+    _yuvRangeHandler = glGetUniformLocation(id, "u_fullRange");
   }
 
   void VideoComponent::makeVideoTexture(const cv::Mat& mat) {
+    uploadVideoTexture(mat.data, mat.cols, mat.rows, mat.step);
+  }
+
+  void VideoComponent::uploadVideoTexture(const unsigned char* data, int width, int height, size_t step) {
     // Byte alignment
-    glPixelStorei(GL_UNPACK_ALIGNMENT, (mat.step & 3) ? 1 : 4);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, (step & 3) ? 1 : 4);
 
     // Generate a texture object
     if(!glIsTexture(_textureId)) {
-      glGenTextures(1, &_textureId);
+      GpuMemoryTracker::genTextures(1, &_textureId);
+      _textureWidth = _textureHeight = 0;
     }
 
     // Bind the texture object
-    glBindTexture(GL_TEXTURE_2D, _textureId);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, _textureId);
+
+    // Only (re)allocate the texture storage when the frame size changes
+    if(width != _textureWidth || height != _textureHeight) {
+      // Set the filtering mode
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    // Set the filtering mode
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      // Create a gl texture
+      GpuCounters::texImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+      GpuMemoryTracker::textureStorage(_textureId, width, height, GL_RGB, GL_UNSIGNED_BYTE);
 
-    // Create a gl texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, mat.cols, mat.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, mat.data);
+      _textureWidth = width;
+      _textureHeight = height;
+    }
+    else {
+      GpuCounters::texSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, data);
+    }
   }
 
   void VideoComponent::setUpShader() {
@@ -106,16 +196,165 @@ namespace argosClient {
     _samplerHandler = glGetUniformLocation(id, "s_texture");
   }
 
-  void VideoComponent::specificRender() {
-    if(_loop) {
-      if(_videoFrame.empty())
-        _videoReader.set(CV_CAP_PROP_POS_FRAMES, 0);
+  int VideoComponent::presentationFrame() {
+    // The media clock starts with the first rendered frame
+    if(!_playing) {
+      _clock.start();
+      _playing = true;
     }
-    else {
-      if(_videoFrame.empty())
-        return;
+
+    return (int) (_clock.getMicroseconds() * _fps / 1000000.0f);
+  }
+
+  void VideoComponent::countDropped(int frame) const {
+    // The frames between the shown one and the new one never reached the screen
+    static Counter& dropped = Metrics::getInstance().counter("video_frames_dropped");
+    if(_shownFrame >= 0 && frame > _shownFrame + 1)
+      dropped.add(frame - _shownFrame - 1);
+  }
+
+  bool VideoComponent::updateClipFrame() {
+    int frame = presentationFrame();
+    int frameCount = _clip->getFrameCount();
+
+    if(frame >= frameCount) {
+      if(!_loop)
+        return false;
+      frame %= frameCount;
+    }
+
+    // Frames are only uploaded when the presentation time reaches them
+    if(frame != _shownFrame) {
+      countDropped(frame);
+      uploadVideoTexture(_clip->frame(frame), _clip->getWidth(), _clip->getHeight(), _clip->getWidth() * 3);
+      _shownFrame = frame;
     }
 
+    return true;
+  }
+
+  bool VideoComponent::updateDecoderFrame() {
+    const AVDecoder::YUVFrame* frame = _decoder->frameAt(presentationFrame());
+
+    if(frame && frame->index != _shownFrame) {
+      countDropped(frame->index);
+
+      // Planes are tightly packed
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+      if(!_yuvTextures[0]) {
+        GpuMemoryTracker::genTextures(3, _yuvTextures);
+        _yuvWidth = _yuvHeight = 0;
+      }
+
+      bool allocate = (frame->width != _yuvWidth || frame->height != _yuvHeight);
+      for(int p = 0; p < 3; ++p) {
+        int width = frame->strides[p];
+        int height = (p == 0) ? frame->height : (frame->height + 1) / 2;
+
+        GpuCounters::bindTexture(GL_TEXTURE_2D, _yuvTextures[p]);
+        if(allocate) {
+          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+          GpuCounters::texImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, &frame->planes[p][0]);
+          GpuMemoryTracker::textureStorage(_yuvTextures[p], width, height, GL_LUMINANCE, GL_UNSIGNED_BYTE);
+        }
+        else {
+          GpuCounters::texSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_LUMINANCE, GL_UNSIGNED_BYTE, &frame->planes[p][0]);
+        }
+      }
+
+      _yuvWidth = frame->width;
+      _yuvHeight = frame->height;
+      _shownFrame = frame->index;
+    }
+
+    if(_decoder->isFinished())
+      return false;
+
+    return _shownFrame >= 0;
+  }
+
+  void VideoComponent::renderYUV() {
+    _yuvShader.useProgram();
+
+    glVertexAttribPointer(_yuvVertexHandler, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), _vertexData);
+    glEnableVertexAttribArray(_yuvVertexHandler);
+    glVertexAttribPointer(_yuvTexHandler, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), &_vertexData[3]);
+    glEnableVertexAttribArray(_yuvTexHandler);
+
+    glUniformMatrix4fv(_yuvMvpHandler, 1, GL_FALSE, glm::value_ptr(_projectionMatrix * _modelViewMatrix * _model));
+    glUniform1f(_yuvRangeHandler, _decoder->isFullRange() ? 1.0f : 0.0f);
+
+    for(int p = 0; p < 3; ++p) {
+      glActiveTexture(GL_TEXTURE0 + p);
+      GpuCounters::bindTexture(GL_TEXTURE_2D, _yuvTextures[p]);
+      glUniform1i(_yuvSamplerHandlers[p], p);
+    }
+
+    GpuCounters::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
+
+    glActiveTexture(GL_TEXTURE0);
+  }
+
+  bool VideoComponent::decodeFrame() {
+    if(_finished)
+      return false;
+
+    int frame = presentationFrame();
+    if(frame <= _decodedFrame)
+      return true;
+
+    // Frames whose presentation time has already passed are skipped without being converted
+    bool ended = false;
+    static Counter& dropped = Metrics::getInstance().counter("video_frames_dropped");
+    while(_decodedFrame < frame - 1 && !ended) {
+      ended = !_videoReader.grab();
+      ++_decodedFrame;
+      dropped.add();
+    }
+
+    if(!ended) {
+      readVideoFrame(_videoFrame);
+      ended = _videoFrame.empty();
+    }
+
+    if(ended) {
+      if(!_loop) {
+        _finished = true;
+        return false;
+      }
+
+      _videoReader.set(CV_CAP_PROP_POS_FRAMES, 0);
+      _clock.start();
+      _decodedFrame = -1;
+
+      readVideoFrame(_videoFrame);
+      if(_videoFrame.empty()) {
+        _finished = true;
+        return false;
+      }
+    }
+
+    ++_decodedFrame;
+    makeVideoTexture(_videoFrame);
+
+    return true;
+  }
+
+  void VideoComponent::specificRender() {
+    if(_decoder) {
+      if(updateDecoderFrame())
+        renderYUV();
+      return;
+    }
+
+    bool ready = _clip ? updateClipFrame() : decodeFrame();
+    if(!ready)
+      return;
+
     _shader.useProgram();
 
     glVertexAttribPointer(_vertexHandler, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), _vertexData);
@@ -126,13 +365,10 @@ namespace argosClient {
     glUniformMatrix4fv(_mvpHandler, 1, GL_FALSE, glm::value_ptr(_projectionMatrix * _modelViewMatrix * _model));
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _textureId);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, _textureId);
     glUniform1i(_samplerHandler, 0);
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
-
-    readVideoFrame(_videoFrame);
-    makeVideoTexture(_videoFrame);
+    GpuCounters::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
   }
 
 }
@@ -1,7 +1,17 @@
 #include "VideoStreamComponent.h"
+#include "GLContext.h"
+#include "JpegDecoder.h"
 #include "Log.h"
+#include "ThreadManager.h"
+#include "TaskPool.h"
+#include "Metrics.h"
+#include "GpuCounters.h"
+#include "GpuMemoryTracker.h"
 
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <poll.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -10,9 +20,18 @@ using boost::asio::ip::udp;
 
 namespace argosClient {
 
+  // How often the receiving thread checks whether the component is being destroyed
+  static const int STOP_POLL_MS = 50;
+
+  VideoStreamComponent::DecodeState::DecodeState()
+    : jpegBytes(0), decoding(false), ready(false), received(false), targetWidth(0), targetHeight(0) {
+
+  }
+
   VideoStreamComponent::VideoStreamComponent(GLfloat width, GLfloat height)
     : _vertexData(nullptr), _width(width), _height(height),
-      _textureId(-1), _ready(false), _receive(false), _videoThread(nullptr) {
+      _textureId(-1), _textureWidth(0), _textureHeight(0),
+      _state(std::make_shared<DecodeState>()), _stopping(false) {
     /**
      *    0__1
      *    | /|
@@ -34,58 +53,115 @@ namespace argosClient {
   }
 
   VideoStreamComponent::~VideoStreamComponent() {
+    // A decode task still queued keeps its own reference to the state, only the thread is waited for
+    _stopping = true;
+    if(_videoThread.joinable())
+      _videoThread.join();
+
     delete [] _indices;
     delete [] _vertexData;
 
-    glDeleteTextures(1, &_textureId);
+    GpuMemoryTracker::deleteTextures(1, &_textureId);
   }
 
   void VideoStreamComponent::startReceivingVideo(unsigned short port) {
-    _videoThread = new std::thread(&VideoStreamComponent::receiveVideo, this, port);
-    _videoThread->detach();
+    _videoThread = std::thread(&VideoStreamComponent::receiveVideo, this, port);
+  }
+
+  bool VideoStreamComponent::receivePacket(udp::socket& udpSocket, void* buffer, size_t size, udp::endpoint& udpSenderEndpoint, size_t& bytes) {
+    while(!_stopping) {
+      pollfd descriptor = { udpSocket.native_handle(), POLLIN, 0 };
+      if(poll(&descriptor, 1, STOP_POLL_MS) <= 0)
+        continue;
+
+      boost::system::error_code error;
+      bytes = udpSocket.receive_from(boost::asio::buffer(buffer, size), udpSenderEndpoint, 0, error);
+      if(!error)
+        return true;
+    }
+
+    return false;
   }
 
   void VideoStreamComponent::receiveVideo(unsigned short port) {
+    ThreadManager::getInstance().registerCurrentThread("videostream");
+
     boost::asio::io_service ioService;
     udp::endpoint endpoint(udp::v4(), port);
     udp::socket udpSocket(ioService, endpoint);
 
-    while(1) {
+    // Never blocks in receive_from, the thread waits in poll() and notices the destruction
+    udpSocket.non_blocking(true);
+
+    // Reused for every frame, it only grows
+    std::vector<unsigned char> data_buf;
+
+    while(!_stopping) {
       udp::endpoint udpSenderEndpoint;
 
       size_t bytes = 0;
       unsigned char type_buf[sizeof(int)];
       unsigned char size_buf[sizeof(int)];
-      unsigned char* data_buf;
       int size, type;
 
-      Log::video("Waiting for new video frames.");
+      ARGOS_LOG_VIDEO("Waiting for new video frames.");
 
       _timer.start();
 
       // Type.
-      udpSocket.receive_from(boost::asio::buffer(&type_buf, sizeof(int)), udpSenderEndpoint);
+      if(!receivePacket(udpSocket, type_buf, sizeof(int), udpSenderEndpoint, bytes))
+        break;
       memcpy(&type, &type_buf, sizeof(int));
 
       // Size.
-      udpSocket.receive_from(boost::asio::buffer(&size_buf, sizeof(int)), udpSenderEndpoint);
+      if(!receivePacket(udpSocket, size_buf, sizeof(int), udpSenderEndpoint, bytes))
+        break;
       memcpy(&size, &size_buf, sizeof(int));
 
-      // Mat data
-      data_buf = new unsigned char[size];
-      bytes = udpSocket.receive_from(boost::asio::buffer(data_buf, size), udpSenderEndpoint);
-      std::vector<unsigned char> transformed(&data_buf[0], &data_buf[size]);
-      delete [] data_buf;
+      if(size <= 0)
+        continue;
 
-      _mutex.lock();
-      _receivedFrame = cv::imdecode(transformed, CV_LOAD_IMAGE_UNCHANGED);
-      _mutex.unlock();
+      // JPEG data
+      if(data_buf.size() < (size_t) size)
+        data_buf.resize(size);
+      if(!receivePacket(udpSocket, &data_buf[0], size, udpSenderEndpoint, bytes))
+        break;
 
-      Log::video(std::to_string(bytes) + " bytes of video received.");
+      ARGOS_LOG_VIDEO(std::to_string(bytes) + " bytes of video received.");
 
-      _ready = true;
-      _receive = true;
+      // Only one frame is decoded at a time, frames arriving meanwhile are dropped so they never queue up
+      bool idle = false;
+      if(!_state->decoding.compare_exchange_strong(idle, true)) {
+        ARGOS_LOG_VIDEO_EVERY(1.0f, "Video frame dropped, the previous one is still being decoded.");
+        static Counter& dropped = Metrics::getInstance().counter("video_frames_dropped");
+        dropped.add();
+        continue;
+      }
+
+      // The decoder gets the packet, we keep its previous buffer for the next one
+      _state->jpegData.swap(data_buf);
+      _state->jpegBytes = bytes;
+      std::shared_ptr<DecodeState> state = _state;
+      TaskPool::getInstance().post([state]() {
+        decodeReceived(state);
+      });
     }
+
+    ThreadManager::getInstance().unregisterCurrentThread();
+  }
+
+  void VideoStreamComponent::decodeReceived(const std::shared_ptr<DecodeState>& state) {
+    // Decode outside the lock, straight at the size the frame is shown at
+    if(JpegDecoder::decode(&state->jpegData[0], state->jpegBytes, state->targetWidth, state->targetHeight, state->decodingFrame)) {
+      state->mutex.lock();
+      std::swap(state->decodingFrame, state->receivedFrame);
+      state->mutex.unlock();
+
+      state->ready = true;
+      state->received = true;
+    }
+
+    state->decoding = false;
   }
 
   size_t VideoStreamComponent::sendVideo(const cv::Mat& mat, udp::socket& udpSocket, const udp::endpoint& udpSenderEndpoint) {
@@ -128,20 +204,57 @@ namespace argosClient {
 
     // Generate a texture object
     if(!glIsTexture(_textureId)) {
-      glGenTextures(1, &_textureId);
+      GpuMemoryTracker::genTextures(1, &_textureId);
     }
 
     // Bind the texture object
-    glBindTexture(GL_TEXTURE_2D, _textureId);
+    GpuCounters::bindTexture(GL_TEXTURE_2D, _textureId);
+
+    // Only reallocate the texture when the decoded size changes
+    if(mat.cols == _textureWidth && mat.rows == _textureHeight) {
+      GpuCounters::texSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mat.cols, mat.rows, GL_RGB, GL_UNSIGNED_BYTE, mat.data);
+      return;
+    }
 
     // Set the filtering mode
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     // Create a gl texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, mat.cols, mat.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, mat.data);
+    GpuCounters::texImage2D(GL_TEXTURE_2D, 0, GL_RGB, mat.cols, mat.rows, 0, GL_RGB, GL_UNSIGNED_BYTE, mat.data);
+    GpuMemoryTracker::textureStorage(_textureId, mat.cols, mat.rows, GL_RGB, GL_UNSIGNED_BYTE);
+
+    _textureWidth = mat.cols;
+    _textureHeight = mat.rows;
+  }
+
+  void VideoStreamComponent::updateTargetSize() {
+    GLContext& context = GLContext::getInstance();
+    glm::mat4 mvp = _projectionMatrix * _modelViewMatrix * _model;
+    glm::vec2 corners[4];
+
+    for(int i = 0; i < 4; ++i) {
+      glm::vec4 clip = mvp * glm::vec4(_vertexData[i * 5], _vertexData[i * 5 + 1], _vertexData[i * 5 + 2], 1.0f);
+
+      // Behind the projector, the size is meaningless: decode at full size
+      if(clip.w <= 0.0f) {
+        _state->targetWidth = 0;
+        _state->targetHeight = 0;
+        return;
+      }
+
+      corners[i] = glm::vec2((clip.x / clip.w * 0.5f + 0.5f) * context.getWidth(),
+                             (clip.y / clip.w * 0.5f + 0.5f) * context.getHeight());
+    }
+
+    // The longest of the opposite edges, the quad may be seen in perspective
+    float width = std::max(glm::length(corners[1] - corners[0]), glm::length(corners[2] - corners[3]));
+    float height = std::max(glm::length(corners[3] - corners[0]), glm::length(corners[2] - corners[1]));
+
+    _state->targetWidth = (int) ceilf(width);
+    _state->targetHeight = (int) ceilf(height);
   }
 
   void VideoStreamComponent::setUpShader() {
@@ -155,10 +268,10 @@ namespace argosClient {
 
   void VideoStreamComponent::specificRender() {
     if(_timer.getSeconds() > 1) {
-      _ready = false;
+      _state->ready = false;
     }
 
-    if(_ready) {
+    if(_state->ready) {
       _shader.useProgram();
 
       glVertexAttribPointer(_vertexHandler, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), _vertexData);
@@ -168,17 +281,18 @@ namespace argosClient {
 
       glUniformMatrix4fv(_mvpHandler, 1, GL_FALSE, glm::value_ptr(_projectionMatrix * _modelViewMatrix * _model));
 
-      if(_receive) {
-        makeVideoTexture(_receivedFrame);
+      updateTargetSize();
+
+      if(_state->received.exchange(false)) {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        makeVideoTexture(_state->receivedFrame);
       }
 
       glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_2D, _textureId);
+      GpuCounters::bindTexture(GL_TEXTURE_2D, _textureId);
       glUniform1i(_samplerHandler, 0);
 
-      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
-
-      _receive = false;
+      GpuCounters::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, _indices);
     }
   }
 
@@ -1,7 +1,9 @@
 // C/C++ stuff
 #include <time.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <iostream>
+#include <algorithm>
 #include <chrono>
 #include <csignal>
 
@@ -15,21 +17,36 @@
 #include <glm/gtc/type_ptr.hpp>
 
 // Camera stuff
-#include <raspicam/raspicam_cv.h>
 #include <CameraProjectorSystem.h>
+#include "FrameSource.h"
 
 // Task delegation, OpenGL and other stuff
 #include "TaskDelegation.h"
+#include "CameraCapture.h"
 #include "GLContext.h"
 #include "ImageComponent.h"
+#include "FrameScheduler.h"
+#include "ThreadManager.h"
+#include "TaskPool.h"
+#include "Metrics.h"
+#include "GpuCounters.h"
+#include "GpuMemoryTracker.h"
 #include "Timer.h"
+#include "Trace.h"
+#include "Startup.h"
+#include "AssetBundle.h"
+#include "TextureCache.h"
 
 // Managers
 #include "AudioManager.h"
+#include "SoundScheduler.h"
+#include "TtsCache.h"
 #include "EventManager.h"
 
 // RaspberryPi stuff
+#ifndef ARGOS_HEADLESS
 #include "bcm_host.h"
+#endif
 
 // Logger
 #include "Log.h"
@@ -38,6 +55,7 @@
 #define SCREEN_H 600
 #define SCREEN_W_CAMERA 800
 #define SCREEN_H_CAMERA 600
+#define SHUTDOWN_SOUND_TIMEOUT_MS 5000
 
 using namespace std;
 using namespace cv;
@@ -47,17 +65,115 @@ sig_atomic_t g_loop = true;
 
 void showIntro(GLContext& glContext, float duration, float* projection_matrix);
 void showAdaptedIntro(GLContext& glContext, float duration, float* projection_matrix,
-                      char **argv, EventManager& eventManager, raspicam::RaspiCam_Cv& Camera);
+                      const char* server, EventManager& eventManager, FrameSource& Camera);
 void signals_function_handler(int signum);
 
+void usage(const char* program) {
+  std::cout << "Usage: " + std::string(program) + " <ip:port> [-i] [-s source] [-f fps] [-v swap interval] [-m] [-e export] [-l level] [-g seconds] [-b megabytes] [-c capture] [-u] [-a] [-t command]" << std::endl;
+  std::cout << "  -i  Show the introduction" << std::endl;
+  std::cout << "  -s  Frame source (default " << FrameSource::getDefaultSpec() << "):" << std::endl;
+  std::cout << "        raspicam, v4l2[:/dev/videoN], file:<video or img_%04d.jpg>[@fps], synthetic[:fps]" << std::endl;
+  std::cout << "  -f  Target frame rate, 0 to render as fast as possible (default " << FrameScheduler::DEFAULT_FPS << ")" << std::endl;
+  std::cout << "  -v  Vertical blanks between buffer swaps, 0 to disable vsync (default 1)" << std::endl;
+  std::cout << "  -m  Show the metrics overlay" << std::endl;
+  std::cout << "  -e  Export the metrics every " << Metrics::DEFAULT_EXPORT_SECONDS << " s: file:<path> or udp:<host>:<port>" << std::endl;
+  std::cout << "  -l  Log level: debug, info, error or off (default info)" << std::endl;
+  std::cout << "  -g  Log the GPU work of a frame and of its busiest collections every given seconds" << std::endl;
+  std::cout << "  -b  Warn when textures and renderbuffers take more GPU memory, 0 to disable (default "
+            << GpuMemoryTracker::DEFAULT_BUDGET / (1024 * 1024) << " MB)" << std::endl;
+  std::cout << "  -c  Write the rendered frames to image files: <pattern>[@every], e.g. frames/%05d.png@30" << std::endl;
+  std::cout << "  -u  Upload the images uncompressed even if the GPU supports ETC1" << std::endl;
+  std::cout << "  -a  Low-latency audio: " << AudioManager::LOW_LATENCY_BUFFER << " samples at " << AudioManager::LOW_LATENCY_RATE
+            << " Hz instead of " << AudioManager::DEFAULT_BUFFER << " at " << AudioManager::DEFAULT_RATE << " Hz" << std::endl;
+  std::cout << "  -t  The speech synthesis command, run as <command> <lang> <text> <output.wav> (" << TtsCache::DEFAULT_COMMAND << ")" << std::endl;
+}
+
 int main(int argc, char **argv) {
-  if(argc < 2) {
-    std::cout << "Usage: " + std::string(argv[0]) + " <ip:port> [-i]" << std::endl;
+  bool show_intro = false;
+  float target_fps = FrameScheduler::DEFAULT_FPS;
+  int swap_interval = 1;
+  std::string source_spec = FrameSource::getDefaultSpec();
+  bool show_metrics = false;
+  std::string metrics_export;
+  Log::Level log_level = Log::LEVEL_INFO;
+  float gpu_report_seconds = 0.0f;
+  unsigned long gpu_budget = GpuMemoryTracker::DEFAULT_BUDGET;
+  std::string capture_pattern;
+  unsigned int capture_every = 1;
+  bool compressed_textures = true;
+  bool low_latency_audio = false;
+  std::string tts_command = TtsCache::DEFAULT_COMMAND;
+
+  int option;
+  while((option = getopt(argc, argv, "is:f:v:me:l:g:b:c:uat:h")) != -1) {
+    switch(option) {
+    case 'i':
+      show_intro = true;
+      break;
+    case 's':
+      source_spec = optarg;
+      break;
+    case 'f':
+      target_fps = atof(optarg);
+      break;
+    case 'v':
+      swap_interval = atoi(optarg);
+      break;
+    case 'm':
+      show_metrics = true;
+      break;
+    case 'e':
+      metrics_export = optarg;
+      break;
+    case 'l':
+      if(!Log::parseLevel(optarg, log_level)) {
+        usage(argv[0]);
+        return 0;
+      }
+      break;
+    case 'g':
+      gpu_report_seconds = atof(optarg);
+      break;
+    case 'b':
+      gpu_budget = atof(optarg) * 1024 * 1024;
+      break;
+    case 'c': {
+      capture_pattern = optarg;
+      size_t at = capture_pattern.rfind('@');
+      if(at != std::string::npos) {
+        capture_every = atoi(capture_pattern.substr(at + 1).c_str());
+        capture_pattern = capture_pattern.substr(0, at);
+      }
+      break;
+    }
+    case 'u':
+      compressed_textures = false;
+      break;
+    case 'a':
+      low_latency_audio = true;
+      break;
+    case 't':
+      tts_command = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return 0;
+    }
+  }
+
+  if(optind >= argc) {
+    usage(argv[0]);
     return 0;
   }
+  const char* server = argv[optind];
 
+  // Time to first frame is measured from here
+  Startup startup;
+
+#ifndef ARGOS_HEADLESS
   atexit(bcm_host_deinit);
   bcm_host_init();
+#endif
 
   // SIGINT registration
   struct sigaction sigIntHandler;
@@ -65,53 +181,86 @@ int main(int argc, char **argv) {
   sigemptyset(&sigIntHandler.sa_mask);
   sigIntHandler.sa_flags = 0;
   sigaction(SIGINT, &sigIntHandler, nullptr);
+#ifdef ARGOS_TRACE
+  // kill -USR1 <pid> writes the trace of the last frames
+  sigaction(SIGUSR1, &sigIntHandler, nullptr);
+#endif
 
   Log::setColouredOutput(isatty(fileno(stdout)));
+  Log::setLevel(log_level);
   Log::info("Launching ARgos Client...");
 
-  bool show_intro = false;
-  if(argc == 3) {
-    if(argv[2][1] == 'i') {
-      show_intro = true;
-    }
-  }
+  // Before any other thread starts, so all of them get their settings. The main thread only
+  // becomes the render thread once they run, they would inherit its core and priority otherwise
+  ThreadManager& threadManager = ThreadManager::getInstance();
+  threadManager.load("data/threads.yml");
+
+  // Also before other threads, the registry is shared by all of them
+  Metrics& metrics = Metrics::getInstance();
+  if(!metrics_export.empty())
+    metrics.setExport(metrics_export);
+  GpuCounters::setReportSeconds(gpu_report_seconds);
+  GpuMemoryTracker::setBudget(gpu_budget);
 
   // Images
-  cv::Mat currentFrame;     // current frame
   //cv::Mat projectorFrame;   // projector openCV frame
 
   // Window
   //const string projectorWindow = "Projector";
 
-  Log::info("Loading camera and projector parameters...");
+  // Assets found in the bundle are not decoded at all
+  AssetBundle& assetBundle = AssetBundle::getInstance();
+  if(!assetBundle.open(AssetBundle::DEFAULT_FILE))
+    Log::info("No asset bundle found, the assets are decoded (build one with tools/argos_bundle).");
+  TextureCache::getInstance().setEnabled(compressed_textures);
+
+  // Before GLContext, which opens the mixer
+  AudioManager::setLowLatency(low_latency_audio);
+  TtsCache::setCommand(tts_command);
+
+  // Also before other threads, the workers decode the assets while the camera and server come up
+  TaskPool& taskPool = TaskPool::getInstance();
+  EventManager& eventManager = EventManager::getInstance();
+
+  //-- Open the frame source -----
+  std::unique_ptr<FrameSource> frameSource = FrameSource::create(source_spec, SCREEN_W_CAMERA, SCREEN_H_CAMERA);
+  if(!frameSource) {
+    usage(argv[0]);
+    return -1;
+  }
+  FrameSource& Camera = *frameSource;
+
+  // Opening the camera and connecting to the server are the slowest steps, they overlap with the rest
+  startup.start("camera", [&Camera]() {
+    Log::info("Opening camera...");
+    Camera.open();
+    return Camera.isOpened();
+  });
+
+  // Task delegation stuff (client)
+  TaskDelegation td;
+  startup.start("connect", [&td, server]() {
+    while((td.connect(server) < 0)) {
+      usleep(1 * 1000 * 1000); // Wait 1 second before trying to reconnect
+      if(!g_loop)
+        return false;
+    }
+    return true;
+  });
+
   //- Camera Parameters ----
   CameraProjectorSystem cameraProjector;
-  cameraProjector.setCalibrationsPath("data/calibrations/");
-  cameraProjector.load("calibrationCamera.yml", "calibrationProjector.yml", "CameraProjectorExtrinsics.yml");
-  if(!cameraProjector.isValid()){
+  bool calibrated = startup.run("calibration", [&cameraProjector]() {
+    Log::info("Loading camera and projector parameters...");
+    cameraProjector.setCalibrationsPath("data/calibrations/");
+    cameraProjector.load("calibrationCamera.yml", "calibrationProjector.yml", "CameraProjectorExtrinsics.yml");
+    return cameraProjector.isValid();
+  });
+  if(!calibrated){
     Log::error("Camera or projector parameters is not set, need to run the calibrator tool.");
     exit(1);
   }
 
-  //-- Open VideoCapture -----
-  raspicam::RaspiCam_Cv Camera; // Internal camera
-  /*cv::VideoCapture Camera(0);*/ // USB camera
-  Camera.set(CV_CAP_PROP_FORMAT, CV_8UC3);
-  Camera.set(CV_CAP_PROP_FRAME_WIDTH, SCREEN_W_CAMERA);
-  Camera.set(CV_CAP_PROP_FRAME_HEIGHT, SCREEN_H_CAMERA);
-  //Camera.set(CV_CAP_PROP_CONTRAST, 55);
-  //Camera.set(CV_CAP_PROP_SATURATION, 55);
-  //Camera.set(CV_CAP_PROP_GAIN, 55);
-
-  Log::info("Opening camera...");
-  Camera.open();
-  if(!Camera.isOpened()) {
-    Log::error("Failed opening the camera.");
-    return -1;
-  }
-  Log::info("Camera opened correctly.");
-  Log::info("ARgos executing.");
-
   //Set the appropriate projection matrix so that rendering is done in a enrvironment like the real camera (without distorsion)
   cv::Size imgSize(SCREEN_W_CAMERA, SCREEN_H_CAMERA);
   cv::Size GlWindowSize(SCREEN_W, SCREEN_H);
@@ -122,50 +271,100 @@ int main(int argc, char **argv) {
 
   // OpenGL stuff
   GLContext& glContext = GLContext::getInstance();
-  //uint32_t w = glContext.getWidth();
-  //uint32_t h = glContext.getHeight();
-  glContext.setUpscale(false);
-  glContext.setScreen(0, 0, SCREEN_W, SCREEN_H);
-  glContext.setProjectionMatrix(glm::make_mat4(projection_matrix));
-
-  // Event Manager
-  EventManager& eventManager = EventManager::getInstance();
+  startup.run("gl", [&]() {
+    //uint32_t w = glContext.getWidth();
+    //uint32_t h = glContext.getHeight();
+    glContext.setUpscale(false);
+    glContext.setScreen(0, 0, SCREEN_W, SCREEN_H);
+    glContext.setProjectionMatrix(glm::make_mat4(projection_matrix));
+    glContext.setSwapInterval(swap_interval);
+    if(!capture_pattern.empty())
+      glContext.setFrameCapture(capture_pattern, capture_every);
+
+    // Only queues the images and sounds, they are uploaded as the main queue is drained
+    glContext.start();
+    glContext.showMetrics(show_metrics);
+    return true;
+  });
 
   if(show_intro) {
     showIntro(glContext, 5, projection_matrix);
-    //showAdaptedIntro(glContext, 5, projection_matrix, argv, eventManager, Camera);
+    //showAdaptedIntro(glContext, 5, projection_matrix, server, eventManager, Camera);
   }
 
-  // Task delegation stuff (client)
-  TaskDelegation td;;
-  while((td.connect(argv[1]) < 0)) {
-    usleep(1 * 1000 * 1000); // Wait 1 second before trying to reconnect
-    if(!g_loop)
-      exit(EXIT_FAILURE);
+  // Uploads the assets decoded so far while the camera and the server are on their way
+  while(!startup.isDone("camera") || !startup.isDone("connect")) {
+    taskPool.drainMainQueue();
+    if(!startup.areAssetsLoaded() && glContext.isLoaded())
+      startup.assetsLoaded();
+    usleep(5 * 1000);
   }
 
+  if(!startup.wait("connect"))
+    exit(EXIT_FAILURE);
+
+  if(!startup.wait("camera")) {
+    Log::error("Failed opening the camera.");
+    return -1;
+  }
+  Log::info("Camera opened correctly: " + Camera.getName() + ".");
+  Log::info("ARgos executing.");
+
+  // The camera is grabbed on its own thread and the task delegation takes the newest frame
+  CameraCapture capture(Camera);
+  capture.start();
+  td.setCameraCapture(&capture);
+
   td.start(g_loop);
-  glContext.start();
+
+  threadManager.registerCurrentThread("render");
+
+  FrameScheduler frameScheduler(target_fps);
+  SoundScheduler& soundScheduler = SoundScheduler::getInstance();
+  AudioManager& audioManager = AudioManager::getInstance();
+  TtsCache& ttsCache = TtsCache::getInstance();
 
   while(g_loop) {
     td.checkForErrors();
 
-    switch(eventManager.popEvent()) {
-    case EventManager::EventType::TD_THREAD_READY:
-      Camera.grab();
-      Camera.retrieve(currentFrame);
-      td.injectData(currentFrame, paper_t());
-      td.notify("ThreadReady");
-      break;
+    // Sleep until an event arrives, the next frame is due or a scheduled sound has to start
+    EventManager::Event event = eventManager.waitEvent(std::min(frameScheduler.getTimeToDeadline(),
+                                                                soundScheduler.getTimeToNextTick()));
+    switch(event.type) {
     case EventManager::EventType::TD_THREAD_FINISHED:
-      glContext.update(td.getModifiedPaper());
+      ARGOS_TRACE_FRAME(event.frameId);
+      glContext.update(*event.paper);
       td.notify("ThreadFinished");
       break;
     default:
       break;
     }
 
-    glContext.render();
+    // Uploads and other GL work finished by the task pool
+    taskPool.drainMainQueue();
+    soundScheduler.tick();
+    audioManager.update();
+    ttsCache.update();
+
+    if(frameScheduler.isFrameDue()) {
+      frameScheduler.beginFrame();
+      {
+        ARGOS_TRACE_SPAN("render");
+        glContext.render();
+      }
+      frameScheduler.endFrame();
+
+      if(!startup.areAssetsLoaded() && glContext.isLoaded())
+        startup.assetsLoaded();
+      if(!startup.isFirstFrameDone())
+        startup.firstFrame();
+    }
+
+    threadManager.reportIfDue();
+    metrics.exportIfDue();
+#ifdef ARGOS_TRACE
+    Trace::dumpIfRequested();
+#endif
   }
 
   Log::info("Waiting for task delegation to stop...");
@@ -176,10 +375,21 @@ int main(int argc, char **argv) {
   eventManager.destroy();
 
   Log::info("Stopping the camera...");
+  capture.stop();
   Camera.release();
 
-  AudioManager::getInstance().play("apagando.wav");
-  usleep(2196 * 1000);
+  // Waits as long as the sound still plays, bounded in case the mixer never reports the end.
+  // The sound may be streamed, the loop keeps it fed
+  soundScheduler.stopAll();
+  soundScheduler.playIn("apagando.wav", 0);
+
+  Timer goodbye;
+  goodbye.start();
+  while(audioManager.isPlaying() && goodbye.getMilliseconds() < SHUTDOWN_SOUND_TIMEOUT_MS) {
+    soundScheduler.tick();
+    audioManager.update();
+    usleep(SoundScheduler::SLOT_MS * 1000);
+  }
 
   Log::info("Releasing the OpenGL ES 2.0 context...");
   glContext.destroy();
@@ -207,6 +417,9 @@ void showIntro(GLContext& glContext, float duration, float* projection_matrix) {
     cover->render();
     glContext.swapBuffers();
 
+    // The assets queued by GLContext::start() keep loading behind the introduction
+    TaskPool::getInstance().drainMainQueue();
+
     if(t.getSeconds() > duration) {
       exit = true;
     }
@@ -216,7 +429,7 @@ void showIntro(GLContext& glContext, float duration, float* projection_matrix) {
 }
 
 void showAdaptedIntro(GLContext& glContext, float duration, float* projection_matrix,
-                      char **argv, EventManager& eventManager, raspicam::RaspiCam_Cv& Camera) {
+                      const char* server, EventManager& eventManager, FrameSource& Camera) {
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
   ImageComponent cover("data/images/cover.jpg", 10.5f, 14.85f);
@@ -225,16 +438,19 @@ void showAdaptedIntro(GLContext& glContext, float duration, float* projection_ma
   cover.show(true);
 
   TaskDelegation td;;
-  while((td.connect(argv[1]) < 0)) {
+  while((td.connect(server) < 0)) {
     usleep(1 * 1000 * 1000); // Wait 1 second before trying to reconnect
     if(!g_loop)
       exit(EXIT_FAILURE);
   }
 
+  CameraCapture capture(Camera);
+  capture.start();
+  td.setCameraCapture(&capture);
+
   sig_atomic_t exit_td = true;
   td.start(exit_td);
 
-  cv::Mat currentFrame;
   bool exit = false;
   Timer t;
   t.start();
@@ -242,15 +458,10 @@ void showAdaptedIntro(GLContext& glContext, float duration, float* projection_ma
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glViewport(0, 0, glContext.getWidth(), glContext.getHeight());
 
-    switch(eventManager.popEvent()) {
-    case EventManager::EventType::TD_THREAD_READY:
-      Camera.grab();
-      Camera.retrieve(currentFrame);
-      td.injectData(currentFrame, paper_t());
-      td.notify("ThreadReady");
-      break;
+    EventManager::Event event = eventManager.popEvent();
+    switch(event.type) {
     case EventManager::EventType::TD_THREAD_FINISHED:
-      cover.setModelViewMatrix(glm::make_mat4(td.getModifiedPaper().modelview_matrix));
+      cover.setModelViewMatrix(glm::make_mat4(event.paper->modelview_matrix));
       td.notify("ThreadFinished");
       break;
     default:
@@ -270,6 +481,7 @@ void showAdaptedIntro(GLContext& glContext, float duration, float* projection_ma
   exit_td = false;
   td.notifyAll();
   td.join();
+  capture.stop();
 }
 
 void signals_function_handler(int signum) {
@@ -278,6 +490,11 @@ void signals_function_handler(int signum) {
     Log::info("Signal " + std::to_string(signum) + " (SIGINT) caught.");
     g_loop = false;
     break;
+#ifdef ARGOS_TRACE
+  case SIGUSR1:
+    Trace::requestDump();
+    break;
+#endif
   default:
     break;
   }
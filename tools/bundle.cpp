@@ -0,0 +1,45 @@
+// Offline packer for the client assets
+// Decodes the images and sounds of the data directory into a single bundle the
+// client maps at startup, so it never has to decode them at runtime
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include "AssetBundle.h"
+#include "Log.h"
+
+using namespace argosClient;
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    std::cout << "Usage: " + std::string(argv[0]) + " [-o <bundle>] [-r <rate>] [-c <channels>] <data dir>" << std::endl;
+    return 0;
+  }
+
+  // The mixer format opened by AudioManager
+  std::string bundleFile = AssetBundle::DEFAULT_FILE;
+  int rate = 16000;
+  int channels = 2;
+  std::string dataDir;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+
+    if(arg == "-o" && i + 1 < argc)
+      bundleFile = argv[++i];
+    else if(arg == "-r" && i + 1 < argc)
+      rate = std::atoi(argv[++i]);
+    else if(arg == "-c" && i + 1 < argc)
+      channels = std::atoi(argv[++i]);
+    else
+      dataDir = arg;
+  }
+
+  if(dataDir.empty() || rate <= 0 || channels <= 0) {
+    Log::error("A data directory, a positive rate and a positive number of channels are needed.");
+    return 1;
+  }
+
+  return AssetBundle::build(dataDir, bundleFile, rate, channels) ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+// Offline converter for the overlay video clips
+// Builds the pre-decoded clip of every given video so the client never has to
+// decode them at runtime
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include "ClipCache.h"
+#include "Log.h"
+
+using namespace argosClient;
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    std::cout << "Usage: " + std::string(argv[0]) + " [-o <cache dir>] [-m <max MB>] <video> [<video> ...]" << std::endl;
+    return 0;
+  }
+
+  ClipCache& clipCache = ClipCache::getInstance();
+  int failed = 0;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+
+    if(arg == "-o" && i + 1 < argc) {
+      std::string path = argv[++i];
+      if(path[path.size() - 1] != '/')
+        path += '/';
+      clipCache.setCachePath(path);
+    }
+    else if(arg == "-m" && i + 1 < argc) {
+      clipCache.setMaxClipBytes(std::strtoul(argv[++i], nullptr, 10) * 1024 * 1024);
+    }
+    else if(!clipCache.build(arg)) {
+      ++failed;
+    }
+  }
+
+  clipCache.destroy();
+
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+// Offline compressor for the images
+// Builds the ETC1 textures of every given image so the client never has to
+// compress them at runtime
+
+#include <iostream>
+#include <string>
+#include <cstdio>
+
+#include "TextureCache.h"
+#include "AssetBundle.h"
+#include "Log.h"
+
+using namespace argosClient;
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    std::cout << "Usage: " + std::string(argv[0]) + " [-o <cache dir>] [-s <max width>x<max height>] [-m] <image> [<image> ...]" << std::endl;
+    return 0;
+  }
+
+  TextureCache& textureCache = TextureCache::getInstance();
+  int maxWidth = 0, maxHeight = 0;
+  bool mipmaps = false;
+  int failed = 0;
+
+  // Images only found in the bundle are compressed from it
+  AssetBundle::getInstance().open(AssetBundle::DEFAULT_FILE);
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+
+    if(arg == "-o" && i + 1 < argc) {
+      std::string path = argv[++i];
+      if(path[path.size() - 1] != '/')
+        path += '/';
+      textureCache.setCachePath(path);
+    }
+    else if(arg == "-s" && i + 1 < argc) {
+      sscanf(argv[++i], "%dx%d", &maxWidth, &maxHeight);
+    }
+    else if(arg == "-m") {
+      mipmaps = true;
+    }
+    else if(!textureCache.build(arg, TextureFit(maxWidth, maxHeight, mipmaps))) {
+      ++failed;
+    }
+  }
+
+  textureCache.destroy();
+  AssetBundle::getInstance().destroy();
+
+  return failed == 0 ? 0 : 1;
+}